@@ -0,0 +1,169 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// IndriReadBench
+//
+// Measures concurrent positional reads from the inverted files of a
+// repository.  All threads share one indri::file::File per index, the
+// way query threads do, and read blocks at random offsets.  The run is
+// repeated for 1, 2, 4, ... up to 'threads' threads; with lock-free
+// reads the throughput should grow with the thread count until the
+// disk or the page cache saturates.
+//
+// Parameters:
+//   index      repository to read from
+//   file       read this file instead of the repository inverted files
+//   threads    largest thread count to try (default 8)
+//   reads      reads per thread (default 100000)
+//   blockSize  bytes per read (default 16384)
+//
+
+#include "indri/indri-platform.h"
+#include "indri/Parameters.hpp"
+#include "indri/File.hpp"
+#include "indri/Path.hpp"
+#include "indri/Thread.hpp"
+#include "indri/IndriTimer.hpp"
+#include "indri/delete_range.hpp"
+#include "lemur/Exception.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+struct read_job_t {
+  std::vector<indri::file::File*>* files;
+  std::vector<UINT64>* sizes;
+  UINT64 reads;
+  size_t blockSize;
+  UINT64 seed;
+  UINT64 bytes;
+};
+
+static void read_job( void* data ) {
+  read_job_t* job = (read_job_t*) data;
+  std::vector<char> buffer( job->blockSize );
+  UINT64 state = job->seed;
+  UINT64 bytes = 0;
+
+  for( UINT64 i=0; i<job->reads; i++ ) {
+    // xorshift64: cheap, and private to the thread
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    size_t which = size_t( state % job->files->size() );
+    UINT64 size = (*job->sizes)[which];
+    UINT64 position = size > job->blockSize ? (state >> 8) % (size - job->blockSize) : 0;
+
+    bytes += (*job->files)[which]->read( &buffer.front(), position, job->blockSize );
+  }
+
+  job->bytes = bytes;
+}
+
+static void open_inverted_files( std::vector<indri::file::File*>& files, const std::string& repositoryPath ) {
+  indri::api::Parameters manifest;
+  manifest.loadFile( indri::file::Path::combine( repositoryPath, "manifest" ) );
+  std::string indexPath = indri::file::Path::combine( repositoryPath, "index" );
+
+  if( !manifest.exists( "indexes.index" ) )
+    return;
+
+  indri::api::Parameters indexes = manifest["indexes.index"];
+
+  for( size_t i=0; i<indexes.size(); i++ ) {
+    std::string path = indri::file::Path::combine( indexPath, (std::string) indexes[i] );
+    indri::file::File* file = new indri::file::File;
+    files.push_back( file );
+    file->openRead( indri::file::Path::combine( path, "invertedFile" ) );
+  }
+}
+
+int main( int argc, char* argv[] ) {
+  try {
+    indri::api::Parameters& param = indri::api::Parameters::instance();
+    param.loadCommandLine( argc, argv );
+
+    if( !param.exists( "index" ) && !param.exists( "file" ) )
+      LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Must specify an index or a file to read from." );
+
+    int maxThreads = param.get( "threads", 8 );
+    UINT64 reads = param.get( "reads", (INT64) 100000 );
+    size_t blockSize = (size_t) param.get( "blockSize", 16384 );
+
+    std::vector<indri::file::File*> files;
+    std::vector<UINT64> sizes;
+
+    if( param.exists( "file" ) ) {
+      files.push_back( new indri::file::File );
+      files.back()->openRead( param.get( "file", "" ) );
+    } else {
+      open_inverted_files( files, param.get( "index", "" ) );
+    }
+
+    if( files.size() == 0 )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "The repository has no indexes to read from." );
+
+    for( size_t i=0; i<files.size(); i++ )
+      sizes.push_back( files[i]->size() );
+
+    std::cout << "threads\tseconds\treads/s\tMB/s\tspeedup" << std::endl;
+    double baseline = 0;
+
+    for( int threadCount = 1; threadCount <= maxThreads; threadCount *= 2 ) {
+      std::vector<read_job_t> jobs( threadCount );
+      std::vector<indri::thread::Thread*> threads;
+      indri::utility::IndriTimer timer;
+      timer.start();
+
+      for( int i=0; i<threadCount; i++ ) {
+        jobs[i].files = &files;
+        jobs[i].sizes = &sizes;
+        jobs[i].reads = reads;
+        jobs[i].blockSize = blockSize;
+        jobs[i].seed = 0x9E3779B97F4A7C15ULL * (i+1);
+        jobs[i].bytes = 0;
+        threads.push_back( new indri::thread::Thread( read_job, &jobs[i] ) );
+      }
+
+      UINT64 bytes = 0;
+      for( int i=0; i<threadCount; i++ ) {
+        threads[i]->join();
+        bytes += jobs[i].bytes;
+      }
+
+      timer.stop();
+      indri::utility::delete_vector_contents( threads );
+
+      double seconds = double( timer.elapsedTime() ) / 1000000.;
+      double readRate = double( reads * threadCount ) / seconds;
+      if( threadCount == 1 )
+        baseline = readRate;
+
+      std::cout << threadCount << "\t"
+                << std::fixed << std::setprecision(3) << seconds << "\t"
+                << std::setprecision(0) << readRate << "\t"
+                << std::setprecision(1) << double(bytes) / (1024.*1024.) / seconds << "\t"
+                << std::setprecision(2) << readRate / baseline << std::endl;
+    }
+
+    for( size_t i=0; i<files.size(); i++ )
+      files[i]->close();
+    indri::utility::delete_vector_contents( files );
+  } catch( lemur::api::Exception& e ) {
+    LEMUR_ABORT(e);
+  }
+
+  return 0;
+}
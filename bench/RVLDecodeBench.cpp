@@ -0,0 +1,359 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// RVLDecodeBench
+//
+// Measures posting decode throughput on a synthetic inverted list.  The
+// list is written in the DiskDocListIterator format, then decoded by:
+//
+//   entry       one integer at a time with RVLCompress::decompress_int,
+//               the way DiskDocListIterator::_readEntry does by default
+//   kernel      RVLBlockDecoder over each block, once per kernel the
+//               CPU supports
+//   iterator    DiskDocListIterator scanning the list from disk, an
+//               entry at a time and (iterator-block) a block at a time
+//   for         DiskDocListIterator scanning the list written with the
+//               "for" PostingCodec
+//
+// each with and without positions.
+//
+// Parameters:
+//   entries    postings in the list (default 1000000)
+//   block      postings per skip block (default 128)
+//   gap        largest document gap (default 16)
+//   count      largest occurrence count (default 8)
+//   position   largest position gap (default 100)
+//   repeat     passes over the list per measurement (default 10)
+//   file       scratch file for the iterator runs (default RVLDecodeBench.list)
+//
+
+#include "indri/indri-platform.h"
+#include "indri/Parameters.hpp"
+#include "indri/File.hpp"
+#include "indri/IndriTimer.hpp"
+#include "indri/RVLBlockDecoder.hpp"
+#include "indri/DiskDocListIterator.hpp"
+#include "indri/PostingCodec.hpp"
+#include "lemur/RVLCompress.hpp"
+#include "lemur/Exception.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+struct synthetic_list_t {
+  std::vector<char> bytes;             // the list in the inverted file format
+  std::vector<size_t> blockStarts;     // offset of each block's entries
+  std::vector<size_t> blockEnds;
+  UINT64 entries;
+  UINT64 integers;
+};
+
+static UINT64 next_random( UINT64& state ) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+static void append_int( std::vector<char>& bytes, int value ) {
+  char buffer[8];
+  char* end = lemur::utility::RVLCompress::compress_int( buffer, value );
+  bytes.insert( bytes.end(), buffer, end );
+}
+
+static void append_raw( std::vector<char>& bytes, const void* data, size_t length ) {
+  bytes.insert( bytes.end(), (const char*) data, (const char*) data + length );
+}
+
+static void build_list( synthetic_list_t& list, UINT64 entries, int blockEntries, int gap, int count, int position ) {
+  UINT64 state = 0x9E3779B97F4A7C15ULL;
+  lemur::api::DOCID_T next = 1 + int( next_random( state ) % gap );
+
+  UINT32 headerLength = 0;
+  UINT8 control = 0;
+  append_raw( list.bytes, &headerLength, sizeof(UINT32) );
+  append_raw( list.bytes, &control, sizeof(UINT8) );
+
+  list.entries = entries;
+  list.integers = 0;
+
+  for( UINT64 written = 0; written < entries; ) {
+    std::vector<char> block;
+    lemur::api::DOCID_T last = 0;
+    lemur::api::DOCID_T document = 0;
+
+    for( int i=0; i<blockEntries && written < entries; i++, written++ ) {
+      document = next;
+      next += 1 + int( next_random( state ) % gap );
+      int occurrences = 1 + int( next_random( state ) % count );
+
+      append_int( block, document - last );
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      append_int( block, occurrences + 10 );
+      list.integers++;
+      #endif
+      append_int( block, occurrences );
+
+      for( int j=0; j<occurrences; j++ )
+        append_int( block, 1 + int( next_random( state ) % position ) );
+
+      list.integers += 2 + occurrences;
+      last = document;
+    }
+
+    // the skip names the first document of the next block
+    lemur::api::DOCID_T skipDocument = written < entries ? next : -1;
+    int skipLength = (int) block.size();
+    append_raw( list.bytes, &skipDocument, sizeof(lemur::api::DOCID_T) );
+    append_raw( list.bytes, &skipLength, sizeof(int) );
+
+    list.blockStarts.push_back( list.bytes.size() );
+    list.bytes.insert( list.bytes.end(), block.begin(), block.end() );
+    list.blockEnds.push_back( list.bytes.size() );
+  }
+}
+
+//
+// The per-integer decode DiskDocListIterator::_readEntry did before
+// blocks were decoded at once.
+//
+
+static UINT64 decode_entries( const synthetic_list_t& list, bool positions ) {
+  UINT64 checksum = 0;
+  indri::utility::greedy_vector<int> decoded;
+
+  for( size_t b=0; b<list.blockStarts.size(); b++ ) {
+    const char* current = &list.bytes[0] + list.blockStarts[b];
+    const char* end = &list.bytes[0] + list.blockEnds[b];
+    lemur::api::DOCID_T document = 0;
+
+    while( current < end ) {
+      int delta, unique, occurrences;
+      current = lemur::utility::RVLCompress::decompress_int( current, delta );
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      current = lemur::utility::RVLCompress::decompress_int( current, unique );
+      #endif
+      current = lemur::utility::RVLCompress::decompress_int( current, occurrences );
+      document += delta;
+
+      if( positions ) {
+        int last = 0;
+        decoded.clear();
+        for( int i=0; i<occurrences; i++ ) {
+          int deltaPosition;
+          current = lemur::utility::RVLCompress::decompress_int( current, deltaPosition );
+          last += deltaPosition;
+          decoded.push_back( last );
+        }
+      } else {
+        current = lemur::utility::RVLCompress::skip_ints( current, occurrences );
+      }
+
+      checksum += document + occurrences;
+    }
+  }
+
+  return checksum;
+}
+
+static UINT64 decode_kernel( const synthetic_list_t& list, indri::utility::RVLBlockDecoder::kernel_type kernel,
+                             std::vector<int>& decoded ) {
+  UINT64 checksum = 0;
+
+  for( size_t b=0; b<list.blockStarts.size(); b++ ) {
+    const char* start = &list.bytes[0] + list.blockStarts[b];
+    const char* end = &list.bytes[0] + list.blockEnds[b];
+    size_t count = indri::utility::RVLBlockDecoder::decode( start, end, &decoded[0], kernel );
+    checksum += count + decoded[count-1];
+  }
+
+  return checksum;
+}
+
+//
+// Writes the list again with another codec; the skips keep their
+// documents and get new lengths.
+//
+
+static void encode_list( const synthetic_list_t& list, const indri::index::PostingCodec* codec, std::vector<char>& bytes ) {
+  const indri::index::PostingCodec* rvl = indri::index::PostingCodec::get( "rvl" );
+  indri::index::PostingBlock block;
+  indri::utility::Buffer encoded;
+
+  bytes.assign( list.bytes.begin(), list.bytes.begin() + sizeof(UINT32) + sizeof(UINT8) );
+
+  for( size_t b=0; b<list.blockStarts.size(); b++ ) {
+    const char* start = &list.bytes[0] + list.blockStarts[b];
+    const char* end = &list.bytes[0] + list.blockEnds[b];
+    lemur::api::DOCID_T skipDocument;
+    memcpy( &skipDocument, start - sizeof(int) - sizeof(lemur::api::DOCID_T), sizeof(lemur::api::DOCID_T) );
+
+    encoded.clear();
+    rvl->decode( start, end, false, block );
+    codec->encode( block, encoded );
+
+    int skipLength = (int) encoded.position();
+    append_raw( bytes, &skipDocument, sizeof(lemur::api::DOCID_T) );
+    append_raw( bytes, &skipLength, sizeof(int) );
+    append_raw( bytes, encoded.front(), encoded.position() );
+  }
+}
+
+static UINT64 decode_iterator( indri::file::File& file, bool positions, const indri::index::PostingCodec* codec = 0, bool blockDecoding = false ) {
+  indri::index::TermData termData;
+  indri::index::DiskDocListIterator iterator( new indri::file::SequentialReadBuffer( file ), 0, 0, codec, blockDecoding );
+  UINT64 checksum = 0;
+
+  iterator.setStartOffset( 0, &termData );
+  iterator.countsOnly( !positions );
+
+  for( iterator.startIteration(); !iterator.finished(); iterator.nextEntry() ) {
+    indri::index::DocListIterator::DocumentData* entry = iterator.currentEntry();
+    checksum += entry->document + entry->count;
+  }
+
+  return checksum;
+}
+
+static void report( const char* name, double seconds, UINT64 entries, UINT64 integers, UINT64 bytes, UINT64 checksum ) {
+  std::cout << name << "\t"
+            << std::fixed << std::setprecision(3) << seconds << "\t"
+            << std::setprecision(1) << double(entries) / seconds / 1000000. << "\t"
+            << double(integers) / seconds / 1000000. << "\t"
+            << double(bytes) / seconds / (1024.*1024.) << "\t"
+            << checksum << std::endl;
+}
+
+int main( int argc, char* argv[] ) {
+  try {
+    indri::api::Parameters& param = indri::api::Parameters::instance();
+    param.loadCommandLine( argc, argv );
+
+    UINT64 entries = param.get( "entries", (INT64) 1000000 );
+    int blockEntries = param.get( "block", 128 );
+    int gap = param.get( "gap", 16 );
+    int count = param.get( "count", 8 );
+    int position = param.get( "position", 100 );
+    int repeat = param.get( "repeat", 10 );
+    std::string path = param.get( "file", "RVLDecodeBench.list" );
+
+    if( entries == 0 || blockEntries <= 0 || gap <= 0 || count <= 0 || position <= 0 || repeat <= 0 )
+      LEMUR_THROW( LEMUR_BAD_PARAMETER_ERROR, "entries, block, gap, count, position and repeat must be positive." );
+
+    synthetic_list_t list;
+    build_list( list, entries, blockEntries, gap, count, position );
+
+    indri::file::File file;
+    file.create( path );
+    file.write( &list.bytes[0], 0, list.bytes.size() );
+    file.close();
+    file.openRead( path );
+
+    const indri::index::PostingCodec* forCodec = indri::index::PostingCodec::get( "for" );
+    std::string forPath = path + ".for";
+    std::vector<char> forBytes;
+    encode_list( list, forCodec, forBytes );
+
+    indri::file::File forFile;
+    forFile.create( forPath );
+    forFile.write( &forBytes[0], 0, forBytes.size() );
+    forFile.close();
+    forFile.openRead( forPath );
+
+    UINT64 totalEntries = entries * repeat;
+    UINT64 totalIntegers = list.integers * repeat;
+    UINT64 totalBytes = UINT64( list.bytes.size() ) * repeat;
+
+    std::cout << "# " << entries << " postings, " << list.integers << " integers, "
+              << list.bytes.size() << " bytes; best kernel "
+              << indri::utility::RVLBlockDecoder::name( indri::utility::RVLBlockDecoder::kernel() ) << std::endl;
+    std::cout << "# for codec: " << forBytes.size() << " bytes" << std::endl;
+    std::cout << "method\tseconds\tMpost/s\tMint/s\tMB/s\tchecksum" << std::endl;
+
+    for( int positions = 1; positions >= 0; positions-- ) {
+      indri::utility::IndriTimer timer;
+      UINT64 checksum = 0;
+
+      timer.start();
+      for( int r=0; r<repeat; r++ )
+        checksum += decode_entries( list, positions != 0 );
+      timer.stop();
+      report( positions ? "entry" : "entry-counts", double( timer.elapsedTime() ) / 1000000., totalEntries, totalIntegers, totalBytes, checksum );
+
+      checksum = 0;
+      indri::utility::IndriTimer iteratorTimer;
+      iteratorTimer.start();
+      for( int r=0; r<repeat; r++ )
+        checksum += decode_iterator( file, positions != 0 );
+      iteratorTimer.stop();
+      report( positions ? "iterator" : "iterator-counts", double( iteratorTimer.elapsedTime() ) / 1000000., totalEntries, totalIntegers, totalBytes, checksum );
+
+      checksum = 0;
+      indri::utility::IndriTimer blockTimer;
+      blockTimer.start();
+      for( int r=0; r<repeat; r++ )
+        checksum += decode_iterator( file, positions != 0, 0, true );
+      blockTimer.stop();
+      report( positions ? "iterator-block" : "iterator-block-counts", double( blockTimer.elapsedTime() ) / 1000000., totalEntries, totalIntegers, totalBytes, checksum );
+
+      checksum = 0;
+      indri::utility::IndriTimer forTimer;
+      forTimer.start();
+      for( int r=0; r<repeat; r++ )
+        checksum += decode_iterator( forFile, positions != 0, forCodec );
+      forTimer.stop();
+      report( positions ? "for" : "for-counts", double( forTimer.elapsedTime() ) / 1000000., totalEntries, totalIntegers, totalBytes, checksum );
+    }
+
+    const indri::utility::RVLBlockDecoder::kernel_type kernels[] = {
+      indri::utility::RVLBlockDecoder::SCALAR,
+      indri::utility::RVLBlockDecoder::SSE2,
+      indri::utility::RVLBlockDecoder::SSE4,
+      indri::utility::RVLBlockDecoder::AVX2
+    };
+
+    for( size_t k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++ ) {
+      if( !indri::utility::RVLBlockDecoder::supported( kernels[k] ) )
+        continue;
+
+      indri::utility::IndriTimer timer;
+      UINT64 checksum = 0;
+
+      // room for the largest block, as DiskDocListIterator keeps
+      size_t largest = 0;
+      for( size_t b=0; b<list.blockStarts.size(); b++ )
+        largest = std::max( largest, list.blockEnds[b] - list.blockStarts[b] );
+      std::vector<int> decoded( largest );
+
+      timer.start();
+      for( int r=0; r<repeat; r++ )
+        checksum += decode_kernel( list, kernels[k], decoded );
+      timer.stop();
+
+      std::string name = std::string( "kernel-" ) + indri::utility::RVLBlockDecoder::name( kernels[k] );
+      report( name.c_str(), double( timer.elapsedTime() ) / 1000000., totalEntries, totalIntegers, totalBytes, checksum );
+    }
+
+    file.close();
+    forFile.close();
+    lemur_compat::remove( path.c_str() );
+    lemur_compat::remove( forPath.c_str() );
+  } catch( lemur::api::Exception& e ) {
+    LEMUR_ABORT(e);
+  }
+
+  return 0;
+}
@@ -0,0 +1,152 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// SegmentQueryBench
+//
+// Measures query latency against the number of index segments in a
+// repository.  Each repository is queried with 1, 2, 4, ... up to
+// 'threads' partitions; with one partition the segments are scored one
+// after another, with more they are scored concurrently and merged.
+// Give the same collection built with different segment counts to see
+// how latency depends on the number of segments.
+//
+// Parameters:
+//   index      repository to query; may be given several times
+//   query      space separated query terms; may be given several times
+//   threads    largest partition count to try (default 8)
+//   count      results requested (default 1000)
+//   repeat     times each query is run (default 10)
+//   rule       retrieval model (default dirichlet)
+//
+
+#include "indri/indri-platform.h"
+#include "indri/Parameters.hpp"
+#include "indri/Repository.hpp"
+#include "indri/LocalQueryServer.hpp"
+#include "indri/TermScoreFunctionFactory.hpp"
+#include "indri/IndriTimer.hpp"
+#include "lemur/Exception.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+typedef std::map<std::string, std::map<std::string, double> > query_terms_t;
+
+static query_terms_t build_query( indri::server::LocalQueryServer& server, const std::string& text ) {
+  std::istringstream stream( text );
+  std::vector<std::string> terms;
+  query_terms_t query;
+  std::string word;
+
+  while( stream >> word ) {
+    std::string term = server.processTerm( word );
+    if( !term.length() )
+      continue;
+    if( query.find( term ) == query.end() )
+      terms.push_back( term );
+    query[term]["weight"] += 1;
+  }
+
+  double termCount = double( server.termCount() );
+  double documentCount = double( server.documentCount() );
+
+  for( size_t i=0; i<terms.size(); i++ ) {
+    query[terms[i]]["collectionFrequency"] = double( server.termCount( terms[i] ) );
+    query[terms[i]]["collTermCnt"] = termCount;
+    query[terms[i]]["docFrequency"] = double( server.documentCount( terms[i] ) );
+    query[terms[i]]["docCnt"] = documentCount;
+  }
+
+  return query;
+}
+
+int main( int argc, char* argv[] ) {
+  try {
+    indri::api::Parameters& param = indri::api::Parameters::instance();
+    param.loadCommandLine( argc, argv );
+
+    if( !param.exists( "index" ) || !param.exists( "query" ) )
+      LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Must specify an index and a query." );
+
+    int maxThreads = param.get( "threads", 8 );
+    int count = param.get( "count", 1000 );
+    int repeat = param.get( "repeat", 10 );
+
+    std::map<std::string, double> modelParas;
+    modelParas["__MODEL__"] = indri::query::TermScoreFunctionFactory::modelType( param.get( "rule", "dirichlet" ) );
+
+    indri::api::Parameters indexes = param["index"];
+    indri::api::Parameters queries = param["query"];
+
+    std::cout << "index\tsegments\tdocuments\tthreads\tms/query\tspeedup" << std::endl;
+
+    for( size_t i=0; i<indexes.size(); i++ ) {
+      std::string path = indexes[i];
+      indri::collection::Repository repository;
+      repository.openRead( path );
+
+      size_t segments = 0;
+      UINT64 documents = 0;
+      {
+        indri::collection::Repository::index_state state = repository.indexes();
+        segments = state->size();
+        for( size_t j=0; j<state->size(); j++ )
+          documents += (*state)[j]->documentCount();
+      }
+
+      double baseline = 0;
+
+      for( int threadCount = 1; threadCount <= maxThreads; threadCount *= 2 ) {
+        // the server reads the partition count when it is built
+        param.set( "partitions", threadCount );
+        indri::server::LocalQueryServer server( repository );
+
+        std::vector<query_terms_t> queryTerms;
+        for( size_t j=0; j<queries.size(); j++ )
+          queryTerms.push_back( build_query( server, (std::string) queries[j] ) );
+
+        indri::utility::IndriTimer timer;
+        timer.start();
+
+        for( int r=0; r<repeat; r++ ) {
+          for( size_t j=0; j<queryTerms.size(); j++ ) {
+            indri::server::QueryServerResponse* response = server.runQuery( queryTerms[j], modelParas, count, true );
+            delete response;
+          }
+        }
+
+        timer.stop();
+
+        double milliseconds = double( timer.elapsedTime() ) / 1000. / double( repeat * queryTerms.size() );
+        if( threadCount == 1 )
+          baseline = milliseconds;
+
+        std::cout << path << "\t"
+                  << segments << "\t"
+                  << documents << "\t"
+                  << threadCount << "\t"
+                  << std::fixed << std::setprecision(3) << milliseconds << "\t"
+                  << std::setprecision(2) << baseline / milliseconds << std::endl;
+      }
+
+      repository.close();
+    }
+  } catch( lemur::api::Exception& e ) {
+    LEMUR_ABORT(e);
+  }
+
+  return 0;
+}
@@ -0,0 +1,629 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// ConvertIndex
+//
+// Rewrites the inverted lists of one disk index with another posting
+// codec, and optionally adds a score summary to every skip block.  The
+// new index is written to its own directory; the files the codec doesn't
+// touch are copied, the inverted file and the four term trees are
+// rebuilt with the new list offsets, and the manifest records the codec.
+// To use it, replace the index directory in the repository (e.g.
+// repository/index/0) with the output directory.
+//
+// Parameters:
+//   index           the disk index directory to read
+//   output          the directory to write the converted index to
+//   codec           posting codec to write (default "for")
+//   codecVersion    version of that codec (default 1)
+//   blockSummaries  write a block summary after every skip, for
+//                   Block-Max WAND (default false; summaries already in
+//                   the index are kept either way)
+//   impactOrder     also write an impact-ordered copy of every list
+//                   (impactFile and the impactString tree, see
+//                   ImpactListIterator), which lets a term-at-a-time
+//                   query with a posting budget stop part way down a
+//                   list (default false)
+//
+
+#include "indri/indri-platform.h"
+#include "indri/Parameters.hpp"
+#include "indri/File.hpp"
+#include "indri/Path.hpp"
+#include "indri/Buffer.hpp"
+#include "indri/BulkTree.hpp"
+#include "indri/DiskTermData.hpp"
+#include "indri/RVLCompressStream.hpp"
+#include "indri/RVLDecompressStream.hpp"
+#include "indri/PostingCodec.hpp"
+#include "lemur/Keyfile.hpp"
+#include "lemur/Exception.hpp"
+#include "lemur/lemur-compat.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+struct list_location_t {
+  list_location_t() : startOffset(0), length(0) {}
+
+  UINT64 startOffset;
+  UINT64 length;
+};
+
+struct impact_posting_t {
+  lemur::api::DOCID_T document;
+  int uniqueTermCount;
+  int count;
+  UINT32 length;
+  int impact;
+
+  // by impact, then document
+  bool operator< ( const impact_posting_t& other ) const {
+    if( impact != other.impact )
+      return impact < other.impact;
+    return document < other.document;
+  }
+};
+
+struct converter_t {
+  const indri::index::PostingCodec* from;
+  const indri::index::PostingCodec* to;
+  int fieldCount;
+
+  indri::file::File input;
+  indri::file::File output;
+  UINT64 outputOffset;
+
+  indri::utility::Buffer list;
+  indri::utility::Buffer converted;
+  indri::index::PostingBlock block;
+
+  // with blockSummaries, the length of every document
+  bool summaries;
+  std::vector<UINT32> documentLengths;
+  lemur::api::DOCID_T documentBase;
+
+  // with impactOrder, the postings of the list being converted and the
+  // impact list of every term
+  bool impacts;
+  std::vector<impact_posting_t> postings;
+  indri::file::File impactOutput;
+  UINT64 impactOffset;
+  std::vector< std::pair<std::string, list_location_t> > impactLocations;
+
+  UINT64 lists;
+  UINT64 inputBytes;
+};
+
+static void copy_file( const std::string& from, const std::string& to ) {
+  indri::file::File input;
+  indri::file::File output;
+
+  if( !input.openRead( from ) )
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open '" + from + "' for reading." );
+  if( !output.create( to ) )
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't create '" + to + "'." );
+
+  std::vector<char> buffer( 1024*1024 );
+  UINT64 length = input.size();
+
+  for( UINT64 position = 0; position < length; ) {
+    size_t chunk = (size_t) lemur_compat::min<UINT64>( buffer.size(), length - position );
+    input.read( &buffer[0], position, chunk );
+    output.write( &buffer[0], position, chunk );
+    position += chunk;
+  }
+
+  input.close();
+  output.close();
+}
+
+template<class T>
+static T read_raw( const char*& current, const char* end ) {
+  T value;
+
+  if( current + sizeof(T) > end )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Inverted list ends early." );
+
+  memcpy( &value, current, sizeof(T) );
+  current += sizeof(T);
+  return value;
+}
+
+static void write_raw( indri::utility::Buffer& buffer, const void* data, size_t length ) {
+  memcpy( buffer.write( length ), data, length );
+}
+
+static UINT32 document_length( converter_t& c, lemur::api::DOCID_T document ) {
+  size_t offset = size_t( document - c.documentBase );
+
+  if( document < c.documentBase || offset >= c.documentLengths.size() )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "An inverted list names a document the index doesn't have." );
+
+  return c.documentLengths[offset];
+}
+
+//
+// Fills in the block summary the DiskDocListIterator reads after a skip:
+// the largest count, the shortest document, and the count and length of
+// the document with the largest count/length.
+//
+
+static void summarize_block( converter_t& c, const indri::index::PostingBlock& block, UINT32 summary[4] ) {
+  summary[0] = 0;
+  summary[1] = MAX_INT32;
+  summary[2] = 0;
+  summary[3] = 1;
+
+  for( int i=0; i<block.size; i++ ) {
+    UINT32 count = block.counts[i];
+    UINT32 length = lemur_compat::max<UINT32>( document_length( c, block.documents[i] ), 1 );
+
+    summary[0] = lemur_compat::max( summary[0], count );
+    summary[1] = lemur_compat::min( summary[1], length );
+
+    // count/length > summary[2]/summary[3], without rounding
+    if( UINT64(count) * summary[3] > UINT64(summary[2]) * length ) {
+      summary[2] = count;
+      summary[3] = length;
+    }
+  }
+
+  if( block.size == 0 )
+    summary[1] = 1;
+}
+
+//
+// Keeps the postings of a block for the impact list.  The impact of a
+// posting is its count/length on a log scale, four steps to a factor of
+// two, so that 0 is the highest impact.
+//
+
+static void collect_postings( converter_t& c, const indri::index::PostingBlock& block ) {
+  for( int i=0; i<block.size; i++ ) {
+    impact_posting_t posting;
+    posting.document = block.documents[i];
+    posting.count = block.counts[i];
+    posting.length = lemur_compat::max<UINT32>( document_length( c, block.documents[i] ), 1 );
+    posting.uniqueTermCount = 0;
+    #ifdef DOC_UNIQUE_TERM_COUNTS
+    posting.uniqueTermCount = block.uniqueTermCounts[i];
+    #endif
+
+    double ratio = lemur_compat::min( double(posting.count) / double(posting.length), 1.0 );
+    posting.impact = lemur_compat::min( int( -log( ratio ) / log( 2.0 ) * 4 ), 255 );
+
+    c.postings.push_back( posting );
+  }
+}
+
+//
+// Writes the postings collected from a list as an impact list, one
+// segment per impact, highest impact first (see ImpactListIterator), and
+// records where it went.
+//
+
+static void write_impact_list( converter_t& c, const std::string& term ) {
+  std::sort( c.postings.begin(), c.postings.end() );
+
+  indri::utility::Buffer output;
+  size_t start = 0;
+
+  while( start < c.postings.size() ) {
+    size_t end = start;
+    size_t best = start;
+
+    // count/length > the best count/length, without rounding
+    for( ; end < c.postings.size() && c.postings[end].impact == c.postings[start].impact; end++ ) {
+      if( UINT64(c.postings[end].count) * c.postings[best].length > UINT64(c.postings[best].count) * c.postings[end].length )
+        best = end;
+    }
+
+    indri::utility::Buffer segment;
+    indri::utility::RVLCompressStream stream( segment );
+    stream << int( end - start )
+           << c.postings[best].count
+           << int( c.postings[best].length );
+
+    lemur::api::DOCID_T lastDocument = 0;
+
+    for( size_t i=start; i<end; i++ ) {
+      stream << int( c.postings[i].document - lastDocument )
+             << c.postings[i].uniqueTermCount
+             << c.postings[i].count;
+      lastDocument = c.postings[i].document;
+    }
+
+    UINT32 segmentLength = (UINT32) stream.dataSize();
+    write_raw( output, &segmentLength, sizeof(UINT32) );
+    write_raw( output, stream.data(), stream.dataSize() );
+    start = end;
+  }
+
+  list_location_t location;
+  location.startOffset = c.impactOffset;
+  location.length = output.position();
+
+  c.impactOutput.write( output.front(), c.impactOffset, output.position() );
+  c.impactOffset += output.position();
+  c.impactLocations.push_back( std::make_pair( term, location ) );
+  c.postings.clear();
+}
+
+//
+// The impact lists are found by term, like the string trees; the value
+// is the rvl start offset and length of the list in impactFile.
+//
+
+static bool by_term( const std::pair<std::string, list_location_t>& one, const std::pair<std::string, list_location_t>& two ) {
+  return one.first < two.first;
+}
+
+static void write_impact_tree( converter_t& c, const std::string& outputPath ) {
+  std::sort( c.impactLocations.begin(), c.impactLocations.end(), by_term );
+
+  indri::file::BulkTreeWriter writer;
+  writer.create( outputPath );
+
+  for( size_t i=0; i<c.impactLocations.size(); i++ ) {
+    const std::string& term = c.impactLocations[i].first;
+    indri::utility::Buffer valueBuffer;
+    indri::utility::RVLCompressStream out( valueBuffer );
+    out << INT64( c.impactLocations[i].second.startOffset )
+        << INT64( c.impactLocations[i].second.length );
+    writer.put( term.c_str(), (int) term.size(), out.data(), (int) out.dataSize() );
+  }
+
+  writer.close();
+}
+
+static void read_document_lengths( converter_t& c, const std::string& path ) {
+  indri::file::File lengths;
+
+  if( !lengths.openRead( path ) )
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open '" + path + "' for reading." );
+
+  c.documentLengths.resize( size_t( lengths.size() / sizeof(UINT32) ) );
+  if( c.documentLengths.size() )
+    lengths.read( &c.documentLengths[0], 0, c.documentLengths.size() * sizeof(UINT32) );
+  lengths.close();
+}
+
+//
+// Everything but the entries of each block is copied as it is; the
+// entries are decoded with one codec and encoded with the other, and the
+// skip length is fixed to match.  With blockSummaries a summary is
+// computed for each block from its entries and the document lengths, and
+// the control byte gets the block summary flag.
+//
+
+static void convert_list( converter_t& c, const char* list, size_t length ) {
+  const char* end = list + length;
+  const char* start = list;
+  indri::utility::Buffer& output = c.converted;
+
+  output.clear();
+
+  // header and control byte
+  UINT32 headerLength = read_raw<UINT32>( list, end );
+  list += headerLength;
+  UINT8 control = read_raw<UINT8>( list, end );
+
+  // topdocs
+  if( control & 0x01 ) {
+    UINT32 topdocsCount = read_raw<UINT32>( list, end );
+    list += topdocsCount * ( sizeof(lemur::api::DOCID_T) + 2*sizeof(UINT32) );
+  }
+
+  if( list > end )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Inverted list ends early." );
+
+  write_raw( output, start, list - start );
+  size_t summaryLength = (control & 0x04) ? 4*sizeof(UINT32) : 0;
+
+  if( c.summaries )
+    output.front()[ sizeof(UINT32) + headerLength ] = char( control | 0x04 );
+
+  while( list < end ) {
+    lemur::api::DOCID_T skipDocument = read_raw<lemur::api::DOCID_T>( list, end );
+    int skipLength = read_raw<int>( list, end );
+    const char* summary = list;
+    const char* entries = summary + summaryLength;
+    list = entries + skipLength;
+
+    if( skipLength < 0 || list > end )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Inverted list ends early." );
+
+    write_raw( output, &skipDocument, sizeof(lemur::api::DOCID_T) );
+    size_t lengthPosition = output.position();
+    write_raw( output, &skipLength, sizeof(int) );
+
+    c.block.size = 0;
+    if( skipLength )
+      c.from->decode( entries, list, false, c.block );
+
+    if( c.impacts )
+      collect_postings( c, c.block );
+
+    if( c.summaries ) {
+      UINT32 computed[4];
+      summarize_block( c, c.block, computed );
+      write_raw( output, computed, sizeof(computed) );
+    } else {
+      write_raw( output, summary, summaryLength );
+    }
+
+    size_t entriesPosition = output.position();
+
+    if( skipLength )
+      c.to->encode( c.block, output );
+
+    int convertedLength = int( output.position() - entriesPosition );
+    memcpy( output.front() + lengthPosition, &convertedLength, sizeof(int) );
+
+    if( skipDocument <= 0 )
+      break;
+  }
+
+  // nothing should follow the last block, but keep it if it does
+  write_raw( output, list, end - list );
+}
+
+//
+// Converts the list of every term in an ID tree, in ID order, and writes
+// the tree again with the new offsets.  The locations are kept by ID for
+// the string trees, which are written afterwards.
+//
+
+static void convert_id_tree( converter_t& c, const std::string& inputPath, const std::string& outputPath,
+                             std::vector<list_location_t>& locations ) {
+  const int mode = indri::index::DiskTermData::WithString | indri::index::DiskTermData::WithOffsets;
+  int dataSize = ::disktermdata_size( c.fieldCount );
+  std::vector<char> value( dataSize );
+  std::vector<char> decoded( dataSize );
+
+  indri::file::BulkTreeReader reader;
+  indri::file::BulkTreeWriter writer;
+  reader.openRead( inputPath );
+  writer.create( outputPath );
+
+  indri::file::BulkTreeIterator* iterator = reader.iterator();
+
+  for( iterator->startIteration(); !iterator->finished(); iterator->nextEntry() ) {
+    UINT32 termID;
+    int valueActual = 0;
+
+    if( !iterator->get( termID, &value.front(), dataSize, valueActual ) )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Couldn't read " + inputPath );
+
+    indri::utility::RVLDecompressStream stream( &value.front(), valueActual );
+    indri::index::DiskTermData* diskTermData = ::disktermdata_decompress( stream, &decoded.front(), c.fieldCount, mode );
+
+    c.list.clear();
+    char* list = c.list.write( (size_t) diskTermData->length );
+    c.input.read( list, diskTermData->startOffset, (size_t) diskTermData->length );
+    convert_list( c, list, (size_t) diskTermData->length );
+
+    if( c.impacts )
+      write_impact_list( c, diskTermData->termData->term );
+
+    c.output.write( c.converted.front(), c.outputOffset, c.converted.position() );
+    c.inputBytes += diskTermData->length;
+    c.lists++;
+
+    diskTermData->startOffset = c.outputOffset;
+    diskTermData->length = c.converted.position();
+    c.outputOffset += c.converted.position();
+
+    if( locations.size() <= termID )
+      locations.resize( termID + 1 );
+    locations[termID].startOffset = diskTermData->startOffset;
+    locations[termID].length = diskTermData->length;
+
+    indri::utility::Buffer termBuffer;
+    indri::utility::RVLCompressStream out( termBuffer );
+    ::disktermdata_compress( out, diskTermData, c.fieldCount, mode );
+    writer.put( termID, out.data(), (int) out.dataSize() );
+  }
+
+  delete iterator;
+  reader.close();
+  writer.close();
+}
+
+//
+// Copies a string tree, pointing each term at its converted list.
+//
+
+static void convert_string_tree( converter_t& c, const std::string& inputPath, const std::string& outputPath,
+                                 const std::vector<list_location_t>& locations ) {
+  const int mode = indri::index::DiskTermData::WithTermID | indri::index::DiskTermData::WithOffsets;
+  int dataSize = ::disktermdata_size( c.fieldCount );
+  std::vector<char> value( dataSize );
+  std::vector<char> decoded( dataSize );
+  char key[lemur::file::Keyfile::MAX_KEY_LENGTH+1];
+
+  indri::file::BulkTreeReader reader;
+  indri::file::BulkTreeWriter writer;
+  reader.openRead( inputPath );
+  writer.create( outputPath );
+
+  indri::file::BulkTreeIterator* iterator = reader.iterator();
+
+  for( iterator->startIteration(); !iterator->finished(); iterator->nextEntry() ) {
+    int keyActual = 0;
+    int valueActual = 0;
+
+    if( !iterator->get( key, sizeof(key)-1, keyActual, &value.front(), dataSize, valueActual ) )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Couldn't read " + inputPath );
+
+    indri::utility::RVLDecompressStream stream( &value.front(), valueActual );
+    indri::index::DiskTermData* diskTermData = ::disktermdata_decompress( stream, &decoded.front(), c.fieldCount, mode );
+
+    if( diskTermData->termID < 0 || size_t(diskTermData->termID) >= locations.size() )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "A term in " + inputPath + " has no list." );
+
+    diskTermData->startOffset = locations[diskTermData->termID].startOffset;
+    diskTermData->length = locations[diskTermData->termID].length;
+
+    indri::utility::Buffer termBuffer;
+    indri::utility::RVLCompressStream out( termBuffer );
+    ::disktermdata_compress( out, diskTermData, c.fieldCount, mode );
+    writer.put( key, keyActual, out.data(), (int) out.dataSize() );
+  }
+
+  delete iterator;
+  reader.close();
+  writer.close();
+}
+
+//
+// The frequent terms file holds a length-prefixed DiskTermData record for
+// each frequent term, offsets included, for the index merger.
+//
+
+static void convert_frequent_terms( converter_t& c, const std::string& inputPath, const std::string& outputPath,
+                                    const std::vector<list_location_t>& locations ) {
+  const int mode = indri::index::DiskTermData::WithOffsets | indri::index::DiskTermData::WithString | indri::index::DiskTermData::WithTermID;
+  int dataSize = ::disktermdata_size( c.fieldCount );
+  std::vector<char> decoded( dataSize );
+
+  indri::file::File input;
+  indri::file::File output;
+  input.openRead( inputPath );
+  output.create( outputPath );
+
+  std::vector<char> data( (size_t) input.size() );
+  if( data.size() )
+    input.read( &data[0], 0, data.size() );
+
+  const char* current = data.size() ? &data[0] : 0;
+  const char* end = current + data.size();
+  indri::utility::Buffer records;
+
+  while( current < end ) {
+    UINT32 length = read_raw<UINT32>( current, end );
+    if( current + length > end )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Couldn't read " + inputPath );
+
+    indri::utility::RVLDecompressStream stream( current, length );
+    indri::index::DiskTermData* diskTermData = ::disktermdata_decompress( stream, &decoded.front(), c.fieldCount, mode );
+    current += length;
+
+    if( diskTermData->termID < 0 || size_t(diskTermData->termID) >= locations.size() )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "A term in " + inputPath + " has no list." );
+
+    diskTermData->startOffset = locations[diskTermData->termID].startOffset;
+    diskTermData->length = locations[diskTermData->termID].length;
+
+    indri::utility::Buffer termBuffer;
+    indri::utility::RVLCompressStream out( termBuffer );
+    ::disktermdata_compress( out, diskTermData, c.fieldCount, mode );
+
+    UINT32 recordLength = (UINT32) out.dataSize();
+    write_raw( records, &recordLength, sizeof(UINT32) );
+    write_raw( records, out.data(), out.dataSize() );
+  }
+
+  output.write( records.front(), 0, records.position() );
+  input.close();
+  output.close();
+}
+
+int main( int argc, char* argv[] ) {
+  try {
+    indri::api::Parameters& param = indri::api::Parameters::instance();
+    param.loadCommandLine( argc, argv );
+
+    if( !param.exists( "index" ) || !param.exists( "output" ) )
+      LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Must specify an index to convert and an output directory." );
+
+    std::string inputPath = param["index"];
+    std::string outputPath = param["output"];
+    std::string codecName = param.get( "codec", "for" );
+    int codecVersion = param.get( "codecVersion", 1 );
+
+    indri::api::Parameters manifest;
+    manifest.loadFile( indri::file::Path::combine( inputPath, "manifest" ) );
+
+    converter_t c;
+    c.from = indri::index::PostingCodec::get( manifest.get( "postingCodec", "rvl" ), manifest.get( "postingCodecVersion", 1 ) );
+    c.to = indri::index::PostingCodec::get( codecName, codecVersion );
+    c.fieldCount = manifest.exists( "fields.field" ) ? (int) manifest["fields.field"].size() : 0;
+    c.outputOffset = 0;
+    c.lists = 0;
+    c.inputBytes = 0;
+    c.summaries = param.get( "blockSummaries", false );
+    c.impacts = param.get( "impactOrder", false );
+    c.impactOffset = 0;
+    c.documentBase = (lemur::api::DOCID_T) manifest["corpus.document-base"];
+
+    if( c.summaries || c.impacts )
+      read_document_lengths( c, indri::file::Path::combine( inputPath, "documentLengths" ) );
+
+    lemur_compat::mkdir( outputPath.c_str(), 0755 );
+
+    const char* copied[] = { "documentLengths", "documentStatistics", "directFile", "fieldsFile" };
+    for( size_t i=0; i<sizeof(copied)/sizeof(copied[0]); i++ ) {
+      copy_file( indri::file::Path::combine( inputPath, copied[i] ),
+                 indri::file::Path::combine( outputPath, copied[i] ) );
+    }
+
+    if( !c.input.openRead( indri::file::Path::combine( inputPath, "invertedFile" ) ) )
+      LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open the inverted file of " + inputPath );
+    if( !c.output.create( indri::file::Path::combine( outputPath, "invertedFile" ) ) )
+      LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't create the inverted file in " + outputPath );
+    if( c.impacts && !c.impactOutput.create( indri::file::Path::combine( outputPath, "impactFile" ) ) )
+      LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't create the impact file in " + outputPath );
+
+    std::vector<list_location_t> frequent;
+    std::vector<list_location_t> infrequent;
+
+    convert_id_tree( c, indri::file::Path::combine( inputPath, "frequentID" ),
+                     indri::file::Path::combine( outputPath, "frequentID" ), frequent );
+    convert_id_tree( c, indri::file::Path::combine( inputPath, "infrequentID" ),
+                     indri::file::Path::combine( outputPath, "infrequentID" ), infrequent );
+    c.input.close();
+    c.output.close();
+
+    if( c.impacts ) {
+      c.impactOutput.close();
+      write_impact_tree( c, indri::file::Path::combine( outputPath, "impactString" ) );
+    }
+
+    convert_string_tree( c, indri::file::Path::combine( inputPath, "frequentString" ),
+                         indri::file::Path::combine( outputPath, "frequentString" ), frequent );
+    convert_string_tree( c, indri::file::Path::combine( inputPath, "infrequentString" ),
+                         indri::file::Path::combine( outputPath, "infrequentString" ), infrequent );
+    convert_frequent_terms( c, indri::file::Path::combine( inputPath, "frequentTerms" ),
+                            indri::file::Path::combine( outputPath, "frequentTerms" ), frequent );
+
+    manifest.set( "postingCodec", std::string( c.to->name() ) );
+    manifest.set( "postingCodecVersion", c.to->version() );
+    if( c.impacts )
+      manifest.set( "impactLists", true );
+    manifest.writeFile( indri::file::Path::combine( outputPath, "manifest" ) );
+
+    std::cout << c.lists << " lists converted from " << c.from->name() << " to " << c.to->name()
+              << ( c.summaries ? " with block summaries" : "" )
+              << ( c.impacts ? " and impact lists" : "" )
+              << ": " << c.inputBytes << " bytes to " << c.outputOffset << " bytes" << std::endl;
+  } catch( lemur::api::Exception& e ) {
+    LEMUR_ABORT(e);
+  }
+
+  return 0;
+}
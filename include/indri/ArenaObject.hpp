@@ -0,0 +1,73 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// ArenaObject
+//
+// Base class for objects that live only as long as one query, such as
+// the nodes, score functions and list iterators of an inference network.
+// 'new (allocator) T(...)' places the object in a RegionAllocator, or on
+// the heap if allocator is 0; a plain 'new T(...)' uses the heap.  Either
+// way the object is destroyed with delete: delete runs the destructor,
+// but memory that came from an allocator is only given back when the
+// allocator is reset.
+//
+
+#ifndef INDRI_ARENAOBJECT_HPP
+#define INDRI_ARENAOBJECT_HPP
+
+#include <new>
+#include "indri/RegionAllocator.hpp"
+
+namespace indri
+{
+  namespace utility
+  {
+    class ArenaObject {
+    private:
+      // each object is preceded by the allocator it came from, padded
+      // so that the object keeps the 16 byte alignment of operator new
+      enum { HEADER_SIZE = 16 };
+
+      static RegionAllocator*& _header( void* object ) {
+        return *(RegionAllocator**) ((char*) object - HEADER_SIZE);
+      }
+
+    public:
+      static void* operator new( size_t size ) {
+        return operator new( size, (RegionAllocator*) 0 );
+      }
+
+      static void* operator new( size_t size, RegionAllocator* allocator ) {
+        size_t total = size + HEADER_SIZE;
+        char* object = (char*) (allocator ? allocator->allocate( total ) : ::operator new( total )) + HEADER_SIZE;
+        _header( object ) = allocator;
+        return object;
+      }
+
+      static void operator delete( void* object ) {
+        if( !object )
+          return;
+
+        if( !_header( object ) )
+          ::operator delete( (char*) object - HEADER_SIZE );
+      }
+
+      // called only if a constructor throws
+      static void operator delete( void* object, RegionAllocator* allocator ) {
+        operator delete( object );
+      }
+    };
+  }
+}
+
+#endif // INDRI_ARENAOBJECT_HPP
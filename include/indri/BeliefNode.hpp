@@ -42,6 +42,10 @@ namespace indri
       virtual const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& score( lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength ) = 0;
       virtual bool hasMatch( lemur::api::DOCID_T documentID ) = 0;
       virtual const indri::utility::greedy_vector<bool>& hasMatch( lemur::api::DOCID_T documentID, const indri::utility::greedy_vector<indri::index::Extent>& extents ) = 0;
+
+      /// passes over anything kept for documents before documentID, when
+      /// evaluation starts partway through an index
+      virtual void skipTo( lemur::api::DOCID_T documentID ) {}
      
       /// sets the siblings flag (and counter) if the belief node
       /// has siblings
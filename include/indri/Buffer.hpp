@@ -110,6 +110,14 @@ namespace indri
           grow(_size*2);
       }
 
+      // takes over size bytes of malloc'd storage
+      void attach( char* storage, size_t size ) {
+        free( _buffer );
+        _buffer = storage;
+        _size = size;
+        _position = 0;
+      }
+
       size_t remaining() {
         return size() - position();
       }
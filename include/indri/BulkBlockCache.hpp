@@ -0,0 +1,95 @@
+/*==========================================================================
+ * Copyright (c) 2005 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// BulkBlockCache
+//
+// Block cache shared by the BulkTreeReaders of a repository.  Blocks are
+// keyed by (file, block ID); each reader registers its file once to get
+// a file number.  The cache is split into shards, each with its own lock,
+// and evicts with the CLOCK policy.  A block returned by pin() stays in
+// memory until it is unpinned, so readers can search it without holding
+// any lock; disk reads also happen outside the shard lock.
+//
+
+#ifndef INDRI_BULKBLOCKCACHE_HPP
+#define INDRI_BULKBLOCKCACHE_HPP
+
+#include <vector>
+#include "indri/indri-platform.h"
+#include "indri/File.hpp"
+#include "indri/HashTable.hpp"
+#include "indri/Mutex.hpp"
+
+namespace indri
+{
+  namespace file
+  {
+    class BulkBlock;
+
+    class BulkBlockCache {
+    public:
+      enum { SHARDS = 16 };
+
+    private:
+      struct slot {
+        UINT64 key;
+        BulkBlock* block;
+        int pins;
+        bool referenced;
+      };
+
+      struct shard {
+        indri::thread::Mutex lock;
+        indri::utility::HashTable<UINT64, size_t> index;
+        std::vector<slot> slots;
+        size_t capacity;
+        size_t hand;
+        UINT64 hits;
+        UINT64 misses;
+
+        shard() : index( 4096 ), capacity(0), hand(0), hits(0), misses(0) {}
+      };
+
+      shard _shards[SHARDS];
+      indri::thread::Mutex _fileLock;
+      UINT32 _files;
+
+      static UINT64 _key( UINT32 file, UINT32 id ) { return (UINT64(file) << 32) | id; }
+      shard& _shard( UINT64 key );
+      void _evict( shard& s, size_t position );
+      void _shrink( shard& s );
+      size_t _victim( shard& s );
+
+      BulkBlockCache( const BulkBlockCache& other ) {}
+      const BulkBlockCache& operator=( const BulkBlockCache& other ) { return *this; }
+
+    public:
+      /// @param blocks the number of blocks to keep
+      BulkBlockCache( size_t blocks = 256 );
+      ~BulkBlockCache();
+
+      /// @return a number that identifies one file in this cache
+      UINT32 registerFile();
+
+      /// Finds a block, reading it from the file on a miss, and pins it
+      /// in memory.  Every pin must be matched by an unpin.
+      BulkBlock* pin( UINT32 file, UINT32 id, File& source );
+      void unpin( UINT32 file, UINT32 id );
+
+      UINT64 hits();
+      UINT64 misses();
+      size_t size();
+    };
+  }
+}
+
+#endif // INDRI_BULKBLOCKCACHE_HPP
@@ -22,6 +22,7 @@
 #include "indri/File.hpp"
 #include "indri/SequentialWriteBuffer.hpp"
 #include "indri/HashTable.hpp"
+#include "indri/BulkBlockCache.hpp"
 namespace indri
 {
   /*! \brief Filesystem interaction and file-based storage classes.*/
@@ -146,17 +147,28 @@ namespace indri
       void nextEntry();
     };
 
+    //
+    // Interior blocks are read once when the tree is opened and stay in
+    // memory, so a lookup reads at most one leaf.  Leaves go through a
+    // BulkBlockCache, which can be shared with other readers; a reader
+    // without one (or built over a File) gets a small private cache.
+    // Once opened, a reader can be used by many threads at once.
+    //
+
     class BulkTreeReader {
     private:
       File* _file;
       UINT64 _fileLength;
       bool _ownFile;
-  
-      BulkBlock* _head;
-      BulkBlock* _tail;
-      indri::utility::HashTable< UINT32, BulkBlock* > _cache;
 
-      BulkBlock* _fetch( UINT32 id );
+      BulkBlockCache* _cache;
+      bool _ownCache;
+      UINT32 _cacheFile;
+      indri::utility::HashTable< UINT32, BulkBlock* > _interior;
+
+      BulkBlock* _fetch( UINT32 id, bool& cached );
+      void _release( UINT32 id );
+      void _pinInterior();
 
     public:
       BulkTreeReader();
@@ -164,7 +176,8 @@ namespace indri
       BulkTreeReader( File& file, UINT64 length );
       ~BulkTreeReader();
   
-      void openRead( const std::string& filename );
+      /// @param cache leaf block cache to share; 0 for a private one
+      void openRead( const std::string& filename, BulkBlockCache* cache = 0 );
       bool get( const char* key, char* value, int& actual, int valueLength );
       bool get( const char* key, int keyLength, char* value, int& actual, int valueLength );
       bool get( UINT32 key, char* value, int& actual, int valueLength );
@@ -18,8 +18,10 @@
 #ifndef INDRI_DISKDOCLISTITERATOR_HPP
 #define INDRI_DISKDOCLISTITERATOR_HPP
 
+#include <vector>
 #include "indri/DocListIterator.hpp"
 #include "indri/SequentialReadBuffer.hpp"
+#include "indri/PostingCodec.hpp"
 #include "lemur/Keyfile.hpp"
 
 namespace indri { 
@@ -28,6 +30,9 @@ namespace indri {
     private:
       const char* _list;
       const char* _listEnd;
+      // where the current block's entries begin; _list is still here if
+      // none of them has been read
+      const char* _blockStart;
       lemur::api::DOCID_T _skipDocument;
 
       indri::file::SequentialReadBuffer* _file;
@@ -35,6 +40,19 @@ namespace indri {
       UINT64 _endOffset;
       bool _hasTopdocs;
       bool _isFrequent;
+      bool _hasBlockSummaries;
+      bool _countsOnly;
+
+      // with block decoding, the decoded entries of the current block and
+      // the next one to read; otherwise rvl entries are decoded one at a
+      // time straight from _list
+      const PostingCodec* _codec;
+      bool _blockDecoding;
+      PostingBlock _postings;
+      int _blockIndex;
+      int _blockSize;
+      DocumentBlock _block;
+      BlockSummary _blockSummary;
 
       indri::utility::greedy_vector<TopDocument> _topdocs;
       DocumentData _data;
@@ -45,15 +63,24 @@ namespace indri {
       char _term[ lemur::file::Keyfile::MAX_KEY_LENGTH+1 ];
       int _fieldCount;
 
+      UINT64 _postingsDecoded;
+      UINT64 _blocksSkipped;
+
       void _readEntry();
+      void _readBlockEntry();
+      void _decodeBlock();
+      bool _blockFinished() const { return _blockIndex == _blockSize && _list == _listEnd; }
       void _readSkip();
       void _readTopdocs();
       void _readTermData( int headerLength );
 
     public:
-      DiskDocListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, int fieldCount );
+      /// Lists are decoded a block at a time if blockDecoding is set or the
+      /// codec isn't rvl, and an entry at a time otherwise.
+      DiskDocListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, int fieldCount, const PostingCodec* codec = 0, bool blockDecoding = false );
       ~DiskDocListIterator();
       void setStartOffset( UINT64 startOffset, TermData* termData );
+      void countsOnly( bool countsOnly );
 
       const indri::utility::greedy_vector<TopDocument>& topDocuments();
 
@@ -61,9 +88,12 @@ namespace indri {
       bool nextEntry();
       bool nextEntry( lemur::api::DOCID_T documentID );
       DocumentData* currentEntry();
+      const DocumentBlock* currentBlock();
       bool finished();
+      const BlockSummary* blockSummary();
       bool isFrequent() const;
       TermData* termData();
+      void addCounters( indri::utility::QueryCounters& counters );
     };
   }
 }
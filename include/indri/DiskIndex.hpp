@@ -29,6 +29,10 @@
 #include <string>
 #include "indri/BulkTree.hpp"
 #include "indri/SequentialReadBuffer.hpp"
+#include "indri/MemoryMappedFile.hpp"
+#include "indri/TermDataCache.hpp"
+#include "indri/TermDictionary.hpp"
+#include "indri/PostingCodec.hpp"
 
 namespace indri {
   namespace index {
@@ -53,12 +57,31 @@ namespace indri {
       indri::file::File _directFile;
       indri::file::File _fieldsFile;
 
+      // impact-ordered lists, in indexes converted with impactOrder
+      bool _hasImpactLists;
+      indri::file::BulkTreeReader _impactStringToList;
+      indri::file::File _impactFile;
+
       indri::file::SequentialReadBuffer _lengthsBuffer;
 
+      // set when the index was opened with mapped=true and the files
+      // could be mapped; otherwise reads go through pread
+      indri::file::MemoryMappedFile _invertedMap;
+      indri::file::MemoryMappedFile _lengthsMap;
+      indri::file::MemoryMappedFile _directMap;
+
+      // decoded dictionary entries of recently used terms
+      TermDataCache _termCache;
+      // the whole dictionary, when the index was opened with memoryDictionary
+      TermDictionary _dictionary;
+
 	  std::vector<FieldStatistics> _fieldData;
       lemur::api::DOCID_T  _documentBase;
       int _infrequentTermBase;
+      const PostingCodec* _postingCodec;
+      bool _blockDecoding;
 
+      indri::file::SequentialReadBuffer* _listBuffer( INT64 startOffset, INT64 length, indri::utility::RegionAllocator* allocator = 0 );
       indri::index::DiskTermData* _fetchTermData( lemur::api::TERMID_T termID );
       indri::index::DiskTermData* _fetchTermData( const char* termString );
 
@@ -66,9 +89,25 @@ namespace indri {
       void _readManifest( const std::string& manifestPath );
 
     public:
-      DiskIndex() : _lengthsBuffer(_documentLengths) {}
+      struct options {
+        /// read the inverted file, the document lengths and the direct
+        /// file through memory mappings instead of pread
+        bool mapped;
+        /// number of dictionary entries to cache (0 for none)
+        size_t termCacheSize;
+        /// dictionary block cache shared with other indexes
+        indri::file::BulkBlockCache* blockCache;
+        /// load the whole term dictionary into memory
+        bool memoryDictionary;
+        /// decode rvl lists a skip block at a time (see DiskDocListIterator)
+        bool blockDecoding;
+
+        options() : mapped(false), termCacheSize(0), blockCache(0), memoryDictionary(false), blockDecoding(true) {}
+      };
+
+      DiskIndex() : _hasImpactLists(false), _lengthsBuffer(_documentLengths), _blockDecoding(true) {}
 
-      void open( const std::string& base, const std::string& relative );
+      void open( const std::string& base, const std::string& relative, const options& opts = options() );
       void close();
 
       const std::string& path();
@@ -103,6 +142,8 @@ namespace indri {
       
       DocListIterator* docListIterator( lemur::api::TERMID_T termID );
       DocListIterator* docListIterator( const std::string& term );
+      DocListIterator* docListIterator( const std::string& term, indri::utility::RegionAllocator* allocator );
+      ImpactListIterator* impactListIterator( const std::string& term, indri::utility::RegionAllocator* allocator );
       const TermList* termList( lemur::api::DOCID_T documentID );
       TermListFileIterator* termListFileIterator();
 
@@ -23,16 +23,20 @@
 #include "indri/TermData.hpp"
 #include "lemur/IndexTypes.hpp"
 #include "indri/ex_changes.hpp"
+#include "indri/ArenaObject.hpp"
+#include "indri/QueryProfile.hpp"
 
 namespace indri {
   namespace index {
-    class DocListIterator {
+    class DocListIterator : public indri::utility::ArenaObject {
     public:
       struct DocumentData {
         lemur::api::DOCID_T document;
         #ifdef DOC_UNIQUE_TERM_COUNTS
         int uniqueTermCounts;
         #endif
+        // number of occurrences; positions may be left empty (see countsOnly)
+        int count;
         indri::utility::greedy_vector<int> positions;
       };
 
@@ -70,9 +74,38 @@ namespace indri {
         int count;
         int length;
       };
+
+      // summary of one skip block, for score upper bounds that don't
+      // need the block decoded
+      struct BlockSummary {
+        int maxCount;                       // largest count in the block
+        int minLength;                      // shortest document in the block
+        int maxFractionCount;               // count and length of the document
+        int maxFractionLength;              //   with the largest count/length
+        lemur::api::DOCID_T lastDocument;   // no document after this one is in the block
+
+        double maxFraction() const {
+          return double(maxFractionCount) / double(maxFractionLength);
+        }
+      };
       
       virtual ~DocListIterator() {};
 
+      // a run of decoded entries, stored as parallel arrays
+      struct DocumentBlock {
+        const lemur::api::DOCID_T* documents;
+        const int* counts;
+        #ifdef DOC_UNIQUE_TERM_COUNTS
+        const int* uniqueTermCounts;
+        #endif
+        int size;
+      };
+
+      // when set before startIteration, entries carry only the document and
+      // count; positions stay empty.  Iterators that can't skip positions
+      // cheaply may ignore this.
+      virtual void countsOnly( bool countsOnly ) {}
+
       // get the iterator ready to return data; call this before calling currentEntry or nextEntry
       virtual void startIteration() = 0;
 
@@ -84,6 +117,10 @@ namespace indri {
 
       // return the current document entry if we're not finished, null otherwise.
       virtual DocumentData* currentEntry() = 0;
+
+      // the current entry and the decoded entries after it, or null if the
+      // iterator doesn't decode in blocks.  Valid until the iterator moves.
+      virtual const DocumentBlock* currentBlock() { return 0; }
     
       // move to the next document in the list; return false if there are no more valid documents
       virtual bool nextEntry() = 0;
@@ -94,6 +131,12 @@ namespace indri {
 
       // returns true if the iterator has no more entries
       virtual bool finished() = 0;
+
+      // summary of the block that holds the current entry, or null if the list doesn't store one
+      virtual const BlockSummary* blockSummary() { return 0; }
+
+      // adds the work done reading this list to counters
+      virtual void addCounters( indri::utility::QueryCounters& counters ) {}
     };
   }
 }
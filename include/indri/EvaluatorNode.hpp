@@ -21,6 +21,7 @@
 
 #include "indri/InferenceNetworkNode.hpp"
 #include "indri/ScoredExtentResult.hpp"
+#include "indri/QueryProfile.hpp"
 #include <string>
 #include <vector>
 #include <map>
@@ -39,6 +40,9 @@ namespace indri
       // May be called for documents other than those returned by nextCandidateDocument().
       virtual void evaluate( lemur::api::DOCID_T documentID, int documentLength ) = 0;
       virtual const MResults& getResults() = 0;
+
+      // adds the documents this node scored and ranked to counters
+      virtual void addCounters( indri::utility::QueryCounters& counters ) {}
     };
   }
 }
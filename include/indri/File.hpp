@@ -9,7 +9,6 @@
 #define INDRI_FILE_HPP
 
 #include "indri/indri-platform.h"
-#include "indri/Mutex.hpp"
 #include <string>
 namespace indri
 {
@@ -17,9 +16,10 @@ namespace indri
   {
     
     class File {
+      friend class MemoryMappedFile;
+
     private:
 #ifdef WIN32
-      indri::thread::Mutex _mutex;
       HANDLE _handle;
 #else
       int _handle;
@@ -0,0 +1,96 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// ImpactListIterator
+//
+// Reads the impact-ordered copy of an inverted list that ConvertIndex
+// writes with impactOrder=true.  The postings of a list are grouped into
+// segments by their count/length, quantized, and the segments are
+// stored highest count/length first, each with its documents in
+// increasing order.  A reader can stop part way down the list and still
+// have read the postings most likely to matter.  Only documents and
+// counts are kept; positions stay in the inverted file.
+//
+
+#ifndef INDRI_IMPACTLISTITERATOR_HPP
+#define INDRI_IMPACTLISTITERATOR_HPP
+
+#include <vector>
+#include "indri/SequentialReadBuffer.hpp"
+#include "indri/ArenaObject.hpp"
+#include "indri/QueryProfile.hpp"
+#include "indri/ex_changes.hpp"
+#include "lemur/IndexTypes.hpp"
+
+namespace indri {
+  namespace index {
+    class ImpactListIterator : public indri::utility::ArenaObject {
+    public:
+      struct Segment {
+        // the first 'decoded' postings, in document order
+        const lemur::api::DOCID_T* documents;
+        const int* counts;
+        #ifdef DOC_UNIQUE_TERM_COUNTS
+        const int* uniqueTermCounts;
+        #endif
+        int decoded;
+
+        // postings in the segment
+        int size;
+        // count and length of the posting with the largest count/length
+        int count;
+        int length;
+      };
+
+    private:
+      indri::file::SequentialReadBuffer* _file;
+      UINT64 _startOffset;
+      UINT64 _endOffset;
+      UINT64 _nextOffset;
+      bool _finished;
+
+      // the entries of the current segment
+      const char* _entries;
+      const char* _entriesEnd;
+      lemur::api::DOCID_T _lastDocument;
+
+      std::vector<lemur::api::DOCID_T> _documents;
+      std::vector<int> _counts;
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      std::vector<int> _uniqueTermCounts;
+      #endif
+      Segment _segment;
+
+      UINT64 _postingsDecoded;
+
+      void _readSegment();
+
+    public:
+      ImpactListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, UINT64 length );
+      ~ImpactListIterator();
+
+      void startIteration();
+      bool nextSegment();
+      bool finished() const;
+
+      /// The current segment; its header is always read, its postings
+      /// only up to what decode has been asked for.
+      const Segment& currentSegment() const;
+      /// Decodes the first postings of the current segment, up to its size.
+      const Segment& decode( int postings );
+
+      void addCounters( indri::utility::QueryCounters& counters );
+    };
+  }
+}
+
+#endif // INDRI_IMPACTLISTITERATOR_HPP
@@ -25,10 +25,12 @@
 #include "indri/DocListIterator.hpp"
 #include "indri/DocExtentListIterator.hpp"
 #include "indri/DocListFileIterator.hpp"
+#include "indri/ImpactListIterator.hpp"
 #include "indri/TermList.hpp"
 #include "indri/TermListFileIterator.hpp"
 #include "indri/DocumentDataIterator.hpp"
 #include "indri/Lockable.hpp"
+#include "indri/RegionAllocator.hpp"
 #include "lemur/IndexTypes.hpp"
 
 namespace indri {
@@ -92,6 +94,11 @@ namespace indri {
       // Lists
       virtual DocListIterator* docListIterator( lemur::api::TERMID_T termID ) = 0;
       virtual DocListIterator* docListIterator( const std::string& term ) = 0;
+      /// The iterator and its read buffer are placed in allocator, if not 0.
+      virtual DocListIterator* docListIterator( const std::string& term, indri::utility::RegionAllocator* allocator ) = 0;
+      /// The impact-ordered copy of the term's list, or 0 if the index
+      /// has none (see ConvertIndex); placed in allocator like a doc list.
+      virtual ImpactListIterator* impactListIterator( const std::string& term, indri::utility::RegionAllocator* allocator ) = 0;
       virtual const TermList* termList( lemur::api::DOCID_T documentID ) = 0;
       virtual TermListFileIterator* termListFileIterator() = 0;
 
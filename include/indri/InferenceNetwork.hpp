@@ -25,6 +25,8 @@
 #include "indri/Repository.hpp"
 #include "indri/Index.hpp"
 #include "indri/DeletedDocumentList.hpp"
+#include "indri/RegionAllocator.hpp"
+#include "indri/QueryProfile.hpp"
 
 namespace indri
 {
@@ -42,6 +44,7 @@ namespace indri
 
     private:
       std::vector<std::string> _termNames;
+      std::vector<int> _termUsers;
       std::vector<std::string> _fieldNames;
       std::vector<std::string> _priorNames;
 
@@ -51,14 +54,25 @@ namespace indri
       std::vector<BeliefNode*> _beliefNodes;
       std::vector<EvaluatorNode*> _evaluators;
       std::vector<EvaluatorNode*> _complexEvaluators;
+      std::vector<class TermAtATimeAccumulator*> _termAtATimeEvaluators;
       std::vector<indri::query::TermScoreFunction*> _scoreFunctions;
 
       indri::utility::greedy_vector<class indri::index::DocListIterator*> _closeIterators;
       int _closeIteratorBound;
 
+      // the lists of the current index the network moves itself; a list
+      // driven by its belief node is moved through the node instead
+      std::vector<char> _drivenIterators;
+      indri::utility::greedy_vector<class indri::index::DocListIterator*> _movedIterators;
+      indri::utility::greedy_vector<class TermFrequencyBeliefNode*> _listDrivers;
+
       indri::collection::Repository& _repository;
+      indri::utility::RegionAllocator* _allocator;
       MAllResults _results;
 
+      // the work of the lists that have been closed
+      indri::utility::QueryCounters _listCounters;
+
       void _indexChanged( indri::index::Index& index );
       void _indexFinished( indri::index::Index& index );
 
@@ -67,19 +81,34 @@ namespace indri
 
       lemur::api::DOCID_T _nextCandidateDocument( indri::index::DeletedDocumentList::read_transaction* deleted );
       void _evaluateDocument( indri::index::Index& index, lemur::api::DOCID_T document );
-      void _evaluateIndex( indri::index::Index& index );
+      void _evaluateIndex( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+      void _evaluateSegment( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+      void _evaluate( lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+      void _collectResults();
 
     public:
-      InferenceNetwork( indri::collection::Repository& repository );
+      /// Nodes, score functions and lists of the network may be placed
+      /// in allocator, which the owner resets once the network is deleted.
+      InferenceNetwork( indri::collection::Repository& repository, indri::utility::RegionAllocator* allocator = 0 );
       ~InferenceNetwork();
 
+      indri::utility::RegionAllocator* allocator() { return _allocator; }
+
       const std::vector<EvaluatorNode*>& getEvaluators() const;
 
       std::vector<BeliefNode*> getBeliefNodes();
       indri::index::DocListIterator* getDocIterator( int index );
       indri::index::DocExtentListIterator* getFieldIterator( int index );
       
+      /// Returns the list of term; a term added again gets the same list.
       int addDocIterator( const std::string& term );
+      /// True if the list was added more than once, so that several
+      /// queries of a batch read it.
+      bool sharedDocIterator( int index ) const;
+      /// The node reads the list from its decoded blocks, so the network
+      /// moves the list with node->advance() rather than nextEntry().
+      /// Called from the node's indexChanged().
+      void driveDocIterator( int index, class TermFrequencyBeliefNode* node );
       int addFieldIterator( const std::string& field );
       int addPriorIterator( const std::string& prior );
       
@@ -87,12 +116,25 @@ namespace indri
       void addBeliefNode( BeliefNode* beliefNode );
       void addEvaluatorNode( EvaluatorNode* evaluatorNode );
       void addComplexEvaluatorNode( EvaluatorNode* complexEvaluator );
+      // also adds the node as an evaluator node
+      void addTermAtATimeEvaluatorNode( class TermAtATimeAccumulator* termAtATimeEvaluator );
       void addScoreFunction( indri::query::TermScoreFunction* scoreFunction );
 
       // build the run query essential related InferenceNetwork
       void buildQueryInferenceNetwork();
 
       const MAllResults& evaluate();
+
+      /// Evaluates only the documents in [begin, end), so that several
+      /// networks built for the same query can split the collection.
+      const MAllResults& evaluate( lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+
+      /// Evaluates only the documents of one index of the repository in
+      /// [begin, end); the caller keeps the index state alive.
+      const MAllResults& evaluate( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+
+      /// Adds the work done by the evaluations so far to counters.
+      void addCounters( indri::utility::QueryCounters& counters );
     };
   }
 }
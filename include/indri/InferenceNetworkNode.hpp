@@ -21,12 +21,13 @@
 
 #include <string>
 #include "indri/Index.hpp"
+#include "indri/ArenaObject.hpp"
 namespace indri
 {
   namespace infnet
   {
     
-    class InferenceNetworkNode {
+    class InferenceNetworkNode : public indri::utility::ArenaObject {
     public:
       virtual ~InferenceNetworkNode() {}
       virtual lemur::api::DOCID_T nextCandidateDocument() = 0;
@@ -26,6 +26,9 @@
 #include "indri/QueryServer.hpp"
 #include "indri/Repository.hpp"
 #include "indri/InferenceNetwork.hpp"
+#include "indri/SharedThreshold.hpp"
+#include "indri/WorkerPool.hpp"
+#include "indri/RegionAllocator.hpp"
 
 namespace indri
 {
@@ -41,21 +44,57 @@ namespace indri
       bool _optimizeParameter;
       indri::collection::Repository& _repository;
 
+      // document-at-a-time queries are split by index and document
+      // range into about this many partitions, evaluated on _pool and
+      // the calling thread
+      int _partitions;
+      indri::thread::WorkerPool* _pool;
+
+      // the networks of a query are built in these, one per group of
+      // partitions, and they are reset when the query is done, even if
+      // it fails; a server runs one query at a time
+      std::vector<indri::utility::RegionAllocator*> _allocators;
+
+      indri::utility::RegionAllocator* _allocator( size_t partition );
+      void _resetAllocators();
+
       //
       void _buildInferenceNetwork(
         indri::infnet::InferenceNetwork* network, 
         std::map<std::string, std::map<std::string, double> >& queryTerms, 
         std::map<std::string, double>& modelParas,
-        int resultsRequested
+        int resultsRequested,
+        indri::infnet::SharedThreshold* sharedThreshold = 0,
+        const std::string& nodeName = "ranking",
+        bool sharedLists = false
       );
+
+      void _buildBatchNetwork(
+        indri::infnet::InferenceNetwork* network,
+        std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+        std::vector< std::map<std::string, double> >& modelParas,
+        int resultsRequested,
+        bool batch,
+        indri::infnet::SharedThreshold* sharedThreshold
+      );
+
+      QueryServerResponse* _runPartitionedQuery( std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+        std::vector< std::map<std::string, double> >& modelParas, int resultsRequested, bool batch );
     public:
       LocalQueryServer( indri::collection::Repository& repository );
+      ~LocalQueryServer();
 
       // query
       std::string processTerm( std::string s);
 	    QueryServerResponse* getGlobalStatistics( std::vector<std::string>& queryTerms );
+      INT64 termCount();
+      INT64 termCount( const std::string& term );
+      INT64 documentCount();
+      INT64 documentCount( const std::string& term );
       QueryServerResponse* runQuery( std::map<std::string, std::map<std::string, double> >& queryTerms, 
         std::map<std::string, double>& modelParas, int resultsRequested, bool optimize );
+      QueryServerResponse* runQueryBatch( std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+        std::vector< std::map<std::string, double> >& modelParas, int resultsRequested );
 
       // single document queries
       std::string documentMetadatum( lemur::api::DOCID_T documentID, const std::string& attributeName );
@@ -0,0 +1,70 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// MemoryMappedFile
+//
+// A read-only mapping of a whole File.  Readers decode straight out of
+// the mapping, so the pages are shared with every other thread and
+// process through the page cache instead of being copied into private
+// buffers.  advise() passes access pattern hints on to the kernel;
+// it is a no-op where the platform has no equivalent.
+//
+
+#ifndef INDRI_MEMORYMAPPEDFILE_HPP
+#define INDRI_MEMORYMAPPEDFILE_HPP
+
+#include "indri/indri-platform.h"
+#include "indri/File.hpp"
+
+namespace indri
+{
+  namespace file
+  {
+    class MemoryMappedFile {
+    private:
+      const char* _data;
+      UINT64 _size;
+#ifdef WIN32
+      HANDLE _mapping;
+#endif
+
+      // a mapping can't be shared between two owners
+      MemoryMappedFile( const MemoryMappedFile& other ) {}
+      const MemoryMappedFile& operator=( const MemoryMappedFile& other ) { return *this; }
+
+    public:
+      enum Advice {
+        NORMAL,
+        SEQUENTIAL,
+        RANDOM,
+        WILLNEED
+      };
+
+      MemoryMappedFile();
+      ~MemoryMappedFile();
+
+      /// Maps the whole file read-only; returns false (and leaves the
+      /// object unmapped) if the file is empty or can't be mapped.
+      bool map( File& file );
+      void unmap();
+
+      /// Hints how the byte range [offset, offset+length) will be read.
+      void advise( UINT64 offset, UINT64 length, Advice advice );
+
+      bool mapped() const { return _data != 0; }
+      const char* data() const { return _data; }
+      UINT64 size() const { return _size; }
+    };
+  }
+}
+
+#endif // INDRI_MEMORYMAPPEDFILE_HPP
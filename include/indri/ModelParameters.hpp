@@ -0,0 +1,77 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// ModelParameters
+//
+// Typed view of the model parameter map built by SimpleQueryParser.
+// The map is resolved once per query, so that scoring code never
+// has to look up parameters by name.
+//
+
+#ifndef INDRI_MODELPARAMETERS_HPP
+#define INDRI_MODELPARAMETERS_HPP
+
+#include <string>
+#include <map>
+#include "lemur/lemur-platform.h"
+
+namespace indri
+{
+  namespace query
+  {
+    struct ModelParameters {
+      enum Evaluation {
+        DOCUMENT_AT_A_TIME = 0,
+        TERM_AT_A_TIME = 1
+      };
+
+      // perturbation type (0 means no perturbation), see SimpleQueryParser::loadPertubeParameters
+      int pertubeType;
+      double pertubeK;
+      double pertubeB;
+
+      // retrieval model (see TermScoreModels.hpp), from the "method" rule key
+      int model;
+
+      // Dirichlet smoothing
+      double mu;
+      // Jelinek-Mercer smoothing
+      double lambda;
+      // Okapi BM25
+      double k1;
+      double b;
+      double k3;
+      // PL2 length normalization
+      double c;
+      // F2EXP
+      double s;
+      double k;
+
+      // evaluation strategy, from the "evaluation" rule key (daat or taat)
+      int evaluation;
+      // term-at-a-time only: on indexes with impact-ordered lists, score
+      // only this many postings per index, highest impact first (0 means
+      // no limit; see TermAtATimeAccumulator)
+      UINT64 postingBudget;
+
+      ModelParameters();
+      ModelParameters( const std::map<std::string, double>& paras );
+
+      static double get( const std::map<std::string, double>& paras, const std::string& name, double defaultValue );
+      // returns the Evaluation for a strategy name; throws on unknown names
+      static int evaluationType( const std::string& name );
+    };
+  }
+}
+
+#endif // INDRI_MODELPARAMETERS_HPP
+
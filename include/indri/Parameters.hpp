@@ -398,6 +398,12 @@ namespace indri
       /// Initialize from a file
       /// @param filename the filename to parse
       void loadFile( const std::string& filename );
+      /// Write the parameters as XML
+      /// @param text the string to append the XML to
+      void write( std::string& text );
+      /// Write the parameters to a file
+      /// @param filename the file to write
+      void writeFile( const std::string& filename );
       /// Initialize from the command line
       /// @param argc the number of command line arguments
       /// @param argv the command line arguments
@@ -0,0 +1,199 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// PertubePolicy
+//
+// Compile-time perturbation policies.  Each policy rewrites the
+// collection average document length (once per query term) and the
+// (count, documentLength) pair of a scored document (once per posting).
+// The perturbation type is read from ModelParameters::pertubeType once
+// per query; scoring code is instantiated for a single policy, so the
+// per-posting path has no branch on the perturbation type.
+//
+// Types that have no effect (LV2 and the linear TG variants) use
+// NoPertube.  TG2 (constant) only changes the average document length.
+//
+// A policy is 'bounded' when it leaves (count, documentLength) alone,
+// so the per-term maximum scores used for pruning still hold.
+//
+
+#ifndef INDRI_PERTUBEPOLICY_HPP
+#define INDRI_PERTUBEPOLICY_HPP
+
+#include "indri/ModelParameters.hpp"
+
+namespace indri
+{
+  namespace query
+  {
+    namespace pertube
+    {
+      enum Type {
+        NONE = 0,
+        LV1 = 1,
+        LV2 = 2,
+        LV3 = 3,
+        TN1 = 4,   // constant
+        TN2 = 5,   // linear
+        TG1 = 6,   // constant
+        TG1_LINEAR = 7,
+        TG2 = 8,   // constant
+        TG2_LINEAR = 9,
+        TG3 = 10,  // constant
+        TG3_LINEAR = 11
+      };
+
+      struct NoPertube {
+        static const bool bounded = true;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+        }
+      };
+
+      struct LV1Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return (1-p.pertubeB)*avdl+p.pertubeB*1000000/documentCount;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          count *= (1-p.pertubeB)*documentLength+p.pertubeB*1000000;
+          documentLength *= (1-p.pertubeB)*documentLength+p.pertubeB*1000000;
+        }
+      };
+
+      struct LV3Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl * (p.pertubeK+1);
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          count *= p.pertubeK+1;
+          documentLength *= p.pertubeK+1;
+        }
+      };
+
+      struct TN1Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl + p.pertubeK;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          documentLength += p.pertubeK;
+        }
+      };
+
+      struct TN2Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl * (1+p.pertubeB);
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          documentLength *= 1+p.pertubeB;
+        }
+      };
+
+      struct TG1Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl + p.pertubeK;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          count += p.pertubeK;
+          documentLength += p.pertubeK;
+        }
+      };
+
+      struct TG2Pertube {
+        static const bool bounded = true;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl + (queryLength-1)*p.pertubeK;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+        }
+      };
+
+      struct TG3Pertube {
+        static const bool bounded = false;
+
+        static double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+          return avdl + queryLength*p.pertubeK;
+        }
+
+        static void document( int& count, int& documentLength, double queryLength, const ModelParameters& p ) {
+          count += queryLength*p.pertubeK;
+          documentLength += queryLength*p.pertubeK;
+        }
+      };
+
+      //
+      // Calls _Visitor::template apply<Policy>() for the policy that matches
+      // the perturbation type.  This is the only place where the type is
+      // switched on; it should run once per query, not once per posting.
+      //
+
+      template<class _Visitor>
+      typename _Visitor::result_type dispatch( int type, _Visitor& visitor ) {
+        switch( type ) {
+          case LV1: return visitor.template apply<LV1Pertube>();
+          case LV3: return visitor.template apply<LV3Pertube>();
+          case TN1: return visitor.template apply<TN1Pertube>();
+          case TN2: return visitor.template apply<TN2Pertube>();
+          case TG1: return visitor.template apply<TG1Pertube>();
+          case TG2: return visitor.template apply<TG2Pertube>();
+          case TG3: return visitor.template apply<TG3Pertube>();
+          default:  return visitor.template apply<NoPertube>();
+        }
+      }
+
+      struct average_length_visitor {
+        typedef double result_type;
+
+        double avdl;
+        double documentCount;
+        double queryLength;
+        const ModelParameters& parameters;
+
+        average_length_visitor( double a, double d, double q, const ModelParameters& p ) :
+          avdl(a), documentCount(d), queryLength(q), parameters(p) {}
+
+        template<class _Pertube>
+        double apply() {
+          return _Pertube::averageDocumentLength( avdl, documentCount, queryLength, parameters );
+        }
+      };
+
+      inline double averageDocumentLength( double avdl, double documentCount, double queryLength, const ModelParameters& p ) {
+        average_length_visitor visitor( avdl, documentCount, queryLength, p );
+        return dispatch( p.pertubeType, visitor );
+      }
+    }
+  }
+}
+
+#endif // INDRI_PERTUBEPOLICY_HPP
+
@@ -0,0 +1,81 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// PostingCodec
+//
+// Encodes and decodes the entries of one skip block of an inverted list.
+// Everything around the entries -- the list header, topdocs, skips and
+// block summaries -- is the same for every codec; only the bytes a skip's
+// length covers change.  An index records its codec in the manifest as
+// postingCodec and postingCodecVersion; an index without them uses "rvl",
+// the format Indri has always written.
+//
+//   rvl   per entry: delta document, unique term count, count, then
+//         the position deltas, every integer RVLCompressed
+//   for   the same integers split into streams -- document gaps, unique
+//         term counts, counts, positions -- each packed frame of reference
+//         at a fixed bit width, so a stream decodes with shifts and masks
+//         and the positions can be skipped without reading them
+//
+
+#ifndef INDRI_POSTINGCODEC_HPP
+#define INDRI_POSTINGCODEC_HPP
+
+#include <vector>
+#include <string>
+#include "lemur/IndexTypes.hpp"
+#include "indri/Buffer.hpp"
+#include "indri/ex_changes.hpp"
+
+namespace indri
+{
+  namespace index
+  {
+    struct PostingBlock {
+      PostingBlock() : size(0), hasPositions(false) {}
+
+      std::vector<lemur::api::DOCID_T> documents;
+      std::vector<int> counts;
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      std::vector<int> uniqueTermCounts;
+      #endif
+      std::vector<int> positionStarts;   // where each entry's deltas start in positions
+      std::vector<int> positions;        // position deltas, restarting at each entry
+      int size;
+      bool hasPositions;
+
+      // grows the arrays to hold at least this many entries and positions
+      void reserve( size_t entries, size_t positionCount );
+    };
+
+    class PostingCodec {
+    public:
+      virtual ~PostingCodec() {}
+
+      virtual const char* name() const = 0;
+      virtual int version() const = 0;
+
+      /// Decodes the entries in [list, listEnd) into block.  When
+      /// countsOnly is set the codec may leave the positions undecoded,
+      /// and says so in block.hasPositions.
+      virtual void decode( const char* list, const char* listEnd, bool countsOnly, PostingBlock& block ) const = 0;
+
+      /// Appends the entries of block, which must have positions, to output.
+      virtual void encode( const PostingBlock& block, indri::utility::Buffer& output ) const = 0;
+
+      /// @return the codec with this name and version; throws if there is none
+      static const PostingCodec* get( const std::string& name, int version = 1 );
+    };
+  }
+}
+
+#endif // INDRI_POSTINGCODEC_HPP
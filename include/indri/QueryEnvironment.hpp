@@ -25,6 +25,8 @@
 #include "indri/Parameters.hpp"
 #include "indri/ParsedDocument.hpp"
 #include "indri/Repository.hpp"
+#include "indri/WorkerPool.hpp"
+#include "indri/QueryProfile.hpp"
 #include "lemur/IndexTypes.hpp"
 
 namespace indri 
@@ -77,16 +79,30 @@ namespace indri
       std::map<std::string, double> _modelParas;
 
       Parameters _parameters;
+
+      // queries go to every server at once; built when there are several
+      indri::thread::WorkerPool* _pool;
+
+      // collection totals, summed over the servers as they are added
+      INT64 _collectionTermCount;
+      INT64 _collectionDocumentCount;
+      // the term statistics cache of each server's repository, shared
+      // with every other environment on it; 0 for servers without one
+      std::vector<indri::collection::TermStatisticsCache*> _serverStatistics;
+
+      // where the time of the last query went
+      indri::utility::QueryProfile _profile;
       
       void _setQTF(std::map<std::string, double>& parsedQuery);
       void _transformQuery();
-      std::vector<std::string> _getProcessedQTerms();
+      void _parseQuery( const std::string& q, const std::string& rule, const int pertube_type, const std::map<std::string, double>& pertube_paras );
       std::map<std::string, std::map<std::string, double> > _getProcessedQTermswithStats();
-      void _setCollectionStatistics( indri::infnet::InferenceNetwork::MAllResults& statisticsResults );
-      void _mergeQueryResults( indri::infnet::InferenceNetwork::MAllResults& results, std::vector<indri::server::QueryServerResponse*>& responses );
-      std::vector<indri::server::QueryServerResponse*> _runServerQuery( int resultsRequested );
-      void _sumServerQuery( indri::infnet::InferenceNetwork::MAllResults& results, int resultsRequested );
-      void _mergeServerQuery( indri::infnet::InferenceNetwork::MAllResults& results, int resultsRequested );
+      void _addServer( indri::server::QueryServer* server, indri::collection::TermStatisticsCache* statistics );
+      void _fetchTermStatistics( const std::vector<std::string>& terms, std::vector<indri::collection::TermStatisticsCache::statistics>& totals );
+      void _setCollectionStatistics();
+      void _runServerTasks( const std::vector<indri::thread::WorkerPool::Task*>& tasks );
+      void _mergeQueryResults( indri::infnet::InferenceNetwork::MAllResults& results, std::vector<indri::server::QueryServerResponse*>& responses, int resultsRequested );
+      void _addServerProfiles( std::vector<indri::server::QueryServerResponse*>& responses );
      
       std::vector<indri::api::ScoredExtentResult> _runQuery( indri::infnet::InferenceNetwork::MAllResults& results,
                                                              const std::string& q,
@@ -116,6 +132,11 @@ namespace indri
       /// \brief Add a local repository
       /// @param pathname the path to the repository.
       void addIndex( const std::string& pathname );
+      /// \brief Add a repository that is already open.  The repository
+      /// is read-only and owned by the caller, so several environments
+      /// (one per query thread) can share it; close() leaves it open.
+      /// @param repository the open repository
+      void addIndex( indri::collection::Repository& repository );
       /// Close the QueryEnvironment.
       void close();
 
@@ -125,6 +146,17 @@ namespace indri
       /// @return the vector of ScoredExtentResults for the query
       std::vector<indri::api::ScoredExtentResult> runQuery( const std::string& query, int resultsRequested, const int pertube_type, const std::map<std::string, double>& pertube_paras );
 
+      /// \brief Run several queries together, for instance one query text
+      /// under different scoring rules or perturbation settings.  Each
+      /// posting list the queries share is read once for the whole batch.
+      /// @param queries the queries to run
+      /// @param resultsRequested maximum number of results to return for each query
+      /// @param rules the scoring rule of each query; an empty rule is the one set by setScoringRules
+      /// @param pertube_types the perturbation type of each query
+      /// @param pertube_paras the perturbation parameters of each query
+      /// @return the ScoredExtentResults of each query, in the order of queries
+      std::vector< std::vector<indri::api::ScoredExtentResult> > runQueryBatch( const std::vector<std::string>& queries, int resultsRequested, const std::vector<std::string>& rules, const std::vector<int>& pertube_types, const std::vector< std::map<std::string, double> >& pertube_paras );
+
       /// \brief Run an Indri query language query. @see ScoredExtentResult
       /// @param query the query to run
       /// @param documentSet the working set of document ids to evaluate
@@ -142,6 +174,12 @@ namespace indri
       /// @param attributeName the name of the metadata attribute
       /// @return the vector of string values for that attribute
       std::vector<std::string> documentMetadata( const std::vector<indri::api::ScoredExtentResult>& documentIDs, const std::string& attributeName );
+
+      /// \brief The profile of the last query or batch run: the time spent
+      /// parsing, processing terms, fetching statistics, building the
+      /// inference networks and evaluating them, and the work the
+      /// evaluation did.  The metadata and output phases are left to the caller.
+      const indri::utility::QueryProfile& queryProfile() const { return _profile; }
     };
   }
 }
@@ -0,0 +1,119 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// QueryProfile
+//
+// Where the time of one query went, phase by phase, and how much work
+// its evaluation did.  Profiles are always recorded; a phase costs two
+// clock reads and the counters are kept by the objects that do the
+// work (lists, accumulators) and summed once, when the query is done.
+//
+
+#ifndef INDRI_QUERYPROFILE_HPP
+#define INDRI_QUERYPROFILE_HPP
+
+#include <string>
+#include <ostream>
+#include "lemur/lemur-platform.h"
+#include "indri/IndriTimer.hpp"
+
+namespace indri
+{
+  namespace utility
+  {
+    struct QueryCounters {
+      UINT64 postingsDecoded;   // list entries decoded
+      UINT64 blocksSkipped;     // list blocks passed over without decoding
+      UINT64 documentsScored;
+      UINT64 bytesRead;         // list bytes read from files or mappings
+      UINT64 heapInsertions;    // documents that entered a top-k list
+      UINT64 cacheHits;         // query term counts found in a server's statistics cache
+
+      QueryCounters() {
+        clear();
+      }
+
+      void clear() {
+        postingsDecoded = 0;
+        blocksSkipped = 0;
+        documentsScored = 0;
+        bytesRead = 0;
+        heapInsertions = 0;
+        cacheHits = 0;
+      }
+
+      QueryCounters& operator+= ( const QueryCounters& other ) {
+        postingsDecoded += other.postingsDecoded;
+        blocksSkipped += other.blocksSkipped;
+        documentsScored += other.documentsScored;
+        bytesRead += other.bytesRead;
+        heapInsertions += other.heapInsertions;
+        cacheHits += other.cacheHits;
+        return *this;
+      }
+    };
+
+    class QueryProfile {
+    public:
+      enum Phase {
+        PARSE,
+        TERMS,          // stemming and stopping the query terms
+        STATISTICS,
+        BUILD,          // building the inference networks
+        EVALUATION,
+        METADATA,
+        OUTPUT,
+        PHASES
+      };
+
+    private:
+      UINT64 _mark;
+
+    public:
+      UINT64 microseconds[PHASES];
+      QueryCounters counters;
+
+      QueryProfile() {
+        clear();
+      }
+
+      void clear() {
+        for( int i=0; i<PHASES; i++ )
+          microseconds[i] = 0;
+        counters.clear();
+        _mark = 0;
+      }
+
+      /// Starts the clock for the first phase.
+      void start() {
+        _mark = IndriTimer::currentTime();
+      }
+
+      /// Adds the time since start() or the last lap() to phase.
+      void lap( int phase ) {
+        UINT64 now = IndriTimer::currentTime();
+        microseconds[phase] += now - _mark;
+        _mark = now;
+      }
+
+      UINT64 totalMicroseconds() const;
+
+      static const char* phaseName( int phase );
+
+      /// Writes the profile as one line of JSON.
+      void writeJSON( std::ostream& out, const std::string& query ) const;
+    };
+  }
+}
+
+#endif // INDRI_QUERYPROFILE_HPP
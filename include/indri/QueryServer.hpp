@@ -21,8 +21,10 @@
 
 //#include "indri/QuerySpec.hpp"
 #include "indri/InferenceNetwork.hpp"
+#include "indri/QueryProfile.hpp"
 #include "lemur/IndexTypes.hpp"
 #include <vector>
+#include <sstream>
 namespace indri
 {
   namespace server
@@ -32,6 +34,8 @@ namespace indri
     public:
       virtual ~QueryServerResponse() {};
       virtual indri::infnet::InferenceNetwork::MAllResults& getResults() = 0;
+      // network build and evaluation times, and the work of the evaluation
+      virtual const indri::utility::QueryProfile& getProfile() = 0;
     };
 
     class QueryServerMetadataResponse {
@@ -45,8 +49,28 @@ namespace indri
       virtual ~QueryServer() {};
       virtual std::string processTerm( std::string s) = 0;
       virtual QueryServerResponse* getGlobalStatistics( std::vector<std::string>& queryTerms ) = 0;
+
+      // collection statistics, read straight from the indexes
+      virtual INT64 termCount() = 0;
+      virtual INT64 termCount( const std::string& term ) = 0;
+      virtual INT64 documentCount() = 0;
+      virtual INT64 documentCount( const std::string& term ) = 0;
+
       virtual QueryServerResponse* runQuery( std::map<std::string, std::map<std::string, double> >& queryTerms, 
         std::map<std::string, double>& modelParas, int resultsRequested, bool optimize ) = 0;
+
+      // runs several queries in one pass over the lists they share; the
+      // top resultsRequested documents of query i are in the results of
+      // the node named batchResultName(i)
+      virtual QueryServerResponse* runQueryBatch( std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+        std::vector< std::map<std::string, double> >& modelParas, int resultsRequested ) = 0;
+
+      static std::string batchResultName( size_t query ) {
+        std::ostringstream name;
+        name << "ranking" << query;
+        return name.str();
+      }
+
       virtual QueryServerMetadataResponse* documentMetadata( const std::vector<lemur::api::DOCID_T>& documentIDs, const std::string& attributeName ) = 0;
     };
   }
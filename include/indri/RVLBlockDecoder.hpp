@@ -0,0 +1,57 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// RVLBlockDecoder
+//
+// Decodes a run of RVLCompress integers in one call.  RVL stores seven
+// bits per byte, least significant group first, and marks the last byte
+// of every integer with the high bit, so the terminators of a whole
+// vector of bytes can be found at once.  The SSE2, SSE4.1 and AVX2
+// kernels use that to widen runs of one-byte integers straight into the
+// output and to find where the scalar decoder has to take over.  The kernel is
+// picked from the CPU features when the library loads; the scalar
+// kernel works everywhere.
+//
+
+#ifndef INDRI_RVLBLOCKDECODER_HPP
+#define INDRI_RVLBLOCKDECODER_HPP
+
+#include <stddef.h>
+
+namespace indri
+{
+  namespace utility
+  {
+    class RVLBlockDecoder {
+    public:
+      enum kernel_type { SCALAR, SSE2, SSE4, AVX2 };
+
+      /// Decodes every integer in [source, end).  There must be room in
+      /// result for end - source integers.
+      /// @return the number of integers decoded
+      static size_t decode( const char* source, const char* end, int* result );
+      static size_t decode( const char* source, const char* end, int* result, kernel_type kernel );
+
+      /// Steps over count integers starting at source, without reading
+      /// past end while whole words can be skipped.
+      /// @return the byte after the last integer skipped
+      static const char* skip( const char* source, const char* end, int count );
+
+      /// @return the kernel decode() uses
+      static kernel_type kernel();
+      static bool supported( kernel_type kernel );
+      static const char* name( kernel_type kernel );
+    };
+  }
+}
+
+#endif // INDRI_RVLBLOCKDECODER_HPP
@@ -0,0 +1,87 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// ReadBufferPool
+//
+// Keeps the storage of finished read buffers so that the next lists
+// opened can use it instead of allocating (and first touching) buffers
+// of up to a megabyte every time.  Every thread has a pool of its own,
+// so borrowing and returning a buffer takes no shared lock; only the
+// counts are locked, by the pool's own lock, so that counts() can read
+// them while the thread works.  Buffers are kept
+// in power of two size classes, the sizes indri::utility::Buffer grows
+// to, from 64 bytes up to a megabyte; a pool holds at most
+// MAXIMUM_POOLED_BYTES and frees what it can't keep.
+//
+
+#ifndef INDRI_READBUFFERPOOL_HPP
+#define INDRI_READBUFFERPOOL_HPP
+
+#include <vector>
+#include "indri/indri-platform.h"
+#include "indri/Buffer.hpp"
+#include "indri/Mutex.hpp"
+
+namespace indri
+{
+  namespace file
+  {
+    class ReadBufferPool {
+      friend struct read_buffer_pool_registry;
+
+    public:
+      struct statistics {
+        UINT64 acquired;        // buffers handed out
+        UINT64 allocated;       // ...of which had to be allocated
+        UINT64 allocatedBytes;
+        UINT64 released;        // buffers given back
+        UINT64 freed;           // ...of which the pool had no room for
+      };
+
+      enum {
+        MINIMUM_CLASS_SIZE = 64,
+        MAXIMUM_CLASS_SIZE = 1024*1024,
+        CLASSES = 15,
+        MAXIMUM_POOLED_BYTES = 16*1024*1024
+      };
+
+    private:
+      // storage of each size class, MINIMUM_CLASS_SIZE << class bytes
+      std::vector<char*> _free[CLASSES];
+      size_t _pooledBytes;
+      indri::thread::Mutex _statisticsLock;
+      statistics _statistics;
+
+      ReadBufferPool();
+      ~ReadBufferPool();
+
+      static ReadBufferPool& _local();
+      static void _destroy( void* pool );
+
+    public:
+      /// Fills the empty buffer with storage of at least length bytes
+      /// (a megabyte at most) from the calling thread's pool.
+      static void acquire( indri::utility::Buffer& buffer, size_t length );
+
+      /// Takes the storage of buffer back into the calling thread's pool,
+      /// leaving buffer empty.
+      static void release( indri::utility::Buffer& buffer );
+
+      /// Counts summed over the pools of all threads, including those
+      /// that have exited.
+      static statistics counts();
+    };
+  }
+}
+
+#endif // INDRI_READBUFFERPOOL_HPP
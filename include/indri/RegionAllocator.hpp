@@ -53,7 +53,7 @@ namespace indri
           return _malloced.back();
         }
     
-        bytes = (bytes+7) & ~7; // round up
+        bytes = (bytes+15) & ~15; // round up, so that anything can be placed here
     
         if( _buffers.size() && _buffers.back()->remaining() >= bytes ) {
           return _buffers.back()->write( bytes );
@@ -63,6 +63,24 @@ namespace indri
         return allocate( bytes );
       }
 
+      // Releases everything allocated so far; the first buffer is kept
+      // for the next round of allocations.
+      void reset() {
+        if( _buffers.size() > 1 ) {
+          for( size_t i=1; i<_buffers.size(); i++ )
+            delete _buffers[i];
+          _buffers.resize( 1 );
+        }
+
+        if( _buffers.size() )
+          _buffers[0]->clear();
+
+        for( size_t i=0; i<_malloced.size(); i++ )
+          free( _malloced[i] );
+        _malloced.clear();
+        _mallocBytes = 0;
+      }
+
       size_t allocatedBytes() {
         return _buffers.size() * 1024*1024 + _mallocBytes;
       }
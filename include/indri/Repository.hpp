@@ -26,6 +26,7 @@
 #include "indri/DiskIndex.hpp"
 #include "indri/ref_ptr.hpp"
 #include "indri/DeletedDocumentList.hpp"
+#include "indri/TermStatisticsCache.hpp"
 #include <string>
 // 512 -- syslimit can be 1024
 #define MERGE_FILE_LIMIT 768 
@@ -77,6 +78,9 @@ namespace indri
       bool _readOnly;
 
       INT64 _memory;
+      indri::index::DiskIndex::options _indexOptions; /// how the disk indexes are read
+      indri::file::BulkBlockCache* _blockCache; /// dictionary blocks, shared by all indexes
+      TermStatisticsCache _termStatistics; /// term counts, shared by all queries
 
       UINT64 _lastThrashTime;
       volatile bool _thrashing;
@@ -116,6 +120,7 @@ namespace indri
       Repository() {
         _collection = 0;
         _readOnly = false;
+        _blockCache = 0;
         _lastThrashTime = 0;
         _thrashing = false;
         memset( (void*) _documentLoad, 0, sizeof(indri::atomic::value_type)*LOAD_MINUTES*LOAD_MINUTE_FRACTION );
@@ -149,6 +154,19 @@ namespace indri
       /// Indexes in this repository
       index_state indexes();
 
+      /// @return the dictionary block cache shared by the indexes
+      indri::file::BulkBlockCache* blockCache();
+
+      /// @return the term counts of the repository that queries have
+      /// looked up, shared by every QueryEnvironment that queries it
+      TermStatisticsCache& termStatistics();
+
+      /// Look up each term once so its dictionary entry is cached before
+      /// the first query needs it.  Terms are processed (stopped, stemmed)
+      /// the same way query terms are.
+      /// @param terms raw query terms, e.g. from a query log
+      void warmTermCache( const std::vector<std::string>& terms );
+
       /// Notify the repository that a query has happened
       void countQuery();
 
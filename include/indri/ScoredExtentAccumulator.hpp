@@ -20,7 +20,8 @@
 #define INDRI_SCOREDEXTENTACCUMULATOR_HPP
 
 #include "indri/SkippingCapableNode.hpp"
-#include <queue>
+#include "indri/SharedThreshold.hpp"
+#include "indri/TopKSelector.hpp"
 namespace indri
 {
   namespace infnet
@@ -28,10 +29,18 @@ namespace indri
     
     class ScoredExtentAccumulator : public EvaluatorNode {
     private:
+      enum { SHARED_THRESHOLD_POLL = 256 };
+
       BeliefNode* _belief;
       SkippingCapableNode* _skipping;
-      std::priority_queue<indri::api::ScoredExtentResult> _scores;
-      std::vector<indri::api::ScoredExtentResult> _finalScores;
+      SharedThreshold* _sharedThreshold;
+      double _threshold;
+      // candidates evaluated since the shared threshold was last read
+      int _sincePoll;
+      // the last candidate of this accumulator's own query
+      lemur::api::DOCID_T _candidate;
+      indri::utility::TopKSelector _scores;
+      UINT64 _documentsScored;
       int _resultsRequested;
       std::string _name;
       EvaluatorNode::MResults _results;
@@ -40,34 +49,66 @@ namespace indri
       ScoredExtentAccumulator( std::string name, BeliefNode* belief, int resultsRequested = -1 ) :
         _belief(belief),
         _resultsRequested(resultsRequested),
+        _scores(resultsRequested),
+        _documentsScored(0),
         _name(name),
-        _skipping(0)
+        _skipping(0),
+        _sharedThreshold(0),
+        _threshold(-DBL_MAX),
+        _sincePoll(0),
+        _candidate(0)
       {
         if( indri::api::Parameters::instance().get( "skipping", 1 ) )
           _skipping = dynamic_cast<SkippingCapableNode*>(belief);
       }
 
+      // ranges of the same query evaluated in parallel share a threshold
+      void setSharedThreshold( SharedThreshold* sharedThreshold ) {
+        _sharedThreshold = sharedThreshold;
+      }
+
       void evaluate( lemur::api::DOCID_T documentID, int documentLength ) {
+        // in a batch the network stops at the candidates of every query;
+        // this query's own candidate says nothing before it can score
+        if( documentID < _candidate )
+          return;
+
         if( _belief->hasMatch( documentID ) ) {
           indri::index::Extent docExtent(0, documentLength);
+          _documentsScored++;
           const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& documentScores = _belief->score( documentID, docExtent, documentLength );
 
+          // whole documents are scored, so a result needs only its
+          // score, document and length until the final list is built
           for( size_t i=0; i<documentScores.size(); i++ ) {
-            _scores.push( documentScores[i] );
-          }
-
-          while( int(_scores.size()) > _resultsRequested && _resultsRequested > 0 ) {
-            _scores.pop();
-            if( _skipping ) {
-              double worstScore = _scores.top().score;
+            if( _scores.push( documentScores[i].score, documentID, documentScores[i].end ) && _skipping && _scores.full() ) {
+              double worstScore = _scores.threshold();
+              if( _sharedThreshold ) {
+                worstScore = _sharedThreshold->raise( worstScore );
+                _sincePoll = 0;
+              }
+              _threshold = worstScore;
               _skipping->setThreshold( worstScore - DBL_MIN );
             }
           }
         }
+
+        // another range may have found better documents; that is
+        // checked every so many candidates, not for every one
+        if( _skipping && _sharedThreshold && ++_sincePoll >= SHARED_THRESHOLD_POLL ) {
+          double shared = _sharedThreshold->value();
+          _sincePoll = 0;
+
+          if( shared > _threshold ) {
+            _threshold = shared;
+            _skipping->setThreshold( _threshold - DBL_MIN );
+          }
+        }
       }
   
       lemur::api::DOCID_T nextCandidateDocument() {
-        return _belief->nextCandidateDocument();
+        _candidate = _belief->nextCandidateDocument();
+        return _candidate;
       }
 
       const std::string& getName() const {
@@ -80,23 +121,19 @@ namespace indri
         if( !_scores.size() )
           return _results;
     
-        // making a copy of the heap here so the method can be const
-        std::priority_queue<indri::api::ScoredExtentResult> heapCopy = _scores;
-        std::vector<indri::api::ScoredExtentResult>& scoreVec = _results["scores"];
-
         // puts scores into the vector in descending order
-        scoreVec.reserve( heapCopy.size() );
-        for( int i=heapCopy.size()-1; i>=0; i-- ) {
-          scoreVec.push_back( heapCopy.top() );
-          heapCopy.pop();
-        }
-
+        _scores.results( _results["scores"] );
         return _results;
       }
 
       void indexChanged( indri::index::Index& index ) {
         // do nothing
       }
+
+      void addCounters( indri::utility::QueryCounters& counters ) {
+        counters.documentsScored += _documentsScored;
+        counters.heapInsertions += _scores.insertions();
+      }
     };
   }
 }
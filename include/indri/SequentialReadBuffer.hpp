@@ -21,6 +21,8 @@
 #include "indri/indri-platform.h"
 #include "indri/File.hpp"
 #include "indri/InternalFileBuffer.hpp"
+#include "indri/ArenaObject.hpp"
+#include "indri/ReadBufferPool.hpp"
 #include "lemur/Exception.hpp"
 
 namespace indri
@@ -28,38 +30,100 @@ namespace indri
   namespace file
   {
     
-    class SequentialReadBuffer {
+    //
+    // Reads either go through a private buffer that is refilled from the
+    // file, or, when the buffer is built over a MemoryMappedFile region,
+    // return pointers straight into the mapping without copying.
+    //
+
+    class SequentialReadBuffer : public indri::utility::ArenaObject {
     private:
       File& _file;
       UINT64 _position;
       InternalFileBuffer _current;
 
+      const char* _mapping;
+      UINT64 _mappingLength;
+
+      // the buffer is borrowed from a ReadBufferPool
+      bool _pooled;
+
+      // bytes read from the file or the mapping
+      UINT64 _bytesRead;
+
     public:
       SequentialReadBuffer( File& file ) :
         _file(file),
         _position(0),
-        _current( 1024*1024 )
+        _current( 1024*1024 ),
+        _mapping(0),
+        _mappingLength(0),
+        _pooled(false),
+        _bytesRead(0)
       {
       }
 
       SequentialReadBuffer( File& file, size_t length ) :
         _file(file),
         _position(0),
-        _current( length )
+        _current( length ),
+        _mapping(0),
+        _mappingLength(0),
+        _pooled(false),
+        _bytesRead(0)
+      {
+      }
+
+      SequentialReadBuffer( File& file, const char* mapping, UINT64 mappingLength ) :
+        _file(file),
+        _position(0),
+        _current( 0 ),
+        _mapping(mapping),
+        _mappingLength(mappingLength),
+        _pooled(false),
+        _bytesRead(0)
       {
       }
 
+      // The buffer is borrowed from the ReadBufferPool of the calling
+      // thread, and given back to the pool of the thread that deletes
+      // this object.
+      SequentialReadBuffer( File& file, size_t length, bool pooled ) :
+        _file(file),
+        _position(0),
+        _current( pooled ? 0 : length ),
+        _mapping(0),
+        _mappingLength(0),
+        _pooled(pooled),
+        _bytesRead(0)
+      {
+        if( _pooled )
+          ReadBufferPool::acquire( _current.buffer, length );
+      }
+
+      ~SequentialReadBuffer() {
+        if( _pooled )
+          ReadBufferPool::release( _current.buffer );
+      }
+
       void cache( UINT64 position, size_t length ) {
+        if( _mapping )
+          return;
+
         _current.buffer.clear();
         _current.filePosition = position;
         _current.buffer.grow( length );
 
         size_t actual = _file.read( _current.buffer.write( length ), _position, length );
         _current.buffer.unwrite( length - actual );
+        _bytesRead += actual;
       }
 
       size_t read( void* buffer, UINT64 position, size_t length ) {
-        if( position >= _current.filePosition && (position + length) <= _current.filePosition + _current.buffer.position() ) {
+        if( _mapping ) {
+          seek( position );
+          return read( buffer, length );
+        } else if( position >= _current.filePosition && (position + length) <= _current.filePosition + _current.buffer.position() ) {
           memcpy( buffer, _current.buffer.front() + position - _current.filePosition, length );
           return length;
         } else {
@@ -75,6 +139,12 @@ namespace indri
 
       const void* peek( size_t length ) {
         const void* result = 0;
+
+        if( _mapping ) {
+          if( _position + length > _mappingLength )
+            LEMUR_THROW(LEMUR_IO_ERROR, "read fewer bytes than expected.");
+          return _mapping + _position;
+        }
       
         if( _position < _current.filePosition || (_position + length) > _current.filePosition + _current.buffer.position() ) {
           // data isn't in the current buffer
@@ -96,6 +166,8 @@ namespace indri
       const void* read( size_t length ) {
         const void* result = peek( length );
         _position += length;
+        if( _mapping )
+          _bytesRead += length;
         return result;
       }
 
@@ -112,6 +184,10 @@ namespace indri
       UINT64 position() {
         return _position;
       }
+
+      UINT64 bytesRead() const {
+        return _bytesRead;
+      }
     };
   
   }
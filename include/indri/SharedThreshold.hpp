@@ -0,0 +1,76 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// SharedThreshold
+//
+// The pruning threshold of a query that is evaluated in several document
+// ranges at once.  Each range keeps its own top k; the score of the k-th
+// best document of any range is a lower bound on the k-th best overall,
+// so every range can skip documents that can't beat the highest such
+// score seen so far.  The threshold only ever goes up.
+//
+
+#ifndef INDRI_SHAREDTHRESHOLD_HPP
+#define INDRI_SHAREDTHRESHOLD_HPP
+
+#include <float.h>
+#include <string.h>
+#include "indri/atomic.hpp"
+
+namespace indri
+{
+  namespace infnet
+  {
+    class SharedThreshold {
+    private:
+      // the bits of the double, so that every range can read and raise
+      // it without taking a lock
+      indri::atomic::word_type _value;
+
+      static UINT64 _word( double value ) {
+        UINT64 word;
+        memcpy( &word, &value, sizeof word );
+        return word;
+      }
+
+      static double _double( UINT64 word ) {
+        double value;
+        memcpy( &value, &word, sizeof value );
+        return value;
+      }
+
+    public:
+      SharedThreshold() : _value(_word(-DBL_MAX)) {}
+
+      double value() const {
+        return _double( indri::atomic::load( _value ) );
+      }
+
+      /// Raises the threshold to score if that is higher
+      /// @return the threshold after the raise
+      double raise( double score ) {
+        UINT64 current = indri::atomic::load( _value );
+
+        while( score > _double( current ) ) {
+          if( indri::atomic::compare_and_swap( _value, current, _word( score ) ) )
+            return score;
+
+          current = indri::atomic::load( _value );
+        }
+
+        return _double( current );
+      }
+    };
+  }
+}
+
+#endif // INDRI_SHAREDTHRESHOLD_HPP
@@ -0,0 +1,142 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// TermAtATimeAccumulator
+//
+// Term-at-a-time evaluation of a bag-of-words query.  Instead of moving
+// all lists through the documents together, each inverted list is read
+// start to finish into a dense score array indexed by document, and the
+// top documents are selected from the array at the end.  Lists are read
+// rarest first.
+//
+// With a posting budget, on an index that has impact-ordered lists (see
+// ImpactListIterator), the query is evaluated score-at-a-time instead:
+// list segments are read across all the terms, the one whose best
+// posting adds the most to a document's score first, until the budget
+// of each index is spent, so every term is read as far as its postings
+// matter (anytime ranking).  Postings outside the docid range of a
+// partitioned query are charged to the budget but not scored, so every
+// partition reads the same postings the whole query would.  On indexes
+// without impact lists the budget is ignored and every list is read.
+//
+// A document gets the same score it would get from a WeightedAndNode of
+// TermFrequencyBeliefNodes: the background score of every term, plus,
+// for every list that contains it, the difference between its score
+// and its background score.
+//
+
+#ifndef INDRI_TERMATATIMEACCUMULATOR_HPP
+#define INDRI_TERMATATIMEACCUMULATOR_HPP
+
+#include "indri/EvaluatorNode.hpp"
+#include "indri/TermScoreFunction.hpp"
+#include "indri/DeletedDocumentList.hpp"
+#include "indri/Index.hpp"
+#include "indri/ImpactListIterator.hpp"
+#include "indri/TopKSelector.hpp"
+#include <vector>
+#include <string>
+
+namespace indri
+{
+  namespace infnet
+  {
+    class TermAtATimeAccumulator : public EvaluatorNode {
+    public:
+      // scores one query term; specialized per model and perturbation policy
+      class term_scorer {
+      public:
+        virtual ~term_scorer() {}
+        // adds the scores of the list's documents in [begin, end)
+        virtual void accumulate( indri::index::DocListIterator* list, indri::index::Index& index,
+                                 lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) = 0;
+        // adds the scores of the segment's decoded documents in [begin, end)
+        virtual void accumulate( const indri::index::ImpactListIterator::Segment& segment, indri::index::Index& index,
+                                 lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) = 0;
+        // what a posting adds to the background score of its document
+        virtual double difference( int count, int documentLength ) = 0;
+        virtual double background( int documentLength ) = 0;
+      };
+
+    private:
+      struct term_type {
+        struct rarest_first {
+          bool operator() ( const term_type& one, const term_type& two ) const {
+            return one.function->getStatistics().documentOccurrences < two.function->getStatistics().documentOccurrences;
+          }
+        };
+
+        std::string term;
+        int listID;
+        indri::query::TermScoreFunction* function;
+        double qtf;
+        term_scorer* scorer;
+      };
+
+      class InferenceNetwork& _network;
+      std::vector<term_type> _terms;
+      std::string _name;
+      int _resultsRequested;
+      UINT64 _postingBudget;
+
+      lemur::api::DOCID_T _documentBase;
+      std::vector<double> _scores;
+      std::vector<char> _seen;
+      std::vector<lemur::api::DOCID_T> _touched;
+
+      indri::utility::TopKSelector _top;
+      UINT64 _documentsScored;
+      EvaluatorNode::MResults _results;
+
+      // counters of the impact lists read so far
+      indri::utility::QueryCounters _listCounters;
+
+      void _accumulateLists( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+      bool _accumulateImpacts( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+
+    public:
+      TermAtATimeAccumulator( const std::string& name, class InferenceNetwork& network, int resultsRequested, UINT64 postingBudget );
+      ~TermAtATimeAccumulator();
+
+      // listID is -1 for a term that has no inverted list
+      void addTerm( const std::string& term, int listID, indri::query::TermScoreFunction& function, double qtf );
+
+      // adds the posting's score difference to the dense array; called by term scorers
+      inline void add( lemur::api::DOCID_T documentID, double difference ) {
+        size_t index = documentID - _documentBase;
+
+        if( !_seen[index] ) {
+          _seen[index] = 1;
+          _touched.push_back( documentID );
+        }
+
+        _scores[index] += difference;
+      }
+
+      // scores the documents of the index in [begin, end)
+      void evaluateIndex( indri::index::Index& index, indri::index::DeletedDocumentList::read_transaction* deleted,
+                          lemur::api::DOCID_T begin, lemur::api::DOCID_T end );
+
+      // EvaluatorNode interface; this node is never asked for candidates
+      void evaluate( lemur::api::DOCID_T documentID, int documentLength );
+      lemur::api::DOCID_T nextCandidateDocument();
+      void indexChanged( indri::index::Index& index );
+      const EvaluatorNode::MResults& getResults();
+      const std::string& getName() const;
+      void addCounters( indri::utility::QueryCounters& counters );
+    };
+  }
+}
+
+#endif // INDRI_TERMATATIMEACCUMULATOR_HPP
+
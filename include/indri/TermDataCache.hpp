@@ -0,0 +1,174 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermDataCache
+//
+// Bounded cache of decoded term dictionary entries, keyed both by term
+// string and by term ID, shared by every thread that queries a
+// DiskIndex.  Each key space is split into shards with their own lock
+// so that concurrent queries rarely contend; within a shard, eviction
+// uses the CLOCK (second chance) policy, which keeps frequently used
+// terms resident without moving anything on a hit.
+//
+// Entries are complete: they carry the term ID, the term string and
+// the inverted list offsets, whichever key they were looked up with.
+// find() returns a private copy that the caller releases with
+// disktermdata_delete, like the result of disktermdata_decompress.
+//
+
+#ifndef INDRI_TERMDATACACHE_HPP
+#define INDRI_TERMDATACACHE_HPP
+
+#include <vector>
+#include "indri/DiskTermData.hpp"
+#include "indri/HashTable.hpp"
+#include "indri/Mutex.hpp"
+#include "indri/ScopedLock.hpp"
+#include "lemur/IndexTypes.hpp"
+
+namespace indri
+{
+  namespace index
+  {
+    class TermDataCache {
+    public:
+      enum { SHARDS = 16 };
+
+    private:
+      template<class _Key>
+      class shard {
+      private:
+        struct slot {
+          _Key key;
+          DiskTermData* data;
+          bool referenced;
+        };
+
+        indri::thread::Mutex _lock;
+        indri::utility::HashTable<_Key, size_t> _index;
+        std::vector<slot> _slots;
+        size_t _capacity;
+        size_t _hand;
+
+      public:
+        shard() : _index( 4096 ), _capacity(0), _hand(0) {}
+
+        ~shard() {
+          clear();
+        }
+
+        void setCapacity( size_t capacity ) {
+          indri::thread::ScopedLock lock( _lock );
+          _capacity = capacity;
+          _slots.reserve( capacity );
+        }
+
+        DiskTermData* find( const _Key& key, int fieldCount ) {
+          indri::thread::ScopedLock lock( _lock );
+          size_t* position = _index.find( key );
+
+          if( !position )
+            return 0;
+
+          slot& s = _slots[*position];
+          s.referenced = true;
+          return TermDataCache::copy( s.data, fieldCount );
+        }
+
+        void insert( const _Key& key, DiskTermData* data ) {
+          indri::thread::ScopedLock lock( _lock );
+
+          if( _capacity == 0 ) {
+            disktermdata_delete( data );
+            return;
+          }
+
+          if( _index.find( key ) ) {
+            disktermdata_delete( data );
+            return;
+          }
+
+          size_t position;
+
+          if( _slots.size() < _capacity ) {
+            position = _slots.size();
+            _slots.push_back( slot() );
+          } else {
+            // sweep the clock hand past recently used entries
+            while( _slots[_hand].referenced ) {
+              _slots[_hand].referenced = false;
+              _hand = (_hand + 1) % _slots.size();
+            }
+
+            position = _hand;
+            _hand = (_hand + 1) % _slots.size();
+
+            _index.remove( _slots[position].key );
+            disktermdata_delete( _slots[position].data );
+          }
+
+          slot& s = _slots[position];
+          s.key = key;
+          s.data = data;
+          s.referenced = false;
+          _index.insert( key, position );
+        }
+
+        void clear() {
+          indri::thread::ScopedLock lock( _lock );
+
+          for( size_t i=0; i<_slots.size(); i++ )
+            disktermdata_delete( _slots[i].data );
+
+          _slots.clear();
+          _index.clear();
+          _hand = 0;
+        }
+
+        size_t size() {
+          indri::thread::ScopedLock lock( _lock );
+          return _slots.size();
+        }
+      };
+
+      // keyed by the term string inside the entry each slot holds, so a
+      // lookup compares against the caller's string without copying it
+      shard<const char*> _strings[SHARDS];
+      shard<lemur::api::TERMID_T> _ids[SHARDS];
+      int _fieldCount;
+
+      static size_t _stringShard( const char* term );
+      static size_t _idShard( lemur::api::TERMID_T termID );
+
+    public:
+      TermDataCache();
+
+      /// @param capacity the number of terms to keep; 0 turns the cache off
+      /// @param fieldCount the number of fields in each entry
+      void open( size_t capacity, int fieldCount );
+      void close();
+
+      DiskTermData* find( const char* term );
+      DiskTermData* find( lemur::api::TERMID_T termID );
+
+      /// Adds a term; the data must hold the term ID and the term string.
+      void insert( const DiskTermData* data );
+
+      size_t size();
+
+      /// @return a copy of data in a single block of just the right size
+      static DiskTermData* copy( const DiskTermData* data, int fieldCount );
+    };
+  }
+}
+
+#endif // INDRI_TERMDATACACHE_HPP
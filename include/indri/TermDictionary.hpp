@@ -0,0 +1,93 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermDictionary
+//
+// Memory-resident copy of the term dictionary of a DiskIndex, loaded
+// from the frequentString and infrequentString B-trees when the index is
+// opened.  Terms live in one string arena with fixed-width records
+// beside them; an open-addressing hash table maps a term to its record
+// and a dense array maps a term ID to its record.  A lookup costs a hash
+// probe or two and a string compare: no I/O, no locks, no allocation.
+// Once loaded the dictionary is read-only, so any number of threads can
+// use it.
+//
+
+#ifndef INDRI_TERMDICTIONARY_HPP
+#define INDRI_TERMDICTIONARY_HPP
+
+#include <vector>
+#include "indri/BulkTree.hpp"
+#include "lemur/IndexTypes.hpp"
+
+namespace indri
+{
+  namespace index
+  {
+    class TermDictionary {
+    public:
+      struct entry {
+        lemur::api::TERMID_T termID;
+        UINT32 termOffset;
+        UINT64 startOffset;
+        UINT64 length;
+        UINT64 totalCount;
+        UINT32 documentCount;
+      };
+
+    private:
+      struct field_entry {
+        UINT64 totalCount;
+        UINT32 documentCount;
+      };
+
+      std::vector<entry> _entries;
+      std::vector<field_entry> _fields;
+      std::vector<char> _strings;
+
+      // both hold an entry index plus one; zero marks an empty slot
+      std::vector<UINT32> _slots;
+      std::vector<UINT32> _ids;
+
+      int _fieldCount;
+
+      static UINT64 _hash( const char* term );
+      void _add( indri::file::BulkTreeReader& tree, int termBase );
+      void _buildIndexes();
+
+    public:
+      TermDictionary();
+
+      /// Reads every term of both string trees.  Terms in the infrequent
+      /// tree have IDs relative to infrequentBase.
+      void load( indri::file::BulkTreeReader& frequent, indri::file::BulkTreeReader& infrequent,
+                 int infrequentBase, int fieldCount );
+      void clear();
+
+      bool loaded() const { return _slots.size() > 0; }
+
+      const entry* find( const char* term ) const;
+      const entry* find( lemur::api::TERMID_T termID ) const;
+
+      const char* term( const entry& e ) const { return &_strings[e.termOffset]; }
+
+      /// @param field field number, starting at 1 as in DiskIndex::field
+      UINT64 fieldTotalCount( const entry& e, int field ) const;
+      UINT64 fieldDocumentCount( const entry& e, int field ) const;
+
+      /// @return bytes held by the dictionary
+      UINT64 memorySize() const;
+    };
+  }
+}
+
+#endif // INDRI_TERMDICTIONARY_HPP
@@ -23,13 +23,14 @@
 #include "indri/TermScoreFunction.hpp"
 #include "indri/BeliefNode.hpp"
 #include "indri/DocListIterator.hpp"
+#include "lemur/lemur-compat.hpp"
 namespace indri
 {
   namespace infnet
   {
     
     class TermFrequencyBeliefNode : public BeliefNode {
-    private:
+    protected:
       class InferenceNetwork& _network;
       indri::query::TermScoreFunction& _function;
       indri::utility::greedy_vector<indri::api::ScoredExtentResult> _extents;
@@ -41,8 +42,36 @@ namespace indri
       int _listID;
       double _qtf;
 
+      // a list read by several queries is moved only by the network, to
+      // the first candidate of any of them; advance() just raises _floor,
+      // below which this node's query has nothing to score
+      bool _sharedList;
+      lemur::api::DOCID_T _floor;
+
+      // the list hasn't reached _floor yet, so the current entry and its
+      // block say nothing about the documents this node still needs
+      bool _behindFloor();
+
+      // a list that decodes in blocks and isn't shared is read straight
+      // from the decoded arrays: the node keeps its own place in the
+      // block and only calls the list to get the next one.  The network
+      // moves such lists through advance() (see
+      // InferenceNetwork::driveDocIterator).  _block.documents is null
+      // once the list is finished.
+      bool _blockReading;
+      indri::index::DocListIterator::DocumentBlock _block;
+      int _blockIndex;
+
+      void _readBlock();
+      void _advanceBlock( lemur::api::DOCID_T documentID );
+
       indri::utility::greedy_vector<indri::index::DocListIterator::TopDocument> _emptyTopdocs;
 
+      // scores the current document with the model kernel _Model (see TermScoreModels.hpp)
+      // under perturbation policy _Pertube (see PertubePolicy.hpp)
+      template<class _Model, class _Pertube>
+      const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& _score( const _Model& model, lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength );
+
     public:
       TermFrequencyBeliefNode( const std::string& name,
                                class InferenceNetwork& network,
@@ -50,11 +79,41 @@ namespace indri
                                indri::query::TermScoreFunction& scoreFunction,
                                double qtf );
 
-      ~TermFrequencyBeliefNode();
+      virtual ~TermFrequencyBeliefNode();
+
+      // returns a node whose score() is specialized for the retrieval model
+      // and the perturbation type of scoreFunction; the choice is made once, here
+      static TermFrequencyBeliefNode* create( const std::string& name,
+                                              class InferenceNetwork& network,
+                                              int listID,
+                                              indri::query::TermScoreFunction& scoreFunction,
+                                              double qtf );
 
       const indri::utility::greedy_vector<indri::index::DocListIterator::TopDocument>& topdocs() const;
       lemur::api::DOCID_T nextCandidateDocument();
       void indexChanged( indri::index::Index& index );
+
+      // moves the list to the first document >= documentID without scoring
+      // anything in between; used by WeightedAndNode to skip lists that
+      // cannot lift a document over the threshold.  A shared list stays
+      // where it is, and nextCandidateDocument() reports documentID until
+      // the network moves the list past it.
+      inline void advance( lemur::api::DOCID_T documentID ) {
+        if( _blockReading ) {
+          if( _blockIndex < _block.size && _block.documents[_blockIndex] >= documentID )
+            return;
+          _advanceBlock( documentID );
+        } else if( _sharedList ) {
+          _floor = lemur_compat::max( _floor, documentID );
+        } else if( _list ) {
+          _list->nextEntry( documentID );
+        }
+      }
+      // upper bound on the score of the documents from the current one
+      // through blockLastDocument()
+      double blockMaximumScore();
+      lemur::api::DOCID_T blockLastDocument();
+
       double maximumBackgroundScore();
       double maximumScore();
       const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& score( lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength );
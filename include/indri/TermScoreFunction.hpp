@@ -15,35 +15,71 @@
 //
 // 23 January 2004 -- tds
 //
+// Scores one query term with the model selected for the query.  The
+// virtual interface is meant for code that scores a handful of values
+// (bounds, terms missing from the index); per-posting scoring uses the
+// model kernel of a ModelTermScoreFunction directly.
+//
 
 #ifndef INDRI_TERMSCOREFUNCTION_HPP
 #define INDRI_TERMSCOREFUNCTION_HPP
 
-#include <string>
-#include <map>
+#include "indri/ModelParameters.hpp"
+#include "indri/TermScoreModels.hpp"
+#include "indri/ArenaObject.hpp"
 
 namespace indri
 {
   namespace query
   {
-    class TermScoreFunction {
+    class TermScoreFunction : public indri::utility::ArenaObject {
+    protected:
+      TermStatistics _statistics;
+      ModelParameters _parameters;
+
+    public:
+      TermScoreFunction( const TermStatistics& statistics, const ModelParameters& parameters );
+      virtual ~TermScoreFunction();
+
+      virtual double scoreOccurrence( double occurrences, int contextLength, double qtf, double docUniqueTerms ) = 0;
+      virtual double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) = 0;
+      virtual double maximumBackgroundScore( double qtf ) = 0;
+      virtual double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) = 0;
+
+      const TermStatistics& getStatistics() const { return _statistics; }
+      const ModelParameters& getModelParameters() const { return _parameters; }
+      double getQueryLength() const { return _statistics.queryLength; }
+    };
+
+    template<class _Model>
+    class ModelTermScoreFunction : public TermScoreFunction {
     private:
-      double _collectionOccurence;
-      double _collectionSize;
-      double _documentOccurrences;
-      double _documentCount;
-      double _avdl;
-      double _queryLength;
-      std::map<std::string, double> _modelParas;
-
-      void _preCompute();
+      _Model _model;
+
     public:
-      TermScoreFunction( double collectionOccurence, double collectionSize, 
-          double documentOccurrences, double documentCount, double avdl, 
-          double queryLength, std::map<std::string, double>& paras );
-      double scoreOccurrence( double occurrences, int contextLength, double qtf, double docUniqueTerms );
-      const std::map<std::string, double> getModelParas() { return _modelParas; }
-      const double getQueryLength() { return _queryLength; }
+      ModelTermScoreFunction( const TermStatistics& statistics, const ModelParameters& parameters ) :
+        TermScoreFunction( statistics, parameters )
+      {
+        _model.prepare( _statistics, _parameters );
+      }
+
+      const _Model& model() const { return _model; }
+
+      double scoreOccurrence( double occurrences, int contextLength, double qtf, double docUniqueTerms ) {
+        return _model.score( occurrences, contextLength, qtf, docUniqueTerms );
+      }
+
+      double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) {
+        return _model.maximumScore( maximumFraction, maximumDocumentLength, qtf );
+      }
+
+      double maximumBackgroundScore( double qtf ) {
+        return _model.maximumBackgroundScore( qtf );
+      }
+
+      double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) {
+        return _model.blockMaximumScore( maxCount, minLength, maxFraction, qtf );
+      }
     };
   }
 }
@@ -0,0 +1,48 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// TermScoreFunctionFactory
+//
+// Registry of the retrieval models in TermScoreModels.hpp.  A model is
+// chosen per query with the "method" key of the rule parameter, e.g.
+//
+//   <rule>method:okapi,k1:1.2,b:0.75</rule>
+//
+// Recognized names: dirichlet (dir, d; the default), okapi (bm25),
+// jm (jelinek-mercer, linear), pl2, f2exp.
+//
+
+#ifndef INDRI_TERMSCOREFUNCTIONFACTORY_HPP
+#define INDRI_TERMSCOREFUNCTIONFACTORY_HPP
+
+#include <string>
+#include "indri/TermScoreFunction.hpp"
+
+namespace indri
+{
+  namespace query
+  {
+    class TermScoreFunctionFactory {
+    public:
+      // returns the model::Type for a method name; throws on unknown names
+      static int modelType( const std::string& name );
+      static const char* modelName( int type );
+
+      // the function is placed in allocator, if not 0
+      static TermScoreFunction* get( const TermStatistics& statistics, const ModelParameters& parameters, indri::utility::RegionAllocator* allocator = 0 );
+    };
+  }
+}
+
+#endif // INDRI_TERMSCOREFUNCTIONFACTORY_HPP
+
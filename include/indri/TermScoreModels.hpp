@@ -0,0 +1,309 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// TermScoreModels
+//
+// Per-posting scoring kernels for the retrieval models that can be
+// selected with the "method" key of the rule parameter.  Each model is
+// a plain struct: prepare() folds the term statistics and the model
+// parameters into constants once per query term, and score() is an
+// inline, non-virtual function of (count, documentLength, qtf,
+// docUniqueTerms) that scoring nodes are instantiated against.
+// docUniqueTerms is the number of distinct terms in the document, as
+// stored in the posting (see DOC_UNIQUE_TERM_COUNTS); it is 0 when the
+// document has no posting for the term.  The models below don't use it.
+//
+// maximumScore() and maximumBackgroundScore() give upper bounds used
+// for pruning; they need to hold for every document in the list, so a
+// model that uses docUniqueTerms has to bound over it as well.
+// blockMaximumScore() bounds the documents of one skip block from its
+// summary (largest count, shortest length, largest count/length).
+//
+
+#ifndef INDRI_TERMSCOREMODELS_HPP
+#define INDRI_TERMSCOREMODELS_HPP
+
+#include <cmath>
+#include <float.h>
+#include "indri/ModelParameters.hpp"
+
+namespace indri
+{
+  namespace query
+  {
+    struct TermStatistics {
+      double collectionOccurrence;
+      double collectionSize;
+      double documentOccurrences;
+      double documentCount;
+      double avdl;
+      double queryLength;
+    };
+
+    namespace model
+    {
+      // <cmath> defines M_PI and friends only on some platforms (not
+      // MSVC without _USE_MATH_DEFINES), so the models use their own
+      const double PI = 3.14159265358979323846;
+      const double LN2 = 0.69314718055994530942;
+      const double LOG2E = 1.4426950408889634074;
+
+      enum Type {
+        DIRICHLET = 0,
+        OKAPI = 1,
+        JELINEK_MERCER = 2,
+        PL2 = 3,
+        F2EXP = 4
+      };
+
+      inline double collectionProbability( const TermStatistics& s ) {
+        return s.collectionOccurrence ? (s.collectionOccurrence/s.collectionSize) : (1.0 / s.collectionSize*2.);
+      }
+
+      //
+      // Block bound for models whose score grows with count and shrinks
+      // with length.  A document in the block has count <= maxCount,
+      // length >= minLength and length >= count/maxFraction; along that
+      // boundary the score peaks either at the largest count or at the
+      // shortest length.
+      //
+
+      template<class _Model>
+      double monotoneBlockMaximumScore( const _Model& model, int maxCount, int minLength, double maxFraction, double qtf ) {
+        double longest = floor( double(maxCount) / maxFraction );
+        int length = longest > minLength ? int(longest) : minLength;
+        double atMaxCount = model.score( maxCount, length, qtf, 0 );
+
+        double shortestCount = ceil( double(minLength) * maxFraction );
+        if( shortestCount > maxCount )
+          shortestCount = maxCount;
+        double atMinLength = model.score( shortestCount, minLength, qtf, 0 );
+
+        return atMaxCount > atMinLength ? atMaxCount : atMinLength;
+      }
+
+      //
+      // Dirichlet prior smoothing: log( (tf + mu*P(t|C)) / (dl + mu) )
+      //
+
+      struct DirichletModel {
+        static const char* name() { return "dirichlet"; }
+
+        double mu;
+        double muTimesCollectionFrequency;
+
+        void prepare( const TermStatistics& s, const ModelParameters& p ) {
+          mu = p.mu;
+          muTimesCollectionFrequency = mu * collectionProbability( s );
+        }
+
+        inline double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+          return log( ( occurrences + muTimesCollectionFrequency ) / ( double(documentLength) + mu ) );
+        }
+
+        double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) const {
+          return score( ceil( double(maximumDocumentLength) * maximumFraction ), maximumDocumentLength, qtf, 0 );
+        }
+
+        double maximumBackgroundScore( double qtf ) const {
+          return score( 0, 1, qtf, 0 );
+        }
+
+        double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) const {
+          return monotoneBlockMaximumScore( *this, maxCount, minLength, maxFraction, qtf );
+        }
+      };
+
+      //
+      // Okapi BM25, with the RSJ idf and the k3 query term weight.
+      //
+
+      struct OkapiModel {
+        static const char* name() { return "okapi"; }
+
+        double idf;
+        double k3;
+        double idfTimesK1PlusOne;
+        double k1TimesOneMinusB;
+        double k1TimesBOverAvgDocLength;
+
+        void prepare( const TermStatistics& s, const ModelParameters& p ) {
+          idf = log( ( s.documentCount - s.documentOccurrences + 0.5 ) / ( s.documentOccurrences + 0.5 ) );
+          k3 = p.k3;
+          idfTimesK1PlusOne = idf * ( p.k1 + 1 );
+          k1TimesOneMinusB = p.k1 * ( 1 - p.b );
+          k1TimesBOverAvgDocLength = p.k1 * p.b / s.avdl;
+        }
+
+        inline double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+          double termWeight = ( k3 + 1 ) * qtf / ( k3 + qtf );
+          double numerator = idfTimesK1PlusOne * occurrences * termWeight;
+          double denominator = occurrences + k1TimesOneMinusB + k1TimesBOverAvgDocLength * documentLength;
+          return numerator / denominator;
+        }
+
+        // with tf <= maximumFraction * dl the tf component grows with dl,
+        // so the bound is reached at the longest document; a negative idf
+        // makes every score negative
+        double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) const {
+          if( idf <= 0 )
+            return 0;
+          return score( ceil( double(maximumDocumentLength) * maximumFraction ), maximumDocumentLength, qtf, 0 );
+        }
+
+        double maximumBackgroundScore( double qtf ) const {
+          return 0;
+        }
+
+        double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) const {
+          if( idf <= 0 )
+            return 0;
+          return monotoneBlockMaximumScore( *this, maxCount, minLength, maxFraction, qtf );
+        }
+      };
+
+      //
+      // Jelinek-Mercer smoothing: log( (1-lambda)*tf/dl + lambda*P(t|C) )
+      //
+
+      struct JelinekMercerModel {
+        static const char* name() { return "jm"; }
+
+        double oneMinusLambda;
+        double lambdaTimesCollectionFrequency;
+
+        void prepare( const TermStatistics& s, const ModelParameters& p ) {
+          oneMinusLambda = 1 - p.lambda;
+          lambdaTimesCollectionFrequency = p.lambda * collectionProbability( s );
+        }
+
+        inline double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+          double foreground = documentLength ? oneMinusLambda * occurrences / double(documentLength) : 0;
+          return log( foreground + lambdaTimesCollectionFrequency );
+        }
+
+        double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) const {
+          return score( ceil( double(maximumDocumentLength) * maximumFraction ), maximumDocumentLength, qtf, 0 );
+        }
+
+        double maximumBackgroundScore( double qtf ) const {
+          return log( lambdaTimesCollectionFrequency );
+        }
+
+        double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) const {
+          return monotoneBlockMaximumScore( *this, maxCount, minLength, maxFraction, qtf );
+        }
+      };
+
+      //
+      // PL2 (Amati and van Rijsbergen): Poisson randomness with Laplace
+      // after-effect and length normalization 2.
+      //
+
+      struct PL2Model {
+        static const char* name() { return "pl2"; }
+
+        double cTimesAvdl;
+        double lambda;
+        double log2Lambda;
+
+        void prepare( const TermStatistics& s, const ModelParameters& p ) {
+          cTimesAvdl = p.c * s.avdl;
+          lambda = s.collectionOccurrence ? ( s.collectionOccurrence / s.documentCount ) : ( 1.0 / s.documentCount );
+          log2Lambda = log( lambda ) / LN2;
+        }
+
+        inline double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+          if( occurrences <= 0 )
+            return 0;
+
+          double tfn = occurrences * log( 1 + cTimesAvdl / double(documentLength) ) / LN2;
+          double log2Tfn = log( tfn ) / LN2;
+          double information = tfn * ( log2Tfn - log2Lambda ) +
+                               ( lambda - tfn ) * LOG2E +
+                               0.5 * ( log( 2 * PI ) / LN2 + log2Tfn );
+          return qtf * information / ( tfn + 1 );
+        }
+
+        // the information term is not monotone in tf or dl; don't prune
+        double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) const {
+          return DBL_MAX;
+        }
+
+        double maximumBackgroundScore( double qtf ) const {
+          return 0;
+        }
+
+        double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) const {
+          return DBL_MAX;
+        }
+      };
+
+      //
+      // F2EXP (Fang and Zhai, axiomatic retrieval):
+      //   qtf * ((N+1)/df)^k * tf / (tf + s + s*dl/avdl)
+      //
+
+      struct F2EXPModel {
+        static const char* name() { return "f2exp"; }
+
+        double s;
+        double sOverAvgDocLength;
+        double idf;
+
+        void prepare( const TermStatistics& t, const ModelParameters& p ) {
+          double documentOccurrences = t.documentOccurrences > 0 ? t.documentOccurrences : 1;
+          s = p.s;
+          sOverAvgDocLength = p.s / t.avdl;
+          idf = pow( ( t.documentCount + 1 ) / documentOccurrences, p.k );
+        }
+
+        inline double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+          return qtf * idf * occurrences / ( occurrences + s + sOverAvgDocLength * documentLength );
+        }
+
+        // same shape as Okapi: the bound is reached at the longest document
+        double maximumScore( double maximumFraction, int maximumDocumentLength, double qtf ) const {
+          return score( ceil( double(maximumDocumentLength) * maximumFraction ), maximumDocumentLength, qtf, 0 );
+        }
+
+        double maximumBackgroundScore( double qtf ) const {
+          return 0;
+        }
+
+        double blockMaximumScore( int maxCount, int minLength, double maxFraction, double qtf ) const {
+          return monotoneBlockMaximumScore( *this, maxCount, minLength, maxFraction, qtf );
+        }
+      };
+
+      //
+      // Calls _Visitor::template apply<Model>() for the model that matches
+      // the model type.  Like pertube::dispatch, this runs once per query
+      // term; unknown types fall back to Dirichlet.
+      //
+
+      template<class _Visitor>
+      typename _Visitor::result_type dispatch( int type, _Visitor& visitor ) {
+        switch( type ) {
+          case OKAPI:          return visitor.template apply<OkapiModel>();
+          case JELINEK_MERCER: return visitor.template apply<JelinekMercerModel>();
+          case PL2:            return visitor.template apply<PL2Model>();
+          case F2EXP:          return visitor.template apply<F2EXPModel>();
+          default:             return visitor.template apply<DirichletModel>();
+        }
+      }
+    }
+  }
+}
+
+#endif // INDRI_TERMSCOREMODELS_HPP
+
@@ -0,0 +1,88 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermStatisticsCache
+//
+// Bounded cache of the collection frequency and document frequency of
+// processed terms in one repository.  A Repository owns one, so every
+// QueryEnvironment querying the repository (one per IndriRunQuery
+// thread) shares what the others have looked up.  Like TermDataCache,
+// the terms are split into shards with their own lock, and each shard
+// evicts with the CLOCK (second chance) policy.
+//
+
+#ifndef INDRI_TERMSTATISTICSCACHE_HPP
+#define INDRI_TERMSTATISTICSCACHE_HPP
+
+#include <vector>
+#include <string>
+#include "indri/HashTable.hpp"
+#include "indri/Mutex.hpp"
+#include "lemur/IndexTypes.hpp"
+
+namespace indri
+{
+  namespace collection
+  {
+    class TermStatisticsCache {
+    public:
+      enum { SHARDS = 16 };
+
+      struct statistics {
+        INT64 termCount;
+        INT64 documentCount;
+      };
+
+    private:
+      class shard {
+      private:
+        struct slot {
+          std::string term;
+          statistics counts;
+          bool referenced;
+        };
+
+        indri::thread::Mutex _lock;
+        indri::utility::HashTable<std::string, size_t> _index;
+        std::vector<slot> _slots;
+        size_t _capacity;
+        size_t _hand;
+
+      public:
+        shard() : _index( 1024 ), _capacity(0), _hand(0) {}
+
+        void setCapacity( size_t capacity );
+        bool find( const std::string& term, statistics& counts );
+        void insert( const std::string& term, const statistics& counts );
+        void clear();
+        size_t size();
+      };
+
+      shard _shards[SHARDS];
+
+      static size_t _shard( const std::string& term );
+
+    public:
+      /// @param capacity the number of terms to keep; 0 turns the cache off
+      void open( size_t capacity );
+      void close();
+
+      /// @return true, with the counts of term, if the term is cached
+      bool find( const std::string& term, statistics& counts );
+      void insert( const std::string& term, const statistics& counts );
+
+      size_t size();
+    };
+  }
+}
+
+#endif // INDRI_TERMSTATISTICSCACHE_HPP
@@ -0,0 +1,162 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// TopKSelector
+//
+// Keeps the best 'limit' scored documents seen so far.  Documents are
+// held as small (score, document, length) entries in a heap with the
+// worst one on top, so a document that can't make the list is turned
+// away by comparing it with the top entry.  The list is sorted once,
+// when the results are read, and only then are ScoredExtentResults
+// built.  Documents are ordered like ScoredExtentResult::score_greater:
+// by score, then by document, so ties at the cutoff are resolved the
+// same way however the documents arrive.
+//
+
+#ifndef INDRI_TOPKSELECTOR_HPP
+#define INDRI_TOPKSELECTOR_HPP
+
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include "indri/ScoredExtentResult.hpp"
+
+namespace indri
+{
+  namespace utility
+  {
+    class TopKSelector {
+    public:
+      struct entry {
+        double score;
+        lemur::api::DOCID_T document;
+        int length;
+
+        bool better( const entry& other ) const {
+          if( score != other.score )
+            return score > other.score;
+          return document > other.document;
+        }
+      };
+
+    private:
+      struct entry_better {
+        bool operator() ( const entry& one, const entry& two ) const {
+          return one.better( two );
+        }
+      };
+
+      // _entries[0] is the worst entry once the list is full
+      std::vector<entry> _entries;
+      size_t _limit;
+      UINT64 _insertions;
+
+      void _siftDown() {
+        size_t size = _entries.size();
+        size_t parent = 0;
+        entry moving = _entries[0];
+
+        while( true ) {
+          size_t child = 2*parent + 1;
+          if( child >= size )
+            break;
+
+          // follow the worse child
+          if( child+1 < size && _entries[child].better( _entries[child+1] ) )
+            child++;
+
+          if( !moving.better( _entries[child] ) )
+            break;
+
+          _entries[parent] = _entries[child];
+          parent = child;
+        }
+
+        _entries[parent] = moving;
+      }
+
+    public:
+      /// A limit of 0 or less keeps every document.
+      TopKSelector( int limit ) :
+        _limit( limit > 0 ? size_t(limit) : 0 ),
+        _insertions(0)
+      {
+        if( _limit )
+          _entries.reserve( _limit );
+      }
+
+      /// True when limit documents are held, so that a document has to
+      /// beat threshold() to get in.
+      bool full() const {
+        return _limit && _entries.size() == _limit;
+      }
+
+      /// The score of the worst document held once the list is full,
+      /// -DBL_MAX before that.
+      double threshold() const {
+        return full() ? _entries[0].score : -DBL_MAX;
+      }
+
+      size_t size() const {
+        return _entries.size();
+      }
+
+      /// The number of documents that were kept when offered, including
+      /// those that were later pushed out.
+      UINT64 insertions() const {
+        return _insertions;
+      }
+
+      /// Offers a document; returns true if it was kept.
+      bool push( double score, lemur::api::DOCID_T document, int length ) {
+        entry e;
+        e.score = score;
+        e.document = document;
+        e.length = length;
+
+        if( !full() ) {
+          _insertions++;
+          _entries.push_back( e );
+          if( full() )
+            std::make_heap( _entries.begin(), _entries.end(), entry_better() );
+          return true;
+        }
+
+        if( !e.better( _entries[0] ) )
+          return false;
+
+        _insertions++;
+        _entries[0] = e;
+        _siftDown();
+        return true;
+      }
+
+      /// Appends the documents held, best first, to results.  Each
+      /// result covers its whole document.
+      void results( std::vector<indri::api::ScoredExtentResult>& results ) const {
+        std::vector<entry> sorted = _entries;
+        std::sort( sorted.begin(), sorted.end(), entry_better() );
+
+        results.reserve( results.size() + sorted.size() );
+        for( size_t i=0; i<sorted.size(); i++ )
+          results.push_back( indri::api::ScoredExtentResult( sorted[i].score, sorted[i].document, 0, sorted[i].length ) );
+      }
+
+      void clear() {
+        _entries.clear();
+      }
+    };
+  }
+}
+
+#endif // INDRI_TOPKSELECTOR_HPP
@@ -28,28 +28,29 @@ namespace indri
 {
   namespace infnet
   {
-    
+    class TermFrequencyBeliefNode;
+
     class WeightedAndNode : public SkippingCapableNode {
     private:
       struct child_type {
-        struct maxscore_less {
-        public:
-          bool operator () ( const child_type& one, const child_type& two ) const {
-            // think of these two elements as the only two elements in the
-            // #wand.  What is the threshold of each ordering?  Sort by
-            // the lowest threshold.
-
-            return (one.backgroundWeightedScore) > 
-              (two.backgroundWeightedScore);
-          }
-        };
-
         BeliefNode* node;
+        TermFrequencyBeliefNode* term;  // node, if it can be advanced directly
         double weight;
         double maximumWeightedScore;
         double backgroundWeightedScore;
       };
 
+      struct pivot_entry {
+        struct document_less {
+          bool operator() ( const pivot_entry& one, const pivot_entry& two ) const {
+            return one.document < two.document;
+          }
+        };
+
+        lemur::api::DOCID_T document;
+        child_type* child;
+      };
+
       std::vector<child_type> _children;
       indri::utility::greedy_vector<indri::api::ScoredExtentResult> _scores;
       indri::utility::greedy_vector<bool> _matches;
@@ -58,14 +59,16 @@ namespace indri
       indri::utility::greedy_vector<lemur::api::DOCID_T> _candidates;
       size_t _candidatesIndex;
 
+      indri::utility::greedy_vector<pivot_entry> _pivots;
+      double _backgroundScoreSum;
       double _threshold;
-      double _recomputeThreshold;
-      int _quorumIndex;
-      void _computeQuorum();
-      double _computeMaxScore( unsigned int start );
+
+      void _computeBounds();
+      double _scoreRange( const child_type& child, double maximumWeightedScore ) const;
+      lemur::api::DOCID_T _nextPivot( lemur::api::DOCID_T limit );
 
     public:
-      WeightedAndNode( const std::string& name ) : _name(name), _threshold(-DBL_MAX), _quorumIndex(0), _recomputeThreshold(-DBL_MAX) {}
+      WeightedAndNode( const std::string& name ) : _name(name), _candidatesIndex(0), _backgroundScoreSum(0), _threshold(-DBL_MAX) {}
 
       void addChild( double weight, BeliefNode* node );
       void doneAddingChildren();
@@ -84,6 +87,7 @@ namespace indri
       indri::utility::greedy_vector<indri::api::ScoredExtentResult>& score( lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength );
       bool hasMatch( lemur::api::DOCID_T documentID );
       const indri::utility::greedy_vector<bool>& hasMatch( lemur::api::DOCID_T documentID, const indri::utility::greedy_vector<indri::index::Extent>& extents );
+      void skipTo( lemur::api::DOCID_T documentID );
       const std::string& getName() const;
     };
   }
@@ -0,0 +1,71 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// WorkerPool
+//
+// A fixed set of threads that run batches of tasks.  run() hands a batch
+// to the pool and works on it too, so a batch always makes progress even
+// when every worker is busy with another caller's batch; it returns when
+// every task in the batch has finished.  If a task throws, the first
+// exception is rethrown from run() once the batch is done.
+//
+
+#ifndef INDRI_WORKERPOOL_HPP
+#define INDRI_WORKERPOOL_HPP
+
+#include <vector>
+#include <queue>
+#include "indri/Thread.hpp"
+#include "indri/Mutex.hpp"
+#include "indri/ConditionVariable.hpp"
+
+namespace indri
+{
+  namespace thread
+  {
+    class WorkerPool {
+    public:
+      class Task {
+      public:
+        virtual ~Task() {}
+        virtual void run() = 0;
+      };
+
+    private:
+      struct batch_type;
+
+      struct job_type {
+        Task* task;
+        batch_type* batch;
+      };
+
+      Mutex _lock;
+      ConditionVariable _work;
+      std::queue<job_type> _jobs;
+      std::vector<Thread*> _threads;
+      volatile bool _quit;
+
+      bool _runOne( bool wait );
+      static void _threadMain( void* pool );
+
+    public:
+      /// Starts threads workers; with none, run() does all the work itself
+      WorkerPool( int threads );
+      ~WorkerPool();
+
+      int threads() const;
+      void run( const std::vector<Task*>& tasks );
+    };
+  }
+}
+
+#endif // INDRI_WORKERPOOL_HPP
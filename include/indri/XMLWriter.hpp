@@ -0,0 +1,45 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// XMLWriter
+//
+// Writes an XMLNode tree as text that XMLReader can read back.
+// XMLReader doesn't decode entities, so values are written as they are.
+//
+
+#ifndef INDRI_XMLWRITER_HPP
+#define INDRI_XMLWRITER_HPP
+
+#include <string>
+#include "indri/XMLNode.hpp"
+
+namespace indri
+{
+  namespace xml
+  {
+    class XMLWriter {
+    private:
+      const XMLNode* _node;
+
+      void _writeTabs( int tabs, std::string& output ) const;
+      void _write( const XMLNode* node, int tabs, std::string& output ) const;
+
+    public:
+      XMLWriter( const XMLNode* node );
+      /// Appends the node and its children to output
+      void write( std::string& output ) const;
+    };
+  }
+}
+
+#endif // INDRI_XMLWRITER_HPP
@@ -18,6 +18,8 @@
 #ifndef INDRI_ATOMIC_HPP
 #define INDRI_ATOMIC_HPP
 
+#include "lemur/lemur-platform.h"
+
 #ifndef WIN32
 #if HAVE_BITS_ATOMICITY_H
 #include <bits/atomicity.h>
@@ -40,6 +42,16 @@ namespace indri {
     inline void decrement( value_type& variable ) {
       ::InterlockedDecrement( &variable );
     }
+
+    typedef volatile LONGLONG word_type;
+
+    inline UINT64 load( const word_type& variable ) {
+      return (UINT64) ::InterlockedCompareExchange64( const_cast<word_type*>(&variable), 0, 0 );
+    }
+
+    inline bool compare_and_swap( word_type& variable, UINT64 expected, UINT64 value ) {
+      return ::InterlockedCompareExchange64( &variable, (LONGLONG) value, (LONGLONG) expected ) == (LONGLONG) expected;
+    }
 #else
     // GCC 3.4+ declares these in the __gnu_cxx namespace, 3.3- does not.
     #if P_NEEDS_GNU_CXX_NAMESPACE
@@ -54,6 +66,21 @@ namespace indri {
     inline void decrement( value_type& variable ) {
       __atomic_add( &variable, -1 );
     }
+
+    // a 64-bit word that is read and replaced whole
+    typedef volatile UINT64 word_type;
+
+    inline UINT64 load( const word_type& variable ) {
+    #ifdef __ATOMIC_ACQUIRE
+      return __atomic_load_n( &variable, __ATOMIC_ACQUIRE );
+    #else
+      return __sync_fetch_and_add( const_cast<word_type*>(&variable), 0 );
+    #endif
+    }
+
+    inline bool compare_and_swap( word_type& variable, UINT64 expected, UINT64 value ) {
+      return __sync_bool_compare_and_swap( &variable, expected, value );
+    }
 #endif
   }
 }
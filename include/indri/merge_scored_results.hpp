@@ -0,0 +1,94 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// merge_scored_results
+//
+// Combines several top-k result lists into one: the best 'limit' results
+// of their union, in ScoredExtentResult::score_greater order.  A heap
+// holds one cursor per list, so the merge costs O(limit log lists) and
+// stops as soon as it has enough results.  Lists are checked first and
+// any that aren't in score_greater order are sorted in place.
+//
+
+#ifndef INDRI_MERGE_SCORED_RESULTS_HPP
+#define INDRI_MERGE_SCORED_RESULTS_HPP
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include "indri/ScoredExtentResult.hpp"
+
+namespace indri
+{
+  namespace utility
+  {
+    struct scored_results_cursor {
+      const std::vector<indri::api::ScoredExtentResult>* list;
+      size_t next;
+
+      // the cursor with the best next result is on top of the heap
+      bool operator< ( const scored_results_cursor& other ) const {
+        return indri::api::ScoredExtentResult::score_greater()( (*other.list)[other.next], (*list)[next] );
+      }
+    };
+
+    inline void sort_scored_results( std::vector<indri::api::ScoredExtentResult>& list ) {
+      indri::api::ScoredExtentResult::score_greater greater;
+
+      for( size_t i=1; i<list.size(); i++ ) {
+        if( greater( list[i], list[i-1] ) ) {
+          std::sort( list.begin(), list.end(), greater );
+          return;
+        }
+      }
+    }
+
+    /// Appends the best limit results of lists to output; a limit of 0
+    /// or less keeps them all.
+    inline void merge_scored_results( std::vector< std::vector<indri::api::ScoredExtentResult>* >& lists,
+                                      int limit,
+                                      std::vector<indri::api::ScoredExtentResult>& output ) {
+      std::priority_queue<scored_results_cursor> heap;
+      size_t total = 0;
+
+      for( size_t i=0; i<lists.size(); i++ ) {
+        sort_scored_results( *lists[i] );
+
+        scored_results_cursor cursor;
+        cursor.list = lists[i];
+        cursor.next = 0;
+        total += cursor.list->size();
+
+        if( cursor.list->size() )
+          heap.push( cursor );
+      }
+
+      if( limit > 0 && total > size_t(limit) )
+        total = size_t(limit);
+      output.reserve( output.size() + total );
+
+      for( size_t taken = 0; taken < total; taken++ ) {
+        scored_results_cursor cursor = heap.top();
+        heap.pop();
+
+        output.push_back( (*cursor.list)[cursor.next] );
+        cursor.next++;
+
+        if( cursor.next < cursor.list->size() )
+          heap.push( cursor );
+      }
+    }
+  }
+}
+
+#endif // INDRI_MERGE_SCORED_RESULTS_HPP
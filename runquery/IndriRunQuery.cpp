@@ -17,6 +17,8 @@
 
 #include <time.h>
 #include "indri/QueryEnvironment.hpp"
+#include "indri/Repository.hpp"
+#include "indri/ReadBufferPool.hpp"
 #include "indri/delete_range.hpp"
 
 #include "indri/Parameters.hpp"
@@ -29,6 +31,9 @@
 #include <vector>
 #include <map>
 #include <queue>
+#include <set>
+#include <fstream>
+#include <algorithm>
 
 static bool copy_parameters_to_string_vector( std::vector<std::string>& vec, indri::api::Parameters p, const std::string& parameterName ) {
   if( !p.exists(parameterName) )
@@ -43,6 +48,14 @@ static bool copy_parameters_to_string_vector( std::vector<std::string>& vec, ind
   return true;
 }
 
+// the scoring rule and perturbation settings of one run
+struct configuration_t {
+  std::string rule; // empty for the rule parameter
+  int pertube_type;
+  std::map<std::string, double> pertube_paras;
+  std::string runID;
+};
+
 struct query_t {
   struct greater {
     bool operator() ( query_t* one, query_t* two ) {
@@ -50,21 +63,18 @@ struct query_t {
     }
   };
 
-  query_t( int _index, std::string _number, const std::string& _text, 
-        const int _pertube_type, std::map<std::string, double>& _pertube_paras) :
+  query_t( int _index, std::string _number, const std::string& _text ) :
     index( _index ),
     number( _number ),
-    text( _text ), 
-    pertube_type(_pertube_type),
-    pertube_paras(_pertube_paras)
+    text( _text )
   {
   }
 
-  query_t( int _index, std::string _number, const std::string& _text ) :
+  query_t( int _index, std::string _number, const std::vector<std::string>& _runs, const std::string& _profile = "" ) :
     index( _index ),
     number( _number ),
-    text( _text ),
-    pertube_type(0)
+    runs( _runs ),
+    profile( _profile )
   {
   }
 
@@ -72,8 +82,10 @@ struct query_t {
   int index;
   std::string text;
   std::string qType;
-  int pertube_type;
-  std::map<std::string, double> pertube_paras;
+  // the output of each configuration
+  std::vector<std::string> runs;
+  // a JSON line, if queries are profiled
+  std::string profile;
 };
 
 class QueryThread : public indri::thread::UtilityThread {
@@ -84,17 +96,37 @@ private:
   std::priority_queue< query_t*, std::vector< query_t* >, query_t::greater >& _output;
 
   indri::api::QueryEnvironment _environment;
+  std::vector< indri::collection::Repository* >& _repositories;
+  std::vector< configuration_t >& _configurations;
   indri::api::Parameters& _parameters;
   int _requested;
-  std::string _runID;
+  bool _profiling;
 
-  std::vector<indri::api::ScoredExtentResult> _results;
+  // the results of each configuration
+  std::vector< std::vector<indri::api::ScoredExtentResult> > _results;
 
-  // Runs the query, expanding it if necessary.  Will print output as well if verbose is on.
-  void _runQuery( std::stringstream& output, const std::string& query,
-                  const int pertube_type, const std::map<std::string, double>& pertube_paras) {
+  // Runs the query under every configuration; several configurations
+  // are evaluated together as one batch.
+  void _runQuery( const std::string& query ) {
     try {
-      _results = _environment.runQuery( query, _requested, pertube_type, pertube_paras );
+      if( _configurations.size() == 1 && _configurations[0].rule.empty() ) {
+        _results.resize( 1 );
+        _results[0] = _environment.runQuery( query, _requested, _configurations[0].pertube_type, _configurations[0].pertube_paras );
+        return;
+      }
+
+      std::vector<std::string> queries( _configurations.size(), query );
+      std::vector<std::string> rules;
+      std::vector<int> pertubeTypes;
+      std::vector< std::map<std::string, double> > pertubeParas;
+
+      for( size_t i=0; i<_configurations.size(); i++ ) {
+        rules.push_back( _configurations[i].rule );
+        pertubeTypes.push_back( _configurations[i].pertube_type );
+        pertubeParas.push_back( _configurations[i].pertube_paras );
+      }
+
+      _results = _environment.runQueryBatch( queries, _requested, rules, pertubeTypes, pertubeParas );
     }
     catch( lemur::api::Exception& e )
     {
@@ -103,40 +135,38 @@ private:
     }
   }
 
-  void _printResultRegion( std::stringstream& output, std::string queryIndex, int start, int end  ) {
-    std::vector<std::string> documentNames;
-    std::vector<indri::api::ParsedDocument*> documents;
+  // a document ranked by several configurations is looked up once
+  void _fetchDocumentNames( std::map<lemur::api::DOCID_T, std::string>& documentNames ) {
+    std::vector<lemur::api::DOCID_T> documentIDs;
 
-    std::vector<indri::api::ScoredExtentResult> resultSubset;
+    for( size_t i=0; i<_results.size(); i++ ) {
+      for( size_t j=0; j<_results[i].size(); j++ )
+        documentIDs.push_back( _results[i][j].document );
+    }
 
-    resultSubset.assign( _results.begin() + start, _results.begin() + end );
+    std::sort( documentIDs.begin(), documentIDs.end() );
+    documentIDs.erase( std::unique( documentIDs.begin(), documentIDs.end() ), documentIDs.end() );
 
-    documentNames = _environment.documentMetadata( resultSubset, "docno" );
+    std::vector<std::string> names = _environment.documentMetadata( documentIDs, "docno" );
 
-    std::vector<std::string> pathNames;
+    for( size_t i=0; i<documentIDs.size(); i++ )
+      documentNames[ documentIDs[i] ] = names[i];
+  }
 
-    // Print results
-    for( size_t i=0; i < resultSubset.size(); i++ ) {
-      int rank = start+i+1;
-      std::string queryNumber = queryIndex;
+  void _printResults( std::stringstream& output, const std::string& queryNumber,
+                      const std::vector<indri::api::ScoredExtentResult>& results,
+                      std::map<lemur::api::DOCID_T, std::string>& documentNames,
+                      const std::string& runID ) {
+    for( size_t i=0; i < results.size(); i++ ) {
+      int rank = i+1;
 
       // TREC formatted output: queryNumber, Q0, documentName, rank, score, runID
       output << queryNumber << " "
               << "Q0 "
-              << documentNames[i] << " "
+              << documentNames[ results[i].document ] << " "
               << rank << " "
-              << resultSubset[ i ].score << " "
-              << _runID << std::endl;
-
-      if( documents.size() )
-        delete documents[i];
-    }
-  }
-
-  void _printResults( std::stringstream& output, std::string queryNumber ) {
-    for( size_t start = 0; start < _results.size(); start += 50 ) {
-      size_t end = std::min<size_t>( start + 50, _results.size() );
-      _printResultRegion( output, queryNumber, start, end );
+              << results[i].score << " "
+              << runID << std::endl;
     }
   }
 
@@ -146,12 +176,17 @@ public:
                std::priority_queue< query_t*, std::vector< query_t* >, query_t::greater >& output,
                indri::thread::Lockable& queueLock,
                indri::thread::ConditionVariable& queueEvent,
+               std::vector< indri::collection::Repository* >& repositories,
+               std::vector< configuration_t >& configurations,
                indri::api::Parameters& params ) :
     _queries(queries),
     _output(output),
     _queueLock(queueLock),
     _queueEvent(queueEvent),
-    _parameters(params)
+    _repositories(repositories),
+    _configurations(configurations),
+    _parameters(params),
+    _profiling(false)
   {
   }
 
@@ -170,21 +205,19 @@ public:
     if( copy_parameters_to_string_vector( smoothingRules, _parameters, "rule" ) )
       _environment.setScoringRules( smoothingRules );
 
-   if( _parameters.exists( "index" ) ) {
-      indri::api::Parameters indexes = _parameters["index"];
-
-      for( size_t i=0; i < indexes.size(); i++ ) {
-        _environment.addIndex( std::string(indexes[i]) );
-      }
+    // the repositories are opened once in main and shared by all threads
+    for( size_t i=0; i < _repositories.size(); i++ ) {
+      _environment.addIndex( *_repositories[i] );
     }
     _requested = _parameters.get( "count", 1000 );
-    _runID = _parameters.get( "runID", "indri" );
+    _profiling = _parameters.exists( "profile" );
 
     } catch ( lemur::api::Exception& e ) {      
       while( _queries.size() ) {
         query_t *query = _queries.front();
         _queries.pop();
-        _output.push( new query_t( query->index, query->number, "query: " + query->number + " QueryThread::_initialize exception\n" ) );
+        std::vector<std::string> runs( _configurations.size(), "query: " + query->number + " QueryThread::_initialize exception\n" );
+        _output.push( new query_t( query->index, query->number, runs ) );
         _queueEvent.notifyAll();
         LEMUR_RETHROW(e, "QueryThread::_initialize");
       }
@@ -203,7 +236,7 @@ public:
 
   UINT64 work() {
     query_t* query;
-    std::stringstream output;
+    std::vector<std::string> runs;
 
     // pop a query off the queue
     {
@@ -217,19 +250,39 @@ public:
     }
 
     // run the query
+    std::string error;
     try {
-      _runQuery( output, query->text, query->pertube_type, query->pertube_paras );
+      _runQuery( query->text );
     } catch( lemur::api::Exception& e ) {
-      output << "# EXCEPTION in query " << query->number << ": " << e.what() << std::endl;
+      error = "# EXCEPTION in query " + query->number + ": " + e.what() + "\n";
     }
 
-    // print the results to the output stream
-    _printResults( output, query->number );
+    // the environment times the query up to its evaluation
+    indri::utility::QueryProfile profile = _environment.queryProfile();
+    profile.start();
+
+    // print the results of each configuration to its output
+    std::map<lemur::api::DOCID_T, std::string> documentNames;
+    _fetchDocumentNames( documentNames );
+    profile.lap( indri::utility::QueryProfile::METADATA );
+
+    for( size_t i=0; i<_configurations.size(); i++ ) {
+      std::stringstream output;
+      output << error;
+      if( i < _results.size() )
+        _printResults( output, query->number, _results[i], documentNames, _configurations[i].runID );
+      runs.push_back( output.str() );
+    }
+    profile.lap( indri::utility::QueryProfile::OUTPUT );
+
+    std::stringstream profileLine;
+    if( _profiling )
+      profile.writeJSON( profileLine, query->number );
 
     // push that data into an output queue...?
     {
       indri::thread::ScopedLock sl( &_queueLock );
-      _output.push( new query_t( query->index, query->number, output.str() ) );
+      _output.push( new query_t( query->index, query->number, runs, profileLine.str() ) );
       _queueEvent.notifyAll();
     }
 
@@ -238,8 +291,7 @@ public:
   }
 };
 
-void push_queue( std::queue< query_t* >& q, indri::api::Parameters& queries,
-    int pertube_type, std::map<std::string, double>& pertube_paras ) {
+void push_queue( std::queue< query_t* >& q, indri::api::Parameters& queries ) {
 
   for( size_t i=0; i<queries.size(); i++ ) {
     std::string queryNumber;
@@ -255,7 +307,7 @@ void push_queue( std::queue< query_t* >& q, indri::api::Parameters& queries,
     if (queryText.size() == 0)
       queryText = (std::string) queries[i];
 
-    q.push( new query_t( i, queryNumber, queryText, pertube_type, pertube_paras ) );
+    q.push( new query_t( i, queryNumber, queryText ) );
   }
 }
 
@@ -275,6 +327,147 @@ std::vector<std::string> _split(const std::string &s, char delim=' ') {
   return elems;
 }
 
+// collect the distinct terms of a query log, one query per line
+std::vector<std::string> _read_query_log_terms( const std::string& path ) {
+  std::ifstream in( path.c_str() );
+  if( !in.good() )
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open the query log: " + path );
+
+  std::set<std::string> terms;
+  std::string line;
+  while( std::getline( in, line ) ) {
+    std::replace( line.begin(), line.end(), '(', ' ' );
+    std::replace( line.begin(), line.end(), ')', ' ' );
+    std::replace( line.begin(), line.end(), '\t', ' ' );
+    std::vector<std::string> lineTerms = _split( line );
+    terms.insert( lineTerms.begin(), lineTerms.end() );
+  }
+
+  return std::vector<std::string>( terms.begin(), terms.end() );
+}
+
+// parse perturbation parameters written as "k:1,b:2"
+std::map<std::string, double> _parse_pertube_paras( const std::string& text ) {
+  std::map<std::string, double> pertube_paras;
+  std::vector<std::string> para_vectors = _split(text, ',');
+
+  for (size_t i = 0; i < para_vectors.size(); i++) {
+    std::string cur = para_vectors[i];
+    try {
+      std::vector<std::string> this_para = _split(cur, ':');
+      pertube_paras[this_para.at(0)] = atof(this_para.at(1).c_str());
+    }
+    catch (...) {
+      LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Parse Pertube Parameters Error!" );
+    }
+  }
+
+  return pertube_paras;
+}
+
+//
+// A parameter grid runs the queries under many configurations in one
+// process instead of one process per configuration:
+//
+//   <grid>
+//     <rule>method:dirichlet,mu:500|1000|2000</rule>
+//     <pertube>0|1</pertube>
+//     <pertube_paras>k:1|2,b:0.5</pertube_paras>
+//   </grid>
+//   <gridOutput>runs/sweep</gridOutput>
+//
+// A value may list alternatives separated by '|', and each setting may
+// be given several times.  The configurations are all combinations of
+// the rules, pertube types and pertube_paras; a setting the grid leaves
+// out keeps its global value.  Configuration n is written to
+// <gridOutput>.n with the run ID <runID>.n, and <gridOutput>.grid lists
+// the settings of each one.
+//
+// The repositories are opened once, and each query is run under all
+// configurations as one batch: its term statistics are computed once
+// and its posting lists are read once.
+//
+// <profile>queries.prof</profile> writes one JSON line per query, in
+// query order, with the microseconds spent parsing it, processing its
+// terms, fetching their statistics, building and evaluating the
+// inference networks, looking up the document names and formatting the
+// results, and counts of the postings decoded, list blocks skipped,
+// documents scored, list bytes read, top-k insertions and term
+// statistics found in the cache.
+//
+
+// "mu:500|1000,b:0.5" becomes "mu:500,b:0.5" and "mu:1000,b:0.5"
+std::vector<std::string> _expand_alternatives( const std::string& text ) {
+  std::vector<std::string> expanded( 1, "" );
+  std::vector<std::string> items = _split( text, ',' );
+
+  for( size_t i=0; i<items.size(); i++ ) {
+    std::string::size_type colon = items[i].find( ':' );
+    std::string name = colon == std::string::npos ? "" : items[i].substr( 0, colon+1 );
+    std::vector<std::string> values = _split( items[i].substr( name.size() ), '|' );
+    std::vector<std::string> next;
+
+    for( size_t j=0; j<expanded.size(); j++ ) {
+      for( size_t k=0; k<values.size(); k++ )
+        next.push_back( expanded[j] + (expanded[j].size() ? "," : "") + name + values[k] );
+    }
+
+    expanded.swap( next );
+  }
+
+  return expanded;
+}
+
+std::vector<std::string> _grid_values( indri::api::Parameters& grid, const std::string& name, const std::string& globalValue ) {
+  std::vector<std::string> values;
+
+  if( !grid.exists( name ) ) {
+    values.push_back( globalValue );
+    return values;
+  }
+
+  indri::api::Parameters settings = grid[name];
+  for( size_t i=0; i<settings.size(); i++ ) {
+    std::vector<std::string> expanded = _expand_alternatives( settings[i] );
+    values.insert( values.end(), expanded.begin(), expanded.end() );
+  }
+
+  return values;
+}
+
+void _read_grid( indri::api::Parameters& param, std::vector< configuration_t >& configurations, std::ofstream& listing ) {
+  indri::api::Parameters grid = param["grid"];
+  std::string runID = param.get( "runID", "indri" );
+  std::string globalParas;
+  if( param.exists( "pertube_paras" ) )
+    globalParas = (std::string) param["pertube_paras"][size_t(0)];
+
+  std::vector<std::string> rules = _grid_values( grid, "rule", "" );
+  std::vector<std::string> pertubeTypes = _grid_values( grid, "pertube", param.get( "pertube", "0" ) );
+  std::vector<std::string> pertubeParas = _grid_values( grid, "pertube_paras", globalParas );
+
+  for( size_t i=0; i<rules.size(); i++ ) {
+    for( size_t j=0; j<pertubeTypes.size(); j++ ) {
+      for( size_t k=0; k<pertubeParas.size(); k++ ) {
+        std::stringstream id;
+        id << runID << "." << configurations.size();
+
+        configuration_t configuration;
+        configuration.rule = rules[i];
+        configuration.pertube_type = atoi( pertubeTypes[j].c_str() );
+        configuration.pertube_paras = _parse_pertube_paras( pertubeParas[k] );
+        configuration.runID = id.str();
+        configurations.push_back( configuration );
+
+        listing << configurations.size()-1 << "\t"
+                << rules[i] << "\t"
+                << pertubeTypes[j] << "\t"
+                << pertubeParas[k] << std::endl;
+      }
+    }
+  }
+}
+
 int main(int argc, char * argv[]) {
   try {
     indri::api::Parameters& param = indri::api::Parameters::instance();
@@ -290,7 +483,7 @@ int main(int argc, char * argv[]) {
     if( !param.exists("index") && !param.exists("server") )
       LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Must specify a server or index to query against." );
 
-    if( !param.exists("pertube") )
+    if( !param.exists("pertube") && !param.exists("grid") )
       LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Must specify whether the query is pertube query: 0-not pertube, positive integer-pertube." );
 
     int threadCount = param.get( "threads", 1 );
@@ -300,36 +493,79 @@ int main(int argc, char * argv[]) {
     indri::thread::Mutex queueLock;
     indri::thread::ConditionVariable queueEvent;
 
-    // push all queries onto a queue
-    indri::api::Parameters parameterQueries = param[ "query" ];
-    std::map<std::string, double> pertube_paras;
-
-    int pertube_type = param.get( "pertube", 0 );
-    if( param.exists("pertube_paras") ) {
-      indri::api::Parameters p_paras = param["pertube_paras"];
-      if (p_paras.size() != 0) {
-        size_t x = 0;
-
-        std::vector<std::string> para_vectors = _split(p_paras[x], ',');
-        for (size_t i = 0; i < para_vectors.size(); i++) {
-          std::string cur = para_vectors[i];
-          try {
-            std::vector<std::string> this_para = _split(cur, ':');
-            pertube_paras[this_para.at(0)] = atof(this_para.at(1).c_str());
-          }
-          catch (...) {
-            LEMUR_THROW( LEMUR_MISSING_PARAMETER_ERROR, "Parse Pertube Parameters Error!" );
-          }
+    // each configuration is written to its own stream
+    std::vector< configuration_t > configurations;
+    std::vector< std::ostream* > runStreams;
+
+    if( param.exists( "grid" ) ) {
+      std::string prefix = param.get( "gridOutput", param.get( "runID", "indri" ) );
+      std::ofstream listing( (prefix + ".grid").c_str() );
+      if( !listing.good() )
+        LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open the grid listing: " + prefix + ".grid" );
+      _read_grid( param, configurations, listing );
+
+      for( size_t i=0; i<configurations.size(); i++ ) {
+        std::stringstream path;
+        path << prefix << "." << i;
+        std::ofstream* stream = new std::ofstream( path.str().c_str() );
+        if( !stream->good() ) {
+          delete stream;
+          LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open the run file: " + path.str() );
+        }
+        runStreams.push_back( stream );
+      }
+    } else {
+      configuration_t configuration;
+      configuration.pertube_type = param.get( "pertube", 0 );
+      if( param.exists("pertube_paras") ) {
+        indri::api::Parameters p_paras = param["pertube_paras"];
+        if (p_paras.size() != 0) {
+          size_t x = 0;
+          configuration.pertube_paras = _parse_pertube_paras( p_paras[x] );
         }
       }
+      configuration.runID = param.get( "runID", "indri" );
+      configurations.push_back( configuration );
+      runStreams.push_back( &std::cout );
+    }
+
+    std::ofstream profileStream;
+    if( param.exists( "profile" ) ) {
+      std::string path = param.get( "profile", "" );
+      profileStream.open( path.c_str() );
+      if( !profileStream.good() )
+        LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open the profile file: " + path );
     }
 
-    push_queue( queries, parameterQueries, pertube_type, pertube_paras );
+    // push all queries onto a queue
+    indri::api::Parameters parameterQueries = param[ "query" ];
+    push_queue( queries, parameterQueries );
     int queryCount = (int)queries.size();
 
+    // open each repository once; the query threads only read from them,
+    // so they share the index files, the B-tree caches and the collection
+    std::vector< indri::collection::Repository* > repositories;
+    if( param.exists( "index" ) ) {
+      indri::api::Parameters indexes = param["index"];
+
+      for( size_t i=0; i < indexes.size(); i++ ) {
+        indri::collection::Repository* repository = new indri::collection::Repository();
+        repositories.push_back( repository );
+        repository->openRead( std::string(indexes[i]), &param );
+      }
+    }
+
+    // fill the term dictionary caches from a query log before any query runs
+    if( param.exists( "termCacheWarm" ) ) {
+      std::vector<std::string> warmTerms = _read_query_log_terms( param.get( "termCacheWarm", "" ) );
+
+      for( size_t i=0; i < repositories.size(); i++ )
+        repositories[i]->warmTermCache( warmTerms );
+    }
+
     // launch threads
     for( int i=0; i<threadCount; i++ ) {
-      threads.push_back( new QueryThread( queries, output, queueLock, queueEvent, param ) );
+      threads.push_back( new QueryThread( queries, output, queueLock, queueEvent, repositories, configurations, param ) );
       threads.back()->start();
     }
 
@@ -351,7 +587,10 @@ int main(int argc, char * argv[]) {
 
         queueLock.unlock();
 
-        std::cout << result->text;
+        for( size_t i=0; i<runStreams.size(); i++ )
+          *runStreams[i] << result->runs[i];
+        if( profileStream.is_open() )
+          profileStream << result->profile;
         delete result;
         query++;
 
@@ -366,6 +605,32 @@ int main(int argc, char * argv[]) {
 
     // we've seen all the query output now, so we can quit
     indri::utility::delete_vector_contents( threads );
+
+    if( param.exists( "grid" ) )
+      indri::utility::delete_vector_contents( runStreams );
+
+    if( param.get( "cacheStats", false ) ) {
+      for( size_t i=0; i<repositories.size(); i++ ) {
+        indri::file::BulkBlockCache* cache = repositories[i]->blockCache();
+        std::cerr << "# " << std::string(param["index"][i]) << " dictionary block cache: "
+                  << cache->hits() << " hits, " << cache->misses() << " misses, "
+                  << cache->size() << " blocks" << std::endl;
+        std::cerr << "# " << std::string(param["index"][i]) << " term statistics cache: "
+                  << repositories[i]->termStatistics().size() << " terms" << std::endl;
+      }
+
+      // the query threads have exited, so their pools are all counted
+      indri::file::ReadBufferPool::statistics buffers = indri::file::ReadBufferPool::counts();
+      std::cerr << "# read buffers: "
+                << buffers.acquired << " acquired, "
+                << buffers.allocated << " allocated (" << buffers.allocatedBytes << " bytes), "
+                << buffers.released << " released, "
+                << buffers.freed << " freed" << std::endl;
+    }
+
+    for( size_t i=0; i<repositories.size(); i++ )
+      repositories[i]->close();
+    indri::utility::delete_vector_contents( repositories );
   } catch( lemur::api::Exception& e ) {
     LEMUR_ABORT(e);
   } catch( ... ) {
@@ -0,0 +1,289 @@
+/*==========================================================================
+ * Copyright (c) 2005 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// BulkBlockCache
+//
+
+#include "indri/BulkBlockCache.hpp"
+#include "indri/BulkTree.hpp"
+#include "indri/ScopedLock.hpp"
+#include "lemur/Exception.hpp"
+
+//
+// BulkBlockCache constructor
+//
+
+indri::file::BulkBlockCache::BulkBlockCache( size_t blocks ) :
+  _files(0)
+{
+  size_t shardCapacity = (blocks + SHARDS - 1) / SHARDS;
+
+  if( shardCapacity == 0 )
+    shardCapacity = 1;
+
+  for( size_t i=0; i<SHARDS; i++ ) {
+    _shards[i].capacity = shardCapacity;
+    _shards[i].slots.reserve( shardCapacity );
+  }
+}
+
+//
+// BulkBlockCache destructor
+//
+
+indri::file::BulkBlockCache::~BulkBlockCache() {
+  for( size_t i=0; i<SHARDS; i++ ) {
+    for( size_t j=0; j<_shards[i].slots.size(); j++ )
+      delete _shards[i].slots[j].block;
+  }
+}
+
+//
+// registerFile
+//
+
+UINT32 indri::file::BulkBlockCache::registerFile() {
+  indri::thread::ScopedLock lock( _fileLock );
+  return _files++;
+}
+
+//
+// _shard
+//
+
+indri::file::BulkBlockCache::shard& indri::file::BulkBlockCache::_shard( UINT64 key ) {
+  // neighboring blocks of one file should land in different shards
+  UINT64 mixed = key * 0x9E3779B97F4A7C15ULL;
+  return _shards[ (mixed >> 32) % SHARDS ];
+}
+
+//
+// _evict
+//
+// Drops the block at position from the shard; the last slot moves into
+// its place.
+//
+
+void indri::file::BulkBlockCache::_evict( shard& s, size_t position ) {
+  slot& victim = s.slots[position];
+  s.index.remove( victim.key );
+  delete victim.block;
+
+  size_t last = s.slots.size() - 1;
+
+  if( position != last ) {
+    victim = s.slots[last];
+    *s.index.find( victim.key ) = position;
+  }
+
+  s.slots.pop_back();
+
+  if( s.hand >= s.slots.size() )
+    s.hand = 0;
+}
+
+//
+// _shrink
+//
+// A shard that grew while all its blocks were pinned gives the extra
+// slots back as soon as blocks are unpinned: the clock hand drops
+// blocks, rather than reusing their slots, until the shard is back at
+// capacity.
+//
+
+void indri::file::BulkBlockCache::_shrink( shard& s ) {
+  size_t passed = 0;
+
+  while( s.slots.size() > s.capacity && passed < 2*s.slots.size() ) {
+    slot& candidate = s.slots[s.hand];
+
+    if( candidate.pins || candidate.referenced ) {
+      if( !candidate.pins )
+        candidate.referenced = false;
+
+      s.hand = (s.hand + 1) % s.slots.size();
+      passed++;
+      continue;
+    }
+
+    // the last slot moves under the hand, so look at it next
+    _evict( s, s.hand );
+  }
+}
+
+//
+// _victim
+//
+// Picks the slot for a new block: a fresh one while the shard is below
+// capacity, otherwise the first unpinned block the clock hand finds that
+// hasn't been used since the last sweep.  If every block is pinned the
+// shard grows past its capacity rather than wait, and shrinks back on
+// later inserts.
+//
+
+size_t indri::file::BulkBlockCache::_victim( shard& s ) {
+  if( s.slots.size() > s.capacity )
+    _shrink( s );
+
+  if( s.slots.size() < s.capacity ) {
+    s.slots.push_back( slot() );
+    s.slots.back().block = 0;
+    return s.slots.size() - 1;
+  }
+
+  for( size_t i=0; i<2*s.slots.size(); i++ ) {
+    slot& candidate = s.slots[s.hand];
+    size_t position = s.hand;
+    s.hand = (s.hand + 1) % s.slots.size();
+
+    if( candidate.pins )
+      continue;
+
+    if( candidate.referenced ) {
+      candidate.referenced = false;
+      continue;
+    }
+
+    s.index.remove( candidate.key );
+    delete candidate.block;
+    candidate.block = 0;
+    return position;
+  }
+
+  s.slots.push_back( slot() );
+  s.slots.back().block = 0;
+  return s.slots.size() - 1;
+}
+
+//
+// pin
+//
+
+indri::file::BulkBlock* indri::file::BulkBlockCache::pin( UINT32 file, UINT32 id, File& source ) {
+  UINT64 key = _key( file, id );
+  shard& s = _shard( key );
+
+  {
+    indri::thread::ScopedLock lock( s.lock );
+    size_t* position = s.index.find( key );
+
+    if( position ) {
+      slot& hit = s.slots[*position];
+      hit.pins++;
+      hit.referenced = true;
+      s.hits++;
+      return hit.block;
+    }
+
+    s.misses++;
+  }
+
+  // the block isn't in the shard yet, so a failed read leaves nothing
+  // behind for later lookups
+  BulkBlock* block = new BulkBlock;
+  size_t bytesRead = 0;
+
+  try {
+    bytesRead = source.read( block->data(), id*BulkBlock::dataSize(), BulkBlock::dataSize() );
+  } catch( lemur::api::Exception& e ) {
+    delete block;
+    LEMUR_RETHROW( e, "Couldn't read a dictionary block." );
+  }
+
+  if( bytesRead != BulkBlock::dataSize() ) {
+    delete block;
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't read a whole dictionary block; the dictionary file is short." );
+  }
+
+  block->setID( id );
+
+  indri::thread::ScopedLock lock( s.lock );
+  size_t* position = s.index.find( key );
+
+  // another thread read the same block in the meantime
+  if( position ) {
+    delete block;
+    s.slots[*position].pins++;
+    return s.slots[*position].block;
+  }
+
+  size_t victim = _victim( s );
+  slot& fresh = s.slots[victim];
+  fresh.key = key;
+  fresh.block = block;
+  fresh.pins = 1;
+  fresh.referenced = false;
+  s.index.insert( key, victim );
+
+  return block;
+}
+
+//
+// unpin
+//
+
+void indri::file::BulkBlockCache::unpin( UINT32 file, UINT32 id ) {
+  UINT64 key = _key( file, id );
+  shard& s = _shard( key );
+
+  indri::thread::ScopedLock lock( s.lock );
+  size_t* position = s.index.find( key );
+
+  assert( position && s.slots[*position].pins > 0 );
+  if( position )
+    s.slots[*position].pins--;
+}
+
+//
+// hits
+//
+
+UINT64 indri::file::BulkBlockCache::hits() {
+  UINT64 total = 0;
+
+  for( size_t i=0; i<SHARDS; i++ ) {
+    indri::thread::ScopedLock lock( _shards[i].lock );
+    total += _shards[i].hits;
+  }
+
+  return total;
+}
+
+//
+// misses
+//
+
+UINT64 indri::file::BulkBlockCache::misses() {
+  UINT64 total = 0;
+
+  for( size_t i=0; i<SHARDS; i++ ) {
+    indri::thread::ScopedLock lock( _shards[i].lock );
+    total += _shards[i].misses;
+  }
+
+  return total;
+}
+
+//
+// size
+//
+
+size_t indri::file::BulkBlockCache::size() {
+  size_t total = 0;
+
+  for( size_t i=0; i<SHARDS; i++ ) {
+    indri::thread::ScopedLock lock( _shards[i].lock );
+    total += _shards[i].slots.size();
+  }
+
+  return total;
+}
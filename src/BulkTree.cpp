@@ -22,6 +22,7 @@
 #include "indri/File.hpp"
 #include "indri/delete_range.hpp"
 #include "indri/BulkTree.hpp"
+#include "indri/BulkBlockCache.hpp"
 #include "lemur/lemur-platform.h"
 #include <iostream>
 
@@ -260,7 +261,7 @@ inline void indri::file::BulkBlock::clear() {
   *(UINT16*) _buffer = (leaf() ? (1<<15) : 0);
 }
 
-inline char* indri::file::BulkBlock::data() {
+char* indri::file::BulkBlock::data() {
   return _buffer;
 }
 
@@ -436,80 +437,149 @@ void indri::file::BulkTreeWriter::flush() {
 // BulkTreeReader
 // ==============
 
-indri::file::BulkBlock* indri::file::BulkTreeReader::_fetch( UINT32 id ) {
+//
+// _fetch
+//
+// Interior blocks come from the pinned table and need no release; any
+// other block is pinned in the block cache and has to be released
+// with _release once the caller is done with it.
+//
+
+indri::file::BulkBlock* indri::file::BulkTreeReader::_fetch( UINT32 id, bool& cached ) {
   assert( id < _fileLength / indri::file::BulkBlock::dataSize() );
-  indri::file::BulkBlock** result = _cache.find( id );
-  indri::file::BulkBlock* block;
-
-  if( !result ) {
-    if( _cache.size() >= 256 ) {
-      block = _tail;
-      _tail = block->previous();
-      _cache.remove( block->getID() );
-    } else {
-      block = new indri::file::BulkBlock;
-    }
+  indri::file::BulkBlock** interior = _interior.find( id );
 
-    _file->read( block->data(), id*indri::file::BulkBlock::dataSize(), indri::file::BulkBlock::dataSize() );
-    block->setID( id );
-    _cache.insert( id, block );
-  } else {
-    block = *result;
-    
-    if( _tail == block )
-      _tail = block->previous();
+  if( interior ) {
+    cached = false;
+    return *interior;
   }
 
-  // move to front of list
-  block->unlink();
-  block->link( 0, _head );
-  if( _tail == 0 )
-    _tail = block;
-  _head = block;
+  cached = true;
+  return _cache->pin( _cacheFile, id, *_file );
+}
 
-  assert( _cache.size() <= 256 );
-  
-  return block;
+//
+// _release
+//
+
+void indri::file::BulkTreeReader::_release( UINT32 id ) {
+  _cache->unpin( _cacheFile, id );
+}
+
+//
+// _pinInterior
+//
+// Reads every interior block of the tree into memory, one level at a
+// time from the root.  The tree is balanced, so the children of a level
+// are either all interior blocks or all leaves; reading the first child
+// tells which.
+//
+
+void indri::file::BulkTreeReader::_pinInterior() {
+  int rootID = int(_fileLength / BULK_BLOCK_SIZE) - 1;
+
+  if( rootID < 0 )
+    return;
+
+  std::vector<UINT32> level;
+  level.push_back( rootID );
+
+  while( level.size() ) {
+    std::vector<UINT32> children;
+
+    for( size_t i=0; i<level.size(); i++ ) {
+      indri::file::BulkBlock* block = new indri::file::BulkBlock;
+      _file->read( block->data(), level[i]*indri::file::BulkBlock::dataSize(), indri::file::BulkBlock::dataSize() );
+      block->setID( level[i] );
+
+      if( block->leaf() ) {
+        delete block;
+        return;
+      }
+
+      _interior.insert( level[i], block );
+
+      for( int j=0; j<block->count(); j++ ) {
+        UINT32 child;
+        int actual;
+        block->getIndex( j, 0, actual, 0, (char*) &child, actual, sizeof(child) );
+        children.push_back( child );
+      }
+    }
+
+    if( children.size() == 0 )
+      break;
+
+    indri::file::BulkBlock first;
+    _file->read( first.data(), children[0]*indri::file::BulkBlock::dataSize(), indri::file::BulkBlock::dataSize() );
+
+    if( first.leaf() )
+      break;
+
+    level.swap( children );
+  }
 }
 
 indri::file::BulkTreeReader::BulkTreeReader( File& file ) :
   _file(&file),
+  _fileLength(file.size()),
   _ownFile(false),
-  _head(0),
-  _tail(0)
+  _cache(new BulkBlockCache),
+  _ownCache(true),
+  _interior(1024)
 {
+  _cacheFile = _cache->registerFile();
 }
 
 indri::file::BulkTreeReader::BulkTreeReader( File& file, UINT64 length ) :
   _file(&file),
-  _ownFile(false),
   _fileLength(length),
-  _head(0),
-  _tail(0)
+  _ownFile(false),
+  _cache(new BulkBlockCache),
+  _ownCache(true),
+  _interior(1024)
 {
+  _cacheFile = _cache->registerFile();
 }
 
 indri::file::BulkTreeReader::BulkTreeReader() :
-  _ownFile(false),
   _file(0),
-  _head(0),
-  _tail(0)
+  _fileLength(0),
+  _ownFile(false),
+  _cache(0),
+  _ownCache(false),
+  _cacheFile(0),
+  _interior(1024)
 {
 }
 
 indri::file::BulkTreeReader::~BulkTreeReader() {
   indri::utility::HashTable< UINT32, indri::file::BulkBlock* >::iterator iter;
 
-  for( iter = _cache.begin(); iter != _cache.end(); iter++ ) {
+  for( iter = _interior.begin(); iter != _interior.end(); iter++ ) {
     delete *iter->second;
   }
+
+  if( _ownCache )
+    delete _cache;
 }
 
-void indri::file::BulkTreeReader::openRead( const std::string& filename ) {
+void indri::file::BulkTreeReader::openRead( const std::string& filename, BulkBlockCache* cache ) {
   _file = new File;
   _file->openRead( filename );
   _fileLength = _file->size();
   _ownFile = true;
+
+  if( cache ) {
+    _cache = cache;
+    _ownCache = false;
+  } else {
+    _cache = new BulkBlockCache;
+    _ownCache = true;
+  }
+
+  _cacheFile = _cache->registerFile();
+  _pinInterior();
 }
 
 void indri::file::BulkTreeReader::close() {
@@ -520,7 +590,6 @@ void indri::file::BulkTreeReader::close() {
 }
 
 bool indri::file::BulkTreeReader::get( const char* key, int keyLength, char* value, int& actual, int valueLength ) {
-  indri::file::BulkBlock* block = 0;
   int rootID = int(_fileLength / BULK_BLOCK_SIZE) - 1;
 
   if( rootID < 0 )
@@ -529,22 +598,31 @@ bool indri::file::BulkTreeReader::get( const char* key, int keyLength, char* val
   int nextID = rootID;
 
   while( true ) {
-    block = _fetch( nextID );
+    bool cached;
+    indri::file::BulkBlock* block = _fetch( nextID, cached );
+    int blockID = nextID;
+    bool result;
+
+    if( block->leaf() ) {
+      // now we're at a leaf
+      result = block->find( key, keyLength, value, actual, valueLength );
+
+      if( cached )
+        _release( blockID );
+      return result;
+    }
 
-    if( block->leaf() )
-      break;
+    int nextActual;
+    result = block->findGreater( key, keyLength, (char*) &nextID, nextActual, sizeof(nextID) );
 
-    int actual;
-    bool result = block->findGreater( key, keyLength, (char*) &nextID, actual, sizeof(nextID) );
+    if( cached )
+      _release( blockID );
 
     if( !result )
       return false;
 
-    assert( actual == sizeof(nextID) );
+    assert( nextActual == sizeof(nextID) );
   }
-
-  // now we're at a leaf
-  return block->find( key, keyLength, value, actual, valueLength );
 }
 
 bool indri::file::BulkTreeReader::get( const char* key, char* value, int& actual, int valueLength ) {
@@ -564,7 +642,6 @@ indri::file::BulkTreeIterator* indri::file::BulkTreeReader::iterator() {
 // findFirst
 //
 indri::file::BulkTreeIterator* indri::file::BulkTreeReader::findFirst(const char *key) {
-  indri::file::BulkBlock* block = 0;
   int rootID = int(_fileLength / BULK_BLOCK_SIZE) - 1;
 
   if( rootID < 0 )
@@ -575,29 +652,34 @@ indri::file::BulkTreeIterator* indri::file::BulkTreeReader::findFirst(const char
   int keyLength=(int)strlen(key);
 
   while( true ) {
-    block = _fetch( nextID );
-
-    if( block->leaf() )
-      break;
+    bool cached;
+    indri::file::BulkBlock* block = _fetch( nextID, cached );
+    int blockID = nextID;
+
+    if( block->leaf() ) {
+      // now we're at a leaf
+      // we've got the block ID, now get the index ID of the entry we want.
+      UINT64 thisBlockID=(UINT64)block->getID();
+      int thisPairIndex=block->findIndexOf(key);
+
+      if( cached )
+        _release( blockID );
+      return new BulkTreeIterator(*_file, thisBlockID, thisPairIndex);
+    }
 
     int actual;
     bool result = block->findGreater( key, keyLength, (char*) &nextID, actual, sizeof(nextID) );
 
+    if( cached )
+      _release( blockID );
+
     if( !result )
       return NULL;
 
     assert( actual == sizeof(nextID) );
   }
-
-  // now we're at a leaf
-  // we've got the block ID, now get the index ID of the entry we want.
-  UINT64 thisBlockID=(UINT64)block->getID();
-  int thisPairIndex=block->findIndexOf(key);
-
-  return new BulkTreeIterator(*_file, thisBlockID, thisPairIndex);
 }
 
-
 // ================
 // BulkTreeIterator
 // ----------------
@@ -18,6 +18,8 @@
 #include "indri/DiskDocListIterator.hpp"
 #include "lemur/RVLCompress.hpp"
 #include "indri/ex_changes.hpp"
+#include "indri/RVLBlockDecoder.hpp"
+#include <algorithm>
 
 //
 // ---------------------
@@ -27,7 +29,7 @@
 //         RVLCompressed section (size is headerLength)
 //            termString
 //            termData (indri::index::TermData structure)
-//      byte (1b)   controlByte   (0x01 = hasTopdocs, 0x02 = isFrequent)
+//      byte (1b)   controlByte   (0x01 = hasTopdocs, 0x02 = isFrequent, 0x04 = hasBlockSummaries)
 //      topdocsCount (4b)  (if hasTopdocs)
 //         for each topdoc:
 //         docID (4b)
@@ -37,11 +39,18 @@
 //        skip: (if hasSkips)
 //          (4b) document
 //          (4b) length
+//          block summary: (if hasBlockSummaries)
+//            (4b) max count
+//            (4b) min document length
+//            (4b) count of the document with the largest count/length
+//            (4b) length of that document
 //        for each in a batch of documents:
 //          RVLCompressed:
 //            delta document ID (delta encoded by batch)
 //            position count
 //            delta encoded positions
+//        (this is the "rvl" codec; the manifest may name another
+//         PostingCodec for the batch)
 //
 // ----------------------------
 // More explanation about skips:
@@ -55,19 +64,44 @@
 //
 // At the beginning of the last chunk of documents, the skip will be {-1,-1}.
 //
+// The document in a skip is the first document of the following chunk,
+// so every document in the chunk after a skip is smaller than it.  If
+// the list has block summaries, each skip is followed by a summary of
+// that chunk, and length is measured from the end of the summary.
+// Block summaries let the query processor bound the score of a chunk
+// without decompressing it; lists written without them read as before.
+//
+// ----------------------------
+// Decoding:
+// ----------------------------
+//
+// With block decoding a whole chunk is decoded into arrays when its
+// first entry is needed; nextEntry(document) then binary searches the
+// chunk, and currentBlock() exposes the arrays, which both query
+// evaluators score from.  Repositories block decode unless opened with
+// blockDecode=false, which decodes rvl lists one entry at a time, as
+// they always were (other codecs are always block decoded).
+//
 
 //
 // DiskDocListIterator constructor
 //
 
-indri::index::DiskDocListIterator::DiskDocListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, int fieldCount )
+indri::index::DiskDocListIterator::DiskDocListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, int fieldCount, const PostingCodec* codec, bool blockDecoding )
   :
   _file(buffer),
   _startOffset(startOffset),
   _fieldCount(fieldCount),
+  _countsOnly(false),
+  _codec(codec ? codec : PostingCodec::get( "rvl" )),
+  _blockIndex(0),
+  _blockSize(0),
   _termData(0),
-  _ownTermData(false)
+  _ownTermData(false),
+  _postingsDecoded(0),
+  _blocksSkipped(0)
 {
+  _blockDecoding = blockDecoding || _codec != PostingCodec::get( "rvl" );
 }
 
 //
@@ -92,6 +126,14 @@ void indri::index::DiskDocListIterator::setStartOffset( UINT64 startOffset, Term
   _ownTermData = false;
 }
 
+//
+// countsOnly
+//
+
+void indri::index::DiskDocListIterator::countsOnly( bool countsOnly ) {
+  _countsOnly = countsOnly;
+}
+
 //
 // topDocuments
 //
@@ -144,15 +186,17 @@ void indri::index::DiskDocListIterator::startIteration() {
 
   _hasTopdocs = (control & 0x01) ? true : false;
   _isFrequent = (control & 0x02) ? true : false;
+  _hasBlockSummaries = (control & 0x04) ? true : false;
   
   // clear out all the internal data
   _data.document = 0;
   #ifdef DOC_UNIQUE_TERM_COUNTS
   _data.uniqueTermCounts = 0;
   #endif
+  _data.count = 0;
   _data.positions.clear();
   _skipDocument = -1;
-  _list = _listEnd = 0;
+  _list = _listEnd = _blockStart = 0;
 
   // read in the term data, if necessary
 
@@ -163,7 +207,7 @@ void indri::index::DiskDocListIterator::startIteration() {
   _readSkip();
   
   // read the first entry, unless there's nothing here
-  if( _list == _listEnd ) {
+  if( _blockFinished() ) {
     _result = 0;
   } else {
   _readEntry();
@@ -176,7 +220,7 @@ void indri::index::DiskDocListIterator::startIteration() {
 //
 
 bool indri::index::DiskDocListIterator::nextEntry() {
-  if( _list == _listEnd ) {
+  if( _blockFinished() ) {
     if( _skipDocument > 0 ) {
       // need to read the next segment of this list
       _readSkip();
@@ -198,21 +242,73 @@ bool indri::index::DiskDocListIterator::nextEntry() {
 //
 
 bool indri::index::DiskDocListIterator::nextEntry( lemur::api::DOCID_T documentID ) {
-  // skip ahead as much as possible
-  while( _skipDocument > 0 && _skipDocument <= documentID ) {
-    _readSkip();
-  }
-
-  // now, read entries until we find one that's good
   while( _data.document < documentID ) {
-    if( !nextEntry() ) {
-      return false;
+    // skip ahead as much as possible
+    while( _skipDocument > 0 && _skipDocument <= documentID ) {
+      _readSkip();
+    }
+
+    if( _blockFinished() ) {
+      if( _skipDocument <= 0 ) {
+        // all done
+        _result = 0;
+        return false;
+      }
+
+      _readSkip();
+      continue;
     }
+
+    if( !_blockDecoding ) {
+      _readEntry();
+      continue;
+    }
+
+    // the rest of a decoded block is sorted, so search it
+    if( _blockIndex == _blockSize )
+      _decodeBlock();
+
+    lemur::api::DOCID_T* begin = &_postings.documents[_blockIndex];
+    lemur::api::DOCID_T* end = &_postings.documents[0] + _blockSize;
+    lemur::api::DOCID_T* found = std::lower_bound( begin, end, documentID );
+
+    _blockIndex += int(found - begin);
+    if( _blockIndex < _blockSize )
+      _readBlockEntry();
   }
 
   return true;
 }
 
+//
+// blockSummary
+//
+
+const indri::index::DocListIterator::BlockSummary* indri::index::DiskDocListIterator::blockSummary() {
+  if( !_hasBlockSummaries || !_result )
+    return 0;
+
+  return &_blockSummary;
+}
+
+//
+// currentBlock
+//
+
+const indri::index::DocListIterator::DocumentBlock* indri::index::DiskDocListIterator::currentBlock() {
+  if( !_result || !_blockDecoding || _blockIndex == 0 )
+    return 0;
+
+  int current = _blockIndex - 1;
+  _block.documents = &_postings.documents[current];
+  _block.counts = &_postings.counts[current];
+  #ifdef DOC_UNIQUE_TERM_COUNTS
+  _block.uniqueTermCounts = &_postings.uniqueTermCounts[current];
+  #endif
+  _block.size = _blockSize - current;
+  return &_block;
+}
+
 //
 // currentEntry
 //
@@ -263,15 +359,50 @@ void indri::index::DiskDocListIterator::_readTopdocs() {
 inline void indri::index::DiskDocListIterator::_readSkip() {
   int skipLength; 
 
+  // the block before this one was passed without reading any of it
+  if( _list == _blockStart && _list != _listEnd )
+    _blocksSkipped++;
+
   _file->read( &_skipDocument, sizeof(lemur::api::DOCID_T) );
   _file->read( &skipLength, sizeof(int) );
 
   assert( _skipDocument > -2 );
   assert( skipLength >= 0 );
 
+  if( _hasBlockSummaries ) {
+    UINT32 summary[4];
+    _file->read( summary, sizeof(summary) );
+
+    _blockSummary.maxCount = summary[0];
+    _blockSummary.minLength = summary[1];
+    _blockSummary.maxFractionCount = summary[2];
+    _blockSummary.maxFractionLength = summary[3];
+    _blockSummary.lastDocument = _skipDocument > 0 ? _skipDocument - 1 : MAX_INT32;
+  }
+
   _list = static_cast<const char*>(_file->read( skipLength ));
   _listEnd = _list + skipLength;
+  _blockStart = _list;
   _data.document = 0;
+
+  // the block is decoded when its first entry is needed
+  _blockIndex = 0;
+  _blockSize = 0;
+}
+
+//
+// _decodeBlock
+//
+// Decodes the entries between _list and _listEnd into _postings;
+// positions stay there as deltas until their entry is read.
+//
+
+void indri::index::DiskDocListIterator::_decodeBlock() {
+  _codec->decode( _list, _listEnd, _countsOnly, _postings );
+  _list = _listEnd;
+  _blockIndex = 0;
+  _blockSize = _postings.size;
+  _postingsDecoded += _blockSize;
 }
 
 //
@@ -279,8 +410,14 @@ inline void indri::index::DiskDocListIterator::_readSkip() {
 //
 
 inline void indri::index::DiskDocListIterator::_readEntry() {
+  if( _blockDecoding ) {
+    _readBlockEntry();
+    return;
+  }
+
   _data.positions.clear();
-  
+  _postingsDecoded++;
+
   int deltaDocument;
   _list = lemur::utility::RVLCompress::decompress_int( _list, deltaDocument );
   _data.document += deltaDocument;
@@ -290,13 +427,21 @@ inline void indri::index::DiskDocListIterator::_readEntry() {
   _list = lemur::utility::RVLCompress::decompress_int( _list, uniqueTermCounts );
   _data.uniqueTermCounts = uniqueTermCounts;
   #endif
- 
+
   int numPositions;
   _list = lemur::utility::RVLCompress::decompress_int( _list, numPositions );
+  _data.count = numPositions;
+
+  // bag-of-words scoring needs only the count, so step over the
+  // position bytes without decoding them
+  if( _countsOnly ) {
+    _list = indri::utility::RVLBlockDecoder::skip( _list, _listEnd, numPositions );
+    return;
+  }
 
   int lastPosition = 0;
   int deltaPosition;
-  
+
   for( int i=0; i<numPositions; i++ ) {
     _list = lemur::utility::RVLCompress::decompress_int( _list, deltaPosition );
     _data.positions.push_back( deltaPosition + lastPosition );
@@ -304,6 +449,36 @@ inline void indri::index::DiskDocListIterator::_readEntry() {
   }
 }
 
+//
+// _readBlockEntry
+//
+
+inline void indri::index::DiskDocListIterator::_readBlockEntry() {
+  if( _blockIndex == _blockSize )
+    _decodeBlock();
+
+  int current = _blockIndex++;
+
+  _data.document = _postings.documents[current];
+  _data.count = _postings.counts[current];
+  #ifdef DOC_UNIQUE_TERM_COUNTS
+  _data.uniqueTermCounts = _postings.uniqueTermCounts[current];
+  #endif
+
+  _data.positions.clear();
+
+  if( _countsOnly )
+    return;
+
+  const int* deltas = &_postings.positions[0] + _postings.positionStarts[current];
+  int lastPosition = 0;
+
+  for( int i=0; i<_data.count; i++ ) {
+    lastPosition += deltas[i];
+    _data.positions.push_back( lastPosition );
+  }
+}
+
 //
 // isFrequent
 //
@@ -320,4 +495,12 @@ indri::index::TermData* indri::index::DiskDocListIterator::termData() {
   return _termData;
 }
 
+//
+// addCounters
+//
 
+void indri::index::DiskDocListIterator::addCounters( indri::utility::QueryCounters& counters ) {
+  counters.postingsDecoded += _postingsDecoded;
+  counters.blocksSkipped += _blocksSkipped;
+  counters.bytesRead += _file->bytesRead();
+}
@@ -55,13 +55,20 @@ void indri::index::DiskIndex::_readManifest( const std::string& path ) {
   _corpusStatistics.maximumDocument = (lemur::api::DOCID_T) corpus["maximum-document"];
   _corpusStatistics.baseDocument = (lemur::api::DOCID_T) corpus["document-base"];
   _infrequentTermBase = (int) corpus["frequent-terms"];
+
+  // indexes written before codecs were pluggable have no codec entry
+  std::string codec = manifest.get( "postingCodec", "rvl" );
+  int codecVersion = manifest.get( "postingCodecVersion", 1 );
+  _postingCodec = indri::index::PostingCodec::get( codec, codecVersion );
+
+  _hasImpactLists = manifest.get( "impactLists", false );
 }
 
 //
 // open
 //
 
-void indri::index::DiskIndex::open( const std::string& base, const std::string& relative ) {
+void indri::index::DiskIndex::open( const std::string& base, const std::string& relative, const options& opts ) {
   _path = relative;
 
   std::string path = indri::file::Path::combine( base, relative );
@@ -79,12 +86,20 @@ void indri::index::DiskIndex::open( const std::string& base, const std::string&
   std::string manifestPath = indri::file::Path::combine( path, "manifest" );
 
   _readManifest( manifestPath );
+  _blockDecoding = opts.blockDecoding;
+
+  _frequentStringToTerm.openRead( frequentStringPath, opts.blockCache );
+  _infrequentStringToTerm.openRead( infrequentStringPath, opts.blockCache );
 
-  _frequentStringToTerm.openRead( frequentStringPath );
-  _infrequentStringToTerm.openRead( infrequentStringPath );
+  _frequentIdToTerm.openRead( frequentIDPath, opts.blockCache );
+  _infrequentIdToTerm.openRead( infrequentIDPath, opts.blockCache );
 
-  _frequentIdToTerm.openRead( frequentIDPath );
-  _infrequentIdToTerm.openRead( infrequentIDPath );
+  // with the dictionary in memory the trees and the term cache are
+  // only used by code that reads the trees directly
+  if( opts.memoryDictionary )
+    _dictionary.load( _frequentStringToTerm, _infrequentStringToTerm, _infrequentTermBase, (int)_fieldData.size() );
+  else
+    _termCache.open( opts.termCacheSize, (int)_fieldData.size() );
   _frequentTermsData.openRead( frequentTermsDataPath );
 
   _documentLengths.openRead( documentLengthsPath );
@@ -93,10 +108,27 @@ void indri::index::DiskIndex::open( const std::string& base, const std::string&
   _invertedFile.openRead( invertedFilePath );
   _directFile.openRead( directFilePath );
   _fieldsFile.openRead( fieldsFilePath );
+
+  if( _hasImpactLists ) {
+    _impactStringToList.openRead( indri::file::Path::combine( path, "impactString" ), opts.blockCache );
+    _impactFile.openRead( indri::file::Path::combine( path, "impactFile" ) );
+  }
+
+  if( opts.mapped ) {
+    // postings are advised per list when an iterator is made; lengths
+    // are read for every scored document, so fault them all in now
+    _invertedMap.map( _invertedFile );
+    _directMap.map( _directFile );
+
+    if( _lengthsMap.map( _documentLengths ) )
+      _lengthsMap.advise( 0, _lengthsMap.size(), indri::file::MemoryMappedFile::WILLNEED );
+  }
+
   // this is not thread-safe.
   //  size_t cacheSize = lemur_compat::min<size_t>(_documentLengths.size(), MAX_DOCLENGTHS_CACHE);
   //_lengthsBuffer.cache( 0, cacheSize );
-  _lengthsBuffer.cache( 0, _documentLengths.size() );
+  if( !_lengthsMap.mapped() )
+    _lengthsBuffer.cache( 0, _documentLengths.size() );
 }
 
 //
@@ -104,6 +136,12 @@ void indri::index::DiskIndex::open( const std::string& base, const std::string&
 //
 
 void indri::index::DiskIndex::close() {
+  _termCache.close();
+  _dictionary.clear();
+  _invertedMap.unmap();
+  _lengthsMap.unmap();
+  _directMap.unmap();
+
   _frequentStringToTerm.close();
   _infrequentStringToTerm.close();
 
@@ -117,6 +155,11 @@ void indri::index::DiskIndex::close() {
 
   _invertedFile.close();
   _directFile.close();
+
+  if( _hasImpactLists ) {
+    _impactStringToList.close();
+    _impactFile.close();
+  }
 }
 
 //
@@ -124,6 +167,11 @@ void indri::index::DiskIndex::close() {
 //
 
 indri::index::DiskTermData* indri::index::DiskIndex::_fetchTermData( lemur::api::TERMID_T termID ) {
+  indri::index::DiskTermData* cached = _termCache.find( termID );
+
+  if( cached )
+    return cached;
+
   int dataSize = ::disktermdata_size((int)_fieldData.size());
   char *buffer = new char [dataSize];
   int actual;
@@ -145,6 +193,9 @@ indri::index::DiskTermData* indri::index::DiskIndex::_fetchTermData( lemur::api:
   indri::utility::RVLDecompressStream stream( buffer, actual );
   indri::index::DiskTermData* dt = disktermdata_decompress( stream, (int)_fieldData.size(), DiskTermData::WithString | DiskTermData::WithOffsets );
   delete[](buffer);
+
+  dt->termID = termID;
+  _termCache.insert( dt );
   return dt;
 }
 
@@ -153,6 +204,11 @@ indri::index::DiskTermData* indri::index::DiskIndex::_fetchTermData( lemur::api:
 //
 
 indri::index::DiskTermData* indri::index::DiskIndex::_fetchTermData( const char* term ) {
+  indri::index::DiskTermData* cached = _termCache.find( term );
+
+  if( cached )
+    return cached;
+
   int dataSize = ::disktermdata_size((int)_fieldData.size());
   char *buffer = new char [dataSize];
   int actual;
@@ -178,6 +234,12 @@ indri::index::DiskTermData* indri::index::DiskIndex::_fetchTermData( const char*
                                                                       DiskTermData::WithTermID | DiskTermData::WithOffsets );
   diskTermData->termID += adjust;
   delete[](buffer);
+
+  // the string isn't stored with this key; fill it in so the cached
+  // entry can answer lookups by term ID as well
+  strncpy( const_cast<char*>(diskTermData->termData->term), term, lemur::file::Keyfile::MAX_KEY_LENGTH+1 );
+  const_cast<char*>(diskTermData->termData->term)[lemur::file::Keyfile::MAX_KEY_LENGTH+1] = 0;
+  _termCache.insert( diskTermData );
   return diskTermData;
 }
 
@@ -203,6 +265,11 @@ lemur::api::DOCID_T indri::index::DiskIndex::documentBase() {
 
 lemur::api::TERMID_T indri::index::DiskIndex::term( const char* t ) 
 {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( t );
+    return e ? e->termID : 0;
+  }
+
   indri::index::DiskTermData* diskTermData = _fetchTermData( t );
   lemur::api::TERMID_T termID = 0;
   if( diskTermData ) {
@@ -226,6 +293,14 @@ lemur::api::TERMID_T indri::index::DiskIndex::term( const std::string& t ) {
 
 std::string indri::index::DiskIndex::term( lemur::api::TERMID_T termID ) {
   std::string result;
+
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( termID );
+    if( e )
+      result = _dictionary.term( *e );
+    return result;
+  }
+
   indri::index::DiskTermData* diskTermData = _fetchTermData( termID );
 
   if( diskTermData ) {
@@ -250,6 +325,12 @@ int indri::index::DiskIndex::documentLength( lemur::api::DOCID_T documentID ) {
   int length;
   UINT64 offset = sizeof(UINT32) * documentOffset;
 
+  if( _lengthsMap.mapped() ) {
+    assert( offset + sizeof(UINT32) <= _lengthsMap.size() );
+    memcpy( &length, _lengthsMap.data() + offset, sizeof(UINT32) );
+    return length;
+  }
+
   size_t actual = _lengthsBuffer.read( &length, offset, sizeof(UINT32) );
   assert( actual == sizeof(UINT32) );
   assert( length >= 0 );
@@ -269,6 +350,11 @@ UINT64 indri::index::DiskIndex::documentCount() {
 //
 
 UINT64 indri::index::DiskIndex::documentCount( const std::string& term ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( term.c_str() );
+    return e ? e->documentCount : 0;
+  }
+
   indri::index::DiskTermData* diskTermData = _fetchTermData( term.c_str() );
   UINT64 count = 0;
 
@@ -341,6 +427,11 @@ int indri::index::DiskIndex::field( const std::string& fieldName ) {
 //
 
 UINT64 indri::index::DiskIndex::termCount( const std::string& t ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( t.c_str() );
+    return e ? e->totalCount : 0;
+  }
+
   DiskTermData* diskTermData = _fetchTermData( t.c_str() );
   UINT64 count = 0;
 
@@ -357,6 +448,12 @@ UINT64 indri::index::DiskIndex::termCount( const std::string& t ) {
 //
 
 UINT64 indri::index::DiskIndex::fieldTermCount( const std::string& f, const std::string& t ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( t.c_str() );
+    int index = field( f );
+    return (e && index) ? _dictionary.fieldTotalCount( *e, index ) : 0;
+  }
+
   DiskTermData* diskTermData = _fetchTermData( t.c_str() );
   int index = field( f );
   UINT64 count = 0;
@@ -401,6 +498,12 @@ UINT64 indri::index::DiskIndex::fieldDocumentCount( const std::string& f ) {
 //
 
 UINT64 indri::index::DiskIndex::fieldDocumentCount( const std::string& f, const std::string& t ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( t.c_str() );
+    int index = field( f );
+    return (e && index) ? _dictionary.fieldDocumentCount( *e, index ) : 0;
+  }
+
   DiskTermData* diskTermData = _fetchTermData( t.c_str() );
   int index = field( f );
   UINT64 count = 0;
@@ -413,11 +516,34 @@ UINT64 indri::index::DiskIndex::fieldDocumentCount( const std::string& f, const
   return count;
 }
 
+//
+// _listBuffer
+//
+
+indri::file::SequentialReadBuffer* indri::index::DiskIndex::_listBuffer( INT64 startOffset, INT64 length, indri::utility::RegionAllocator* allocator ) {
+  if( _invertedMap.mapped() ) {
+    _invertedMap.advise( startOffset, length, indri::file::MemoryMappedFile::SEQUENTIAL );
+    return new (allocator) indri::file::SequentialReadBuffer( _invertedFile, _invertedMap.data(), _invertedMap.size() );
+  }
+
+  // truncate the length argument at 1MB, use it to pick a size for the readbuffer;
+  // the buffer is borrowed from the pool of the calling thread
+  length = lemur_compat::min<INT64>( length, 1024*1024 );
+  return new (allocator) indri::file::SequentialReadBuffer( _invertedFile, length, true );
+}
+
 //
 // docListIterator
 //
 
 indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( lemur::api::TERMID_T termID ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( termID );
+    if( !e )
+      return 0;
+    return new DiskDocListIterator( _listBuffer( e->startOffset, e->length ), e->startOffset, 0, _postingCodec, _blockDecoding );
+  }
+
   // find out where the iterator starts and ends
   DiskTermData* data = _fetchTermData( termID );
 
@@ -429,10 +555,7 @@ indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( lemur::
   INT64 length = data->length;
   ::disktermdata_delete( data );
 
-  // truncate the length argument at 1MB, use it to pick a size for the readbuffer
-  length = lemur_compat::min<INT64>( length, 1024*1024 );
-
-  return new DiskDocListIterator( new indri::file::SequentialReadBuffer( _invertedFile, length ), startOffset, 0 );
+  return new DiskDocListIterator( _listBuffer( startOffset, length ), startOffset, 0, _postingCodec, _blockDecoding );
 }
 
 //
@@ -440,6 +563,17 @@ indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( lemur::
 //
 
 indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( const std::string& term ) {
+  return docListIterator( term, 0 );
+}
+
+indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( const std::string& term, indri::utility::RegionAllocator* allocator ) {
+  if( _dictionary.loaded() ) {
+    const TermDictionary::entry* e = _dictionary.find( term.c_str() );
+    if( !e )
+      return 0;
+    return new (allocator) DiskDocListIterator( _listBuffer( e->startOffset, e->length, allocator ), e->startOffset, (int)_fieldData.size(), _postingCodec, _blockDecoding );
+  }
+
   // find out where the iterator starts and ends
   DiskTermData* data = _fetchTermData( term.c_str() );
 
@@ -451,10 +585,34 @@ indri::index::DocListIterator* indri::index::DiskIndex::docListIterator( const s
   INT64 length = data->length;
   ::disktermdata_delete( data );
 
-  // truncate the length argument at 1MB, use it to pick a size for the readbuffer
-  length = lemur_compat::min<INT64>( length, 1024*1024 );
+  return new (allocator) DiskDocListIterator( _listBuffer( startOffset, length, allocator ), startOffset, (int)_fieldData.size(), _postingCodec, _blockDecoding );
+}
+
+//
+// impactListIterator
+//
+
+indri::index::ImpactListIterator* indri::index::DiskIndex::impactListIterator( const std::string& term, indri::utility::RegionAllocator* allocator ) {
+  if( !_hasImpactLists )
+    return 0;
+
+  // the value is the rvl start offset and length of the list
+  char buffer[32];
+  int actual = 0;
 
-  return new DiskDocListIterator( new indri::file::SequentialReadBuffer( _invertedFile, length ), startOffset, (int)_fieldData.size() );
+  if( !_impactStringToList.get( term.c_str(), buffer, actual, sizeof(buffer) ) )
+    return 0;
+
+  INT64 startOffset;
+  INT64 length;
+  indri::utility::RVLDecompressStream stream( buffer, actual );
+  stream >> startOffset
+         >> length;
+
+  // the buffer is sized like a doc list's and borrowed from the pool
+  INT64 bufferLength = lemur_compat::min<INT64>( length, 1024*1024 );
+  indri::file::SequentialReadBuffer* file = new (allocator) indri::file::SequentialReadBuffer( _impactFile, (size_t) bufferLength, true );
+  return new (allocator) ImpactListIterator( file, startOffset, length );
 }
 
 //
@@ -468,6 +626,12 @@ const indri::index::TermList* indri::index::DiskIndex::termList( lemur::api::DOC
   _documentStatistics.read( &documentData, (documentID-1)*sizeof(DocumentData), sizeof(DocumentData) );
   
   TermList* termList = new TermList;
+
+  if( _directMap.mapped() ) {
+    termList->read( _directMap.data() + documentData.offset, documentData.byteLength );
+    return termList;
+  }
+
   char* buffer = new char[documentData.byteLength];
 
   _directFile.read( buffer, documentData.offset, documentData.byteLength );
@@ -488,6 +652,14 @@ indri::index::TermListFileIterator* indri::index::DiskIndex::termListFileIterato
 //
 // iteratorLock
 //
+// A disk index is read-only, so any number of threads may make and read
+// iterators at once, including the partitions of one query that cover
+// different ranges of this index.  Each iterator reads through a buffer
+// of its own (with pread, or from the mapping), the document lengths are
+// mapped or cached whole when the index is opened, the interior blocks of
+// the term trees are pinned at open, and the term and leaf block caches
+// lock each shard.  Nothing needs to be serialized.
+//
 
 indri::thread::Lockable* indri::index::DiskIndex::iteratorLock() {
   return 0;
@@ -15,6 +15,8 @@
 // 15 November 2004 -- tds
 //
 #include <cstdlib>
+#include <cstring>
+#include <assert.h>
 #include <string>
 #include "indri/indri-platform.h"
 #include "indri/File.hpp"
@@ -25,7 +27,6 @@
 #endif
 
 #include "lemur/Exception.hpp"
-#include "indri/ScopedLock.hpp"
 
 //
 // File constructor
@@ -149,26 +150,28 @@ bool indri::file::File::openTemporary( std::string& fileName ) {
   return true;
 }
 
+//
+// read
+//
+// Reads are positional and don't touch any state in the File object, so
+// any number of threads can read from one File at the same time without
+// a lock: pread on POSIX, an OVERLAPPED offset on Windows.
+//
+
 size_t indri::file::File::read( void* buffer, UINT64 position, size_t length ) {
 #ifdef WIN32
   assert( _handle != INVALID_HANDLE_VALUE );
 
-  indri::thread::ScopedLock sl( _mutex );
-  LARGE_INTEGER actual;
-  BOOL result;
-  LARGE_INTEGER largePosition;
-  largePosition.QuadPart = position;
-
-  result = SetFilePointerEx( _handle, largePosition, &actual, FILE_BEGIN ); 
-  assert( largePosition.QuadPart == actual.QuadPart );
+  OVERLAPPED overlapped;
+  memset( &overlapped, 0, sizeof overlapped );
+  overlapped.Offset = DWORD( position & 0xffffffff );
+  overlapped.OffsetHigh = DWORD( position >> 32 );
 
-  if( !result )
-    LEMUR_THROW( LEMUR_IO_ERROR, "Failed to seek to some file position" );
+  DWORD actualBytes = 0;
+  BOOL result = ::ReadFile( _handle, buffer, DWORD(length), &actualBytes, &overlapped );
 
-  DWORD actualBytes;
-  result = ::ReadFile( _handle, buffer, length, &actualBytes, NULL );
-
-  if( !result )
+  // reading at or past the end of the file is a short read, not an error
+  if( !result && ::GetLastError() != ERROR_HANDLE_EOF )
     LEMUR_THROW( LEMUR_IO_ERROR, "Error when reading file" );
 
   return actualBytes;
@@ -190,20 +193,13 @@ size_t indri::file::File::write( const void* buffer, UINT64 position, size_t len
 #ifdef WIN32
   assert( _handle != INVALID_HANDLE_VALUE );
 
-  indri::thread::ScopedLock sl( _mutex );
-  LARGE_INTEGER actual;
-  BOOL result;
-  LARGE_INTEGER largePosition;
-  largePosition.QuadPart = position;
-
-  result = SetFilePointerEx( _handle, largePosition, &actual, FILE_BEGIN ); 
-  assert( largePosition.QuadPart == actual.QuadPart );
-
-  if( !result )
-    LEMUR_THROW( LEMUR_IO_ERROR, "Failed to seek to some file position" );
+  OVERLAPPED overlapped;
+  memset( &overlapped, 0, sizeof overlapped );
+  overlapped.Offset = DWORD( position & 0xffffffff );
+  overlapped.OffsetHigh = DWORD( position >> 32 );
 
-  DWORD actualBytes;
-  result = ::WriteFile( _handle, buffer, length, &actualBytes, NULL );
+  DWORD actualBytes = 0;
+  BOOL result = ::WriteFile( _handle, buffer, DWORD(length), &actualBytes, &overlapped );
 
   if( !result )
     LEMUR_THROW( LEMUR_IO_ERROR, "Error when writing file" );
@@ -0,0 +1,175 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// ImpactListIterator
+//
+
+#include "indri/ImpactListIterator.hpp"
+#include "lemur/RVLCompress.hpp"
+#include "lemur/Exception.hpp"
+#include <string.h>
+
+//
+// -------------------
+// Impact list format:
+// -------------------
+//      for each segment, highest count/length first:
+//        int (4b)    segment length (bytes after this field)
+//        RVLCompressed:
+//          posting count
+//          count of the posting with the largest count/length
+//          length of that document
+//          for each posting, in document order:
+//            delta document ID (delta encoded by segment)
+//            unique term count
+//            count
+//
+// The impactString tree of the index maps each term to the
+// RVLCompressed start offset and length of its list in impactFile.
+//
+
+indri::index::ImpactListIterator::ImpactListIterator( indri::file::SequentialReadBuffer* buffer, UINT64 startOffset, UINT64 length ) :
+  _file(buffer),
+  _startOffset(startOffset),
+  _endOffset(startOffset + length),
+  _nextOffset(startOffset),
+  _finished(true),
+  _entries(0),
+  _entriesEnd(0),
+  _lastDocument(0),
+  _postingsDecoded(0)
+{
+  memset( &_segment, 0, sizeof(_segment) );
+}
+
+indri::index::ImpactListIterator::~ImpactListIterator() {
+  delete _file;
+}
+
+//
+// _readSegment
+//
+
+void indri::index::ImpactListIterator::_readSegment() {
+  if( _nextOffset >= _endOffset ) {
+    _finished = true;
+    return;
+  }
+
+  UINT32 segmentLength;
+  _file->seek( _nextOffset );
+  _file->read( &segmentLength, sizeof(UINT32) );
+
+  if( _nextOffset + sizeof(UINT32) + segmentLength > _endOffset )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Impact list ends early." );
+
+  _entries = (const char*) _file->read( segmentLength );
+  _entriesEnd = _entries + segmentLength;
+  _nextOffset += sizeof(UINT32) + segmentLength;
+
+  _entries = lemur::utility::RVLCompress::decompress_int( _entries, _segment.size );
+  _entries = lemur::utility::RVLCompress::decompress_int( _entries, _segment.count );
+  _entries = lemur::utility::RVLCompress::decompress_int( _entries, _segment.length );
+  _segment.decoded = 0;
+  _lastDocument = 0;
+  _finished = false;
+}
+
+//
+// startIteration
+//
+
+void indri::index::ImpactListIterator::startIteration() {
+  _nextOffset = _startOffset;
+  _readSegment();
+}
+
+//
+// nextSegment
+//
+
+bool indri::index::ImpactListIterator::nextSegment() {
+  _readSegment();
+  return !_finished;
+}
+
+//
+// finished
+//
+
+bool indri::index::ImpactListIterator::finished() const {
+  return _finished;
+}
+
+//
+// currentSegment
+//
+
+const indri::index::ImpactListIterator::Segment& indri::index::ImpactListIterator::currentSegment() const {
+  return _segment;
+}
+
+//
+// decode
+//
+
+const indri::index::ImpactListIterator::Segment& indri::index::ImpactListIterator::decode( int postings ) {
+  if( postings > _segment.size )
+    postings = _segment.size;
+
+  if( _documents.size() < size_t(postings) ) {
+    _documents.resize( postings );
+    _counts.resize( postings );
+    #ifdef DOC_UNIQUE_TERM_COUNTS
+    _uniqueTermCounts.resize( postings );
+    #endif
+  }
+
+  for( int i=_segment.decoded; i<postings; i++ ) {
+    int delta;
+    int uniqueTerms;
+
+    if( _entries >= _entriesEnd )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Impact list ends early." );
+
+    _entries = lemur::utility::RVLCompress::decompress_int( _entries, delta );
+    _entries = lemur::utility::RVLCompress::decompress_int( _entries, uniqueTerms );
+    _entries = lemur::utility::RVLCompress::decompress_int( _entries, _counts[i] );
+
+    _lastDocument += delta;
+    _documents[i] = _lastDocument;
+    #ifdef DOC_UNIQUE_TERM_COUNTS
+    _uniqueTermCounts[i] = uniqueTerms;
+    #endif
+  }
+
+  if( postings > _segment.decoded ) {
+    _postingsDecoded += postings - _segment.decoded;
+    _segment.decoded = postings;
+  }
+
+  _segment.documents = _documents.size() ? &_documents[0] : 0;
+  _segment.counts = _counts.size() ? &_counts[0] : 0;
+  #ifdef DOC_UNIQUE_TERM_COUNTS
+  _segment.uniqueTermCounts = _uniqueTermCounts.size() ? &_uniqueTermCounts[0] : 0;
+  #endif
+  return _segment;
+}
+
+//
+// addCounters
+//
+
+void indri::index::ImpactListIterator::addCounters( indri::utility::QueryCounters& counters ) {
+  counters.postingsDecoded += _postingsDecoded;
+  counters.bytesRead += _file->bytesRead();
+}
@@ -18,6 +18,8 @@
 
 #include "indri/InferenceNetwork.hpp"
 #include "indri/SkippingCapableNode.hpp"
+#include "indri/TermAtATimeAccumulator.hpp"
+#include "indri/TermFrequencyBeliefNode.hpp"
 
 #include "indri/DocListIterator.hpp"
 #include "indri/DocExtentListIterator.hpp"
@@ -33,6 +35,9 @@ const static int CLOSE_ITERATOR_RANGE = 5000;
 //
 
 inline void indri::infnet::InferenceNetwork::_moveDocListIterators( lemur::api::DOCID_T candidate ) {
+  for( size_t i=0; i<_listDrivers.size(); i++ )
+    _listDrivers[i]->advance( candidate );
+
   if( _closeIterators.size() && candidate < _closeIteratorBound ) {
     // we're close to this document, so only advance the iterators that are close
     indri::utility::greedy_vector<indri::index::DocListIterator*>::iterator iter;
@@ -41,19 +46,16 @@ inline void indri::infnet::InferenceNetwork::_moveDocListIterators( lemur::api::
       (*iter)->nextEntry( candidate );
     }
   } else {
-    std::vector<indri::index::DocListIterator*>::iterator iter;
-
     _closeIterators.clear();
     _closeIteratorBound = candidate + CLOSE_ITERATOR_RANGE;
 
-    for( iter = _docIterators.begin(); iter != _docIterators.end(); iter++ ) {
-      if( *iter ) {
-        (*iter)->nextEntry( candidate );
+    for( size_t i=0; i<_movedIterators.size(); i++ ) {
+      indri::index::DocListIterator* iterator = _movedIterators[i];
+      iterator->nextEntry( candidate );
 
-        if( !(*iter)->finished() &&
-            (*iter)->currentEntry()->document < _closeIteratorBound ) {
-          _closeIterators.push_back( *iter );
-        }
+      if( !iterator->finished() &&
+          iterator->currentEntry()->document < _closeIteratorBound ) {
+        _closeIterators.push_back( iterator );
       }
     }
   }
@@ -87,7 +89,15 @@ void indri::infnet::InferenceNetwork::_moveToDocument( lemur::api::DOCID_T candi
 //
 
 void indri::infnet::InferenceNetwork::_indexFinished( indri::index::Index& index ) {
+  _movedIterators.clear();
+  _listDrivers.clear();
+
   // doc iterators
+  for( size_t i=0; i<_docIterators.size(); i++ ) {
+    if( _docIterators[i] )
+      _docIterators[i]->addCounters( _listCounters );
+  }
+
   indri::utility::delete_vector_contents<indri::index::DocListIterator*>( _docIterators );
 
   // field iterators
@@ -104,13 +114,20 @@ void indri::infnet::InferenceNetwork::_indexChanged( indri::index::Index& index
 
   // doc iterators
   for( size_t i=0; i<_termNames.size(); i++ ) {
-    indri::index::DocListIterator* iterator = index.docListIterator( _termNames[i] );
-    if( iterator )
+    indri::index::DocListIterator* iterator = index.docListIterator( _termNames[i], _allocator );
+    if( iterator ) {
+      // positions are only read by extent operators; without any, the
+      // lists can skip decoding them
+      iterator->countsOnly( _listIteratorNodes.empty() );
       iterator->startIteration();
+    }
 
     _docIterators.push_back( iterator );
   }
 
+  _drivenIterators.assign( _docIterators.size(), 0 );
+  _listDrivers.clear();
+
   // extent iterator nodes
   std::vector<ListIteratorNode*>::iterator diter;
   for( diter = _listIteratorNodes.begin(); diter != _listIteratorNodes.end(); diter++ ) {
@@ -123,6 +140,13 @@ void indri::infnet::InferenceNetwork::_indexChanged( indri::index::Index& index
     (*biter)->indexChanged( index );
   }
 
+  // the lists no belief node drives
+  _movedIterators.clear();
+  for( size_t i=0; i<_docIterators.size(); i++ ) {
+    if( _docIterators[i] && !_drivenIterators[i] )
+      _movedIterators.push_back( _docIterators[i] );
+  }
+
   // evaluator nodes
   std::vector<indri::infnet::EvaluatorNode*>::iterator eiter;
   for( eiter = _evaluators.begin(); eiter != _evaluators.end(); eiter++ ) {
@@ -160,8 +184,9 @@ void indri::infnet::InferenceNetwork::_evaluateDocument( indri::index::Index& in
 // InferenceNetwork constructor
 //
 
-indri::infnet::InferenceNetwork::InferenceNetwork( indri::collection::Repository& repository ) :
+indri::infnet::InferenceNetwork::InferenceNetwork( indri::collection::Repository& repository, indri::utility::RegionAllocator* allocator ) :
   _repository(repository),
+  _allocator(allocator),
   _closeIteratorBound(-1)
 {
 }
@@ -192,10 +217,28 @@ indri::index::DocExtentListIterator* indri::infnet::InferenceNetwork::getFieldIt
 }
 
 int indri::infnet::InferenceNetwork::addDocIterator( const std::string& termName ) {
+  // queries evaluated together read each list once
+  for( size_t i=0; i<_termNames.size(); i++ ) {
+    if( _termNames[i] == termName ) {
+      _termUsers[i]++;
+      return (int)i;
+    }
+  }
+
   _termNames.push_back( termName );
+  _termUsers.push_back( 1 );
   return (int)_termNames.size()-1;
 }
 
+bool indri::infnet::InferenceNetwork::sharedDocIterator( int index ) const {
+  return _termUsers[index] > 1;
+}
+
+void indri::infnet::InferenceNetwork::driveDocIterator( int index, indri::infnet::TermFrequencyBeliefNode* node ) {
+  _drivenIterators[index] = 1;
+  _listDrivers.push_back( node );
+}
+
 int indri::infnet::InferenceNetwork::addFieldIterator( const std::string& fieldName ) {
   _fieldNames.push_back( fieldName );
   return (int)_fieldNames.size()-1;
@@ -226,11 +269,23 @@ void indri::infnet::InferenceNetwork::addComplexEvaluatorNode( indri::infnet::Ev
   _complexEvaluators.push_back( complexEvaluator );
 }
 
+void indri::infnet::InferenceNetwork::addTermAtATimeEvaluatorNode( indri::infnet::TermAtATimeAccumulator* termAtATimeEvaluator ) {
+  _evaluators.push_back( termAtATimeEvaluator );
+  _termAtATimeEvaluators.push_back( termAtATimeEvaluator );
+}
+
 const std::vector<indri::infnet::EvaluatorNode*>& indri::infnet::InferenceNetwork::getEvaluators() const {
   return _evaluators;
 }
 
-void indri::infnet::InferenceNetwork::_evaluateIndex( indri::index::Index& index ) {
+void indri::infnet::InferenceNetwork::_evaluateIndex( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  // term-at-a-time evaluators read the lists on their own
+  for( size_t i=0; i<_termAtATimeEvaluators.size(); i++ ) {
+    indri::index::DeletedDocumentList::read_transaction* deleted = _repository.deletedList().getReadTransaction();
+    _termAtATimeEvaluators[i]->evaluateIndex( index, deleted, begin, end );
+    delete deleted;
+  }
+
   // don't need to do anything unless there are some
   // evaluators in the network that need full evaluation
 
@@ -245,6 +300,24 @@ void indri::infnet::InferenceNetwork::_evaluateIndex( indri::index::Index& index
     lemur::api::DOCID_T lastCandidate = MAX_INT32; // 64
     int scoredDocuments = 0;
     lemur::api::DOCID_T candidate = 0;
+
+    // the last document in range
+    if( end <= maximumDocument )
+      maximumDocument = end - 1;
+
+    if( maximumDocument < index.documentBase() || begin > maximumDocument )
+      return;
+
+    if( begin > index.documentBase() ) {
+      // start the lists at the range, and let the belief nodes pass over
+      // any topdocs candidates that come before it
+      _moveToDocument( begin );
+      lastCandidate = begin;
+
+      for( size_t i=0; i<_beliefNodes.size(); i++ )
+        _beliefNodes[i]->skipTo( begin );
+    }
+
     indri::index::DeletedDocumentList::read_transaction* deleted;
     deleted = _repository.deletedList().getReadTransaction();
 
@@ -297,28 +370,80 @@ const indri::infnet::InferenceNetwork::MAllResults& indri::infnet::InferenceNetw
   // count this query occurrence
   _repository.countQuery();
 
+  _evaluate( 0, MAX_INT32 );
+  return _results;
+}
+
+//
+// evaluate
+//
+
+const indri::infnet::InferenceNetwork::MAllResults& indri::infnet::InferenceNetwork::evaluate( lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  _evaluate( begin, end );
+  return _results;
+}
+
+//
+// evaluate
+//
+
+const indri::infnet::InferenceNetwork::MAllResults& indri::infnet::InferenceNetwork::evaluate( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  _evaluateSegment( index, begin, end );
+  _collectResults();
+  return _results;
+}
+
+//
+// addCounters
+//
+
+void indri::infnet::InferenceNetwork::addCounters( indri::utility::QueryCounters& counters ) {
+  counters += _listCounters;
+
+  for( size_t i=0; i<_evaluators.size(); i++ )
+    _evaluators[i]->addCounters( counters );
+}
+
+//
+// _evaluateSegment
+//
+
+void indri::infnet::InferenceNetwork::_evaluateSegment( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  indri::thread::ScopedLock iterators( index.iteratorLock() );
+
+  indri::thread::ScopedLock statistics( index.statisticsLock() );
+  _indexChanged( index );
+  statistics.unlock();
+
+  // evaluate query against the index
+  _evaluateIndex( index, begin, end );
+
+  // remove all the iterators
+  _indexFinished( index );
+}
+
+//
+// _evaluate
+//
+
+void indri::infnet::InferenceNetwork::_evaluate( lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
   // fetch the current index state
   indri::collection::Repository::index_state indexes = _repository.indexes();
   
   for( size_t i=0; i<indexes->size(); i++ ) {
-    indri::index::Index& index = *(*indexes)[i];
-    indri::thread::ScopedLock iterators( index.iteratorLock() );
-
-    indri::thread::ScopedLock statistics( index.statisticsLock() );
-    _indexChanged( index );
-    statistics.unlock();
+    _evaluateSegment( *(*indexes)[i], begin, end );
+  }
 
-    // evaluate query against the index
-    _evaluateIndex( index );
+  _collectResults();
+}
 
-    // remove all the iterators
-    _indexFinished( index );
-  }
+//
+// _collectResults
+//
 
+void indri::infnet::InferenceNetwork::_collectResults() {
   _results.clear();
   for( size_t i=0; i<_evaluators.size(); i++ ) {
     _results[ _evaluators[i]->getName() ] = _evaluators[i]->getResults();
   }
-
-  return _results;
 }
@@ -23,11 +23,15 @@
 #include "indri/ContextSimpleCountAccumulator.hpp"
 #include "indri/NullScorerNode.hpp"
 #include "indri/TermFrequencyBeliefNode.hpp"
+#include "indri/PertubePolicy.hpp"
+#include "indri/TermScoreFunctionFactory.hpp"
 #include "indri/WeightedAndNode.hpp"
 #include "indri/ScoredExtentAccumulator.hpp"
+#include "indri/TermAtATimeAccumulator.hpp"
 #include "indri/CompressedCollection.hpp"
 #include "indri/delete_range.hpp"
 #include "indri/ScopedLock.hpp"
+#include "indri/merge_scored_results.hpp"
 #include <vector>
 #include <algorithm>
 
@@ -42,15 +46,25 @@ namespace indri
     class LocalQueryServerResponse : public QueryServerResponse {
     private:
       indri::infnet::InferenceNetwork::MAllResults _results;
+      indri::utility::QueryProfile _profile;
 
     public:
       LocalQueryServerResponse( const indri::infnet::InferenceNetwork::MAllResults& results ) :
         _results(results) {
       }
+
+      LocalQueryServerResponse( const indri::infnet::InferenceNetwork::MAllResults& results, const indri::utility::QueryProfile& profile ) :
+        _results(results),
+        _profile(profile) {
+      }
   
       indri::infnet::InferenceNetwork::MAllResults& getResults() {
         return _results;
       }
+
+      const indri::utility::QueryProfile& getProfile() {
+        return _profile;
+      }
     };
 
     class LocalQueryServerMetadataResponse : public QueryServerMetadataResponse {
@@ -74,10 +88,44 @@ namespace indri
 // Class code
 //
 
-indri::server::LocalQueryServer::LocalQueryServer( indri::collection::Repository& repository ) : _repository(repository)
+indri::server::LocalQueryServer::LocalQueryServer( indri::collection::Repository& repository ) :
+  _repository(repository),
+  _pool(0)
 {
   // if supplied and false, turn off optimization for all queries.
   _optimizeParameter = indri::api::Parameters::instance().get( "optimize", true );
+
+  // split each query over this many threads; the calling thread is one
+  _partitions = lemur_compat::max( 1, (int) indri::api::Parameters::instance().get( "partitions", 1 ) );
+  if( _partitions > 1 )
+    _pool = new indri::thread::WorkerPool( _partitions - 1 );
+}
+
+indri::server::LocalQueryServer::~LocalQueryServer() {
+  delete _pool;
+  indri::utility::delete_vector_contents<indri::utility::RegionAllocator*>( _allocators );
+}
+
+//
+// _allocator
+//
+
+indri::utility::RegionAllocator* indri::server::LocalQueryServer::_allocator( size_t partition ) {
+  while( _allocators.size() <= partition )
+    _allocators.push_back( new indri::utility::RegionAllocator );
+
+  return _allocators[partition];
+}
+
+//
+// _resetAllocators
+//
+// Called once the networks of a query have been deleted.
+//
+
+void indri::server::LocalQueryServer::_resetAllocators() {
+  for( size_t i=0; i<_allocators.size(); i++ )
+    _allocators[i]->reset();
 }
 
 //
@@ -117,32 +165,115 @@ std::string indri::server::LocalQueryServer::processTerm( std::string s) {
 }
 
 indri::server::QueryServerResponse* indri::server::LocalQueryServer::getGlobalStatistics( std::vector<std::string>& queryTerms ) {
-  indri::infnet::InferenceNetwork* network = new indri::infnet::InferenceNetwork(_repository);
+  indri::utility::RegionAllocator* allocator = _allocator( 0 );
+  indri::infnet::InferenceNetwork* network = new indri::infnet::InferenceNetwork( _repository, allocator );
   for (size_t i = 0; i != queryTerms.size(); i++) {
-    indri::infnet::ContextSimpleCountAccumulator *contextCount = new indri::infnet::ContextSimpleCountAccumulator( queryTerms[i] );
+    indri::infnet::ContextSimpleCountAccumulator *contextCount = new (allocator) indri::infnet::ContextSimpleCountAccumulator( queryTerms[i] );
     network->addEvaluatorNode( contextCount );
   }
   
   indri::infnet::InferenceNetwork::MAllResults result;
-  result = network->evaluate();
+
+  try {
+    result = network->evaluate();
+  } catch( lemur::api::Exception& e ) {
+    delete network;
+    _resetAllocators();
+    LEMUR_RETHROW( e, "Couldn't collect the statistics of the query terms." );
+  }
+
+  delete network;
+  _resetAllocators();
 
   return new indri::server::LocalQueryServerResponse( result );  
 }
 
+//
+// termCount
+//
+
+INT64 indri::server::LocalQueryServer::termCount() {
+  indri::collection::Repository::index_state indexes = _repository.indexes();
+  INT64 total = 0;
+
+  for( size_t i=0; i<indexes->size(); i++ ) {
+    indri::thread::ScopedLock lock( (*indexes)[i]->statisticsLock() );
+    total += (*indexes)[i]->termCount();
+  }
+
+  return total;
+}
+
+INT64 indri::server::LocalQueryServer::termCount( const std::string& term ) {
+  indri::collection::Repository::index_state indexes = _repository.indexes();
+  INT64 total = 0;
+
+  for( size_t i=0; i<indexes->size(); i++ ) {
+    indri::thread::ScopedLock lock( (*indexes)[i]->statisticsLock() );
+    total += (*indexes)[i]->termCount( term );
+  }
+
+  return total;
+}
+
+//
+// documentCount
+//
+
+INT64 indri::server::LocalQueryServer::documentCount() {
+  indri::collection::Repository::index_state indexes = _repository.indexes();
+  INT64 total = 0;
+
+  for( size_t i=0; i<indexes->size(); i++ ) {
+    indri::thread::ScopedLock lock( (*indexes)[i]->statisticsLock() );
+    total += (*indexes)[i]->documentCount();
+  }
+
+  return total;
+}
+
+INT64 indri::server::LocalQueryServer::documentCount( const std::string& term ) {
+  indri::collection::Repository::index_state indexes = _repository.indexes();
+  INT64 total = 0;
+
+  for( size_t i=0; i<indexes->size(); i++ ) {
+    indri::thread::ScopedLock lock( (*indexes)[i]->statisticsLock() );
+    total += (*indexes)[i]->documentCount( term );
+  }
+
+  return total;
+}
+
 void indri::server::LocalQueryServer::_buildInferenceNetwork(indri::infnet::InferenceNetwork* network, 
       std::map<std::string, std::map<std::string, double> >& queryTerms, 
       std::map<std::string, double>& modelParas, 
-      int resultsRequested) {
+      int resultsRequested,
+      indri::infnet::SharedThreshold* sharedThreshold,
+      const std::string& nodeName,
+      bool sharedLists ) {
 
-  /* _buildCombineNode */
-  std::string nodeName("ranking");
-  indri::infnet::WeightedAndNode* wandNode = new indri::infnet::WeightedAndNode( nodeName );
   size_t querySize = queryTerms.size();
   double queryLength = 0.0;
   for (std::map<std::string, std::map<std::string, double> >::iterator it = queryTerms.begin(); it != queryTerms.end(); it++) {
     queryLength += it->second["weight"];
   }
 
+  // resolve the parameter map once; the scoring path only sees the typed copy
+  indri::query::ModelParameters parameters( modelParas );
+  indri::utility::RegionAllocator* allocator = network->allocator();
+
+  // term-at-a-time queries need only the lists and score functions
+  indri::infnet::TermAtATimeAccumulator* termAtATime = 0;
+  // (a term-at-a-time evaluator reads whole lists by itself, so queries
+  // sharing lists are always evaluated document-at-a-time)
+  if( parameters.evaluation == indri::query::ModelParameters::TERM_AT_A_TIME && !sharedLists )
+    termAtATime = new (allocator) indri::infnet::TermAtATimeAccumulator( nodeName, *network, resultsRequested, parameters.postingBudget );
+
+  /* _buildCombineNode */
+  indri::infnet::WeightedAndNode* wandNode = 0;
+  if( !termAtATime )
+    wandNode = new (allocator) indri::infnet::WeightedAndNode( nodeName );
+
   /* _buildTermScoreFunction */
   for (std::map<std::string, std::map<std::string, double> >::iterator it = queryTerms.begin(); it != queryTerms.end(); it++) {
     indri::infnet::BeliefNode* belief = 0;
@@ -155,59 +286,34 @@ void indri::server::LocalQueryServer::_buildInferenceNetwork(indri::infnet::Infe
     if (collTermCnt == 0) collTermCnt = 1; // For non-existant fields.
 
     double avdl = collTermCnt / double(docCnt);
-    switch(int(modelParas["__PERTUBE_TYPE__"])) {
-      case 1 : // LV1 
-        avdl = (1-modelParas["__PERTUBE_b__"])*avdl+modelParas["__PERTUBE_b__"]*1000000/double(docCnt);
-        break;
-      case 2 : // LV2
-        break;
-      case 3 : // LV3
-        avdl *= modelParas["__PERTUBE_k__"]+1;
-        break;
-      case 4 : // TN1 (constant)
-        avdl += modelParas["__PERTUBE_k__"];
-        break;
-      case 5 : // TN2 (linear)
-        avdl *= 1+modelParas["__PERTUBE_b__"];
-        break;
-      case 6 : // TG1 (constant)
-        avdl += modelParas["__PERTUBE_k__"];
-        break;
-      case 7 : // TG1 (linear)
-        break;
-      case 8 : // TG2 (constant)
-        avdl += (queryLength-1)*modelParas["__PERTUBE_k__"];
-        break;
-      case 9 : // TG2 (linear)
-        break;
-      case 10 : // TG3 (constant)
-        avdl += queryLength*modelParas["__PERTUBE_k__"];
-        break;
-      case 11 : // TG3 (linear)
-        break;
-      default:
-        break;
-    } 
-
-    function = new indri::query::TermScoreFunction( 
-      collectionOccurence, 
-      collTermCnt, 
-      docFrequency, 
-      docCnt, 
-      avdl, 
-      queryLength, 
-      modelParas 
-    );
+    avdl = indri::query::pertube::averageDocumentLength( avdl, docCnt, queryLength, parameters );
+
+    indri::query::TermStatistics statistics;
+    statistics.collectionOccurrence = collectionOccurence;
+    statistics.collectionSize = collTermCnt;
+    statistics.documentOccurrences = docFrequency;
+    statistics.documentCount = docCnt;
+    statistics.avdl = avdl;
+    statistics.queryLength = queryLength;
+
+    function = indri::query::TermScoreFunctionFactory::get( statistics, parameters, allocator );
+
+    if( termAtATime ) {
+      int listID = collectionOccurence > 0 ? network->addDocIterator( it->first ) : -1;
+      termAtATime->addTerm( it->first, listID, *function, it->second["weight"] );
+      network->addScoreFunction( function );
+      continue;
+    }
 
     if( collectionOccurence > 0 ) {
       int listID = network->addDocIterator( it->first );
-      belief = new indri::infnet::TermFrequencyBeliefNode( it->first, *network, listID, *function, it->second["weight"] );
+      belief = indri::infnet::TermFrequencyBeliefNode::create( it->first, *network, listID, *function, it->second["weight"] );
     }
 
     // either there's no list here, or there aren't any occurrences
     // in the local collection, so just use a NullScorerNode in place
     if( !belief ) {
-      belief = new indri::infnet::NullScorerNode( it->first, *function, it->second["weight"] );
+      belief = new (allocator) indri::infnet::NullScorerNode( it->first, *function, it->second["weight"] );
     }
 
     //wandNode->addChild( 1.0/double(querySize), belief );
@@ -216,12 +322,18 @@ void indri::server::LocalQueryServer::_buildInferenceNetwork(indri::infnet::Infe
     network->addBeliefNode( belief );
   }
 
+  if( termAtATime ) {
+    network->addTermAtATimeEvaluatorNode( termAtATime );
+    return;
+  }
+
   /* _buildCombineNode */
   network->addBeliefNode( wandNode );
 
   /* _buildScoreAccumulatorNode */
   indri::infnet::ScoredExtentAccumulator* accumulator = 
-    new indri::infnet::ScoredExtentAccumulator( nodeName, wandNode, resultsRequested );
+    new (allocator) indri::infnet::ScoredExtentAccumulator( nodeName, wandNode, resultsRequested );
+  accumulator->setSharedThreshold( sharedThreshold );
 
   network->addEvaluatorNode( accumulator );
   network->addComplexEvaluatorNode( accumulator );
@@ -232,11 +344,287 @@ indri::server::QueryServerResponse* indri::server::LocalQueryServer::runQuery(
     std::map<std::string, double>& modelParas, 
     int resultsRequested, 
     bool optimize ) {
-  indri::infnet::InferenceNetwork* network = new indri::infnet::InferenceNetwork(_repository);
-  _buildInferenceNetwork(network, queryTerms, modelParas, resultsRequested);
+  if( _partitions > 1 ) {
+    std::vector< std::map<std::string, std::map<std::string, double> > > batchTerms( 1, queryTerms );
+    std::vector< std::map<std::string, double> > batchParas( 1, modelParas );
+    return _runPartitionedQuery( batchTerms, batchParas, resultsRequested, false );
+  }
+
+  indri::utility::QueryProfile profile;
+  profile.start();
+
+  indri::infnet::InferenceNetwork* network = new indri::infnet::InferenceNetwork( _repository, _allocator( 0 ) );
+  indri::infnet::InferenceNetwork::MAllResults result;
+
+  try {
+    _buildInferenceNetwork(network, queryTerms, modelParas, resultsRequested);
+    profile.lap( indri::utility::QueryProfile::BUILD );
+    result = network->evaluate();
+  } catch( lemur::api::Exception& e ) {
+    delete network;
+    _resetAllocators();
+    LEMUR_RETHROW( e, "Couldn't evaluate the query." );
+  }
+
+  network->addCounters( profile.counters );
+  delete network;
+  _resetAllocators();
+  profile.lap( indri::utility::QueryProfile::EVALUATION );
+
+  return new indri::server::LocalQueryServerResponse( result, profile );
+}
+
+//
+// _buildBatchNetwork
+//
+// Builds the network of a single query (batch is false) or of a batch
+// of queries.  The queries of a batch share one network: a term used by
+// several of them has one list, so each block is decoded once and read
+// by the scorers of every query, and each query has an accumulator of
+// its own.  Every query still skips: a query doesn't move a list that
+// other queries read, it only notes how far it could have moved it (see
+// TermFrequencyBeliefNode::advance), and the network moves the lists to
+// the first candidate of any query.
+//
 
+void indri::server::LocalQueryServer::_buildBatchNetwork( indri::infnet::InferenceNetwork* network,
+      std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+      std::vector< std::map<std::string, double> >& modelParas,
+      int resultsRequested,
+      bool batch,
+      indri::infnet::SharedThreshold* sharedThreshold ) {
+  if( !batch ) {
+    _buildInferenceNetwork( network, queryTerms[0], modelParas[0], resultsRequested, sharedThreshold );
+    return;
+  }
+
+  for( size_t i=0; i<queryTerms.size(); i++ )
+    _buildInferenceNetwork( network, queryTerms[i], modelParas[i], resultsRequested, 0, batchResultName(i), true );
+}
+
+//
+// runQueryBatch
+//
+
+indri::server::QueryServerResponse* indri::server::LocalQueryServer::runQueryBatch(
+    std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+    std::vector< std::map<std::string, double> >& modelParas,
+    int resultsRequested ) {
+  if( queryTerms.size() != modelParas.size() )
+    LEMUR_THROW( LEMUR_BAD_PARAMETER_ERROR, "Every query of a batch needs its model parameters." );
+
+  if( _partitions > 1 )
+    return _runPartitionedQuery( queryTerms, modelParas, resultsRequested, true );
+
+  indri::utility::QueryProfile profile;
+  profile.start();
+
+  indri::infnet::InferenceNetwork* network = new indri::infnet::InferenceNetwork( _repository, _allocator( 0 ) );
   indri::infnet::InferenceNetwork::MAllResults result;
-  result = network->evaluate();
 
-  return new indri::server::LocalQueryServerResponse( result );
+  try {
+    _buildBatchNetwork( network, queryTerms, modelParas, resultsRequested, true, 0 );
+    profile.lap( indri::utility::QueryProfile::BUILD );
+    result = network->evaluate();
+  } catch( lemur::api::Exception& e ) {
+    delete network;
+    _resetAllocators();
+    LEMUR_RETHROW( e, "Couldn't evaluate the batch." );
+  }
+
+  network->addCounters( profile.counters );
+  delete network;
+  _resetAllocators();
+  profile.lap( indri::utility::QueryProfile::EVALUATION );
+
+  return new indri::server::LocalQueryServerResponse( result, profile );
+}
+
+//
+// Each partition of a query is a complete inference network of its own,
+// evaluated over one document range of one index.
+//
+
+namespace indri
+{
+  namespace server
+  {
+    class PartitionTask {
+    public:
+      indri::infnet::InferenceNetwork* network;
+      indri::index::Index* index;
+      lemur::api::DOCID_T begin;
+      lemur::api::DOCID_T end;
+      indri::infnet::InferenceNetwork::MAllResults results;
+      indri::utility::QueryCounters counters;
+
+      PartitionTask( indri::infnet::InferenceNetwork* n, indri::index::Index* i, lemur::api::DOCID_T b, lemur::api::DOCID_T e ) :
+        network(n), index(i), begin(b), end(e) {}
+
+      ~PartitionTask() {
+        delete network;
+      }
+
+      void run() {
+        results = network->evaluate( *index, begin, end );
+        network->addCounters( counters );
+      }
+    };
+
+    //
+    // The partitions of a group share an allocator, so they are run one
+    // after another on one thread.
+    //
+
+    class PartitionGroup : public indri::thread::WorkerPool::Task {
+    public:
+      std::vector<PartitionTask*> partitions;
+
+      void run() {
+        for( size_t i=0; i<partitions.size(); i++ )
+          partitions[i]->run();
+      }
+    };
+
+  }
+}
+
+//
+// _mergeResults
+//
+// Each partition keeps its own top resultsRequested documents, so the
+// answer is the best resultsRequested of their union.
+//
+
+static void _mergeResults( indri::infnet::InferenceNetwork::MAllResults& results,
+                           std::vector<indri::server::PartitionTask*>& partitionTasks,
+                           int resultsRequested ) {
+  std::map< std::string, std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > > > lists;
+
+  for( size_t i=0; i<partitionTasks.size(); i++ ) {
+    indri::infnet::InferenceNetwork::MAllResults::iterator nodeIter;
+
+    for( nodeIter = partitionTasks[i]->results.begin(); nodeIter != partitionTasks[i]->results.end(); nodeIter++ ) {
+      indri::infnet::EvaluatorNode::MResults::iterator listIter;
+
+      for( listIter = nodeIter->second.begin(); listIter != nodeIter->second.end(); listIter++ )
+        lists[nodeIter->first][listIter->first].push_back( &listIter->second );
+    }
+  }
+
+  std::map< std::string, std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > > >::iterator nodeIter;
+  for( nodeIter = lists.begin(); nodeIter != lists.end(); nodeIter++ ) {
+    std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > >::iterator listIter;
+
+    for( listIter = nodeIter->second.begin(); listIter != nodeIter->second.end(); listIter++ )
+      indri::utility::merge_scored_results( listIter->second, resultsRequested, results[nodeIter->first][listIter->first] );
+  }
+}
+
+//
+// _runPartitionedQuery
+//
+// Splits the query into partitions that are evaluated in parallel and
+// keeps the best resultsRequested documents of the union.  Every index
+// of the repository gets at least one partition, so segments are scored
+// concurrently; an index holding a large share of the documents is
+// further split into contiguous document ranges, about _partitions in
+// all.  The partitions share a pruning threshold, so a partition that
+// finds good documents early lets the others skip more.  A batch is
+// split the same way, with every query of the batch in each partition.
+// The partitions are dealt out to _partitions groups, each with one
+// allocator and run on one thread, so the allocators are reused across
+// indexes however many the repository has.
+//
+
+indri::server::QueryServerResponse* indri::server::LocalQueryServer::_runPartitionedQuery(
+    std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms,
+    std::vector< std::map<std::string, double> >& modelParas,
+    int resultsRequested,
+    bool batch ) {
+  // the index state keeps the indexes open until the tasks are done
+  indri::collection::Repository::index_state indexes = _repository.indexes();
+  INT64 totalDocuments = 0;
+
+  for( size_t i=0; i<indexes->size(); i++ )
+    totalDocuments += INT64( (*indexes)[i]->documentCount() );
+
+  indri::infnet::SharedThreshold threshold;
+  std::vector<PartitionGroup> groups( _partitions );
+  std::vector<PartitionTask*> partitionTasks;
+
+  indri::utility::QueryProfile profile;
+  profile.start();
+
+  // the network being built, until a task owns it
+  indri::infnet::InferenceNetwork* network = 0;
+
+  try {
+    for( size_t i=0; i<indexes->size(); i++ ) {
+      indri::index::Index* index = (*indexes)[i];
+      lemur::api::DOCID_T first = index->documentBase();
+      INT64 span = lemur_compat::max<INT64>( 1, INT64(index->documentMaximum()) - first );
+
+      // this index's share of the partitions, but at least one
+      INT64 share = totalDocuments ? (_partitions * INT64(index->documentCount()) + totalDocuments/2) / totalDocuments : 1;
+      int partitions = (int) lemur_compat::max<INT64>( 1, lemur_compat::min<INT64>( share, span ) );
+
+      for( int j=0; j<partitions; j++ ) {
+        lemur::api::DOCID_T begin = lemur::api::DOCID_T( first + span * j / partitions );
+        lemur::api::DOCID_T end = lemur::api::DOCID_T( first + span * (j+1) / partitions );
+
+        // the first and last ranges are open so that nothing is missed
+        if( j == 0 )
+          begin = 0;
+        if( j == partitions-1 )
+          end = MAX_INT32;
+
+        // the partition is built in the allocator of its group
+        size_t group = partitionTasks.size() % groups.size();
+        network = new indri::infnet::InferenceNetwork( _repository, _allocator( group ) );
+        _buildBatchNetwork( network, queryTerms, modelParas, resultsRequested, batch, &threshold );
+
+        partitionTasks.push_back( new PartitionTask( network, index, begin, end ) );
+        network = 0;
+        groups[group].partitions.push_back( partitionTasks.back() );
+      }
+    }
+  } catch( lemur::api::Exception& e ) {
+    delete network;
+    indri::utility::delete_vector_contents<PartitionTask*>( partitionTasks );
+    _resetAllocators();
+    LEMUR_RETHROW( e, "Couldn't build a partition of the query." );
+  }
+
+  // count the query once, not once per partition
+  _repository.countQuery();
+  profile.lap( indri::utility::QueryProfile::BUILD );
+
+  std::vector<indri::thread::WorkerPool::Task*> tasks;
+
+  for( size_t i=0; i<groups.size(); i++ ) {
+    if( groups[i].partitions.size() )
+      tasks.push_back( &groups[i] );
+  }
+
+  indri::infnet::InferenceNetwork::MAllResults results;
+
+  try {
+    _pool->run( tasks );
+  } catch( lemur::api::Exception& e ) {
+    indri::utility::delete_vector_contents<PartitionTask*>( partitionTasks );
+    _resetAllocators();
+    LEMUR_RETHROW( e, "Couldn't evaluate a partition of the query." );
+  }
+
+  _mergeResults( results, partitionTasks, resultsRequested );
+
+  for( size_t i=0; i<partitionTasks.size(); i++ )
+    profile.counters += partitionTasks[i]->counters;
+
+  indri::utility::delete_vector_contents<PartitionTask*>( partitionTasks );
+  _resetAllocators();
+  profile.lap( indri::utility::QueryProfile::EVALUATION );
+
+  return new indri::server::LocalQueryServerResponse( results, profile );
 }
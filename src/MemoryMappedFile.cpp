@@ -0,0 +1,132 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// MemoryMappedFile
+//
+
+#include "indri/MemoryMappedFile.hpp"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//
+// MemoryMappedFile constructor
+//
+
+indri::file::MemoryMappedFile::MemoryMappedFile() :
+  _data(0),
+  _size(0)
+#ifdef WIN32
+  , _mapping(NULL)
+#endif
+{
+}
+
+//
+// MemoryMappedFile destructor
+//
+
+indri::file::MemoryMappedFile::~MemoryMappedFile() {
+  unmap();
+}
+
+//
+// map
+//
+
+bool indri::file::MemoryMappedFile::map( File& file ) {
+  unmap();
+
+  UINT64 size = file.size();
+
+  // mmap refuses empty files, and a mapping larger than the address
+  // space can't work at all; callers fall back to reading the file
+  if( size == 0 || size != UINT64(size_t(size)) )
+    return false;
+
+#ifdef WIN32
+  _mapping = ::CreateFileMapping( file._handle, NULL, PAGE_READONLY, 0, 0, NULL );
+
+  if( _mapping == NULL )
+    return false;
+
+  _data = (const char*) ::MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 );
+
+  if( !_data ) {
+    ::CloseHandle( _mapping );
+    _mapping = NULL;
+    return false;
+  }
+#else
+  void* data = ::mmap( 0, size_t(size), PROT_READ, MAP_SHARED, file._handle, 0 );
+
+  if( data == MAP_FAILED )
+    return false;
+
+  _data = (const char*) data;
+#endif
+
+  _size = size;
+  return true;
+}
+
+//
+// unmap
+//
+
+void indri::file::MemoryMappedFile::unmap() {
+  if( !_data )
+    return;
+
+#ifdef WIN32
+  ::UnmapViewOfFile( _data );
+  ::CloseHandle( _mapping );
+  _mapping = NULL;
+#else
+  ::munmap( (void*) _data, size_t(_size) );
+#endif
+
+  _data = 0;
+  _size = 0;
+}
+
+//
+// advise
+//
+
+void indri::file::MemoryMappedFile::advise( UINT64 offset, UINT64 length, Advice advice ) {
+#if !defined(WIN32) && defined(MADV_SEQUENTIAL)
+  if( !_data || offset >= _size )
+    return;
+
+  if( length > _size - offset )
+    length = _size - offset;
+
+  // madvise wants a page-aligned start
+  UINT64 pageSize = UINT64( ::sysconf( _SC_PAGESIZE ) );
+  UINT64 start = offset - (offset % pageSize);
+  length += offset - start;
+
+  int flag = MADV_NORMAL;
+
+  switch( advice ) {
+    case SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+    case RANDOM:     flag = MADV_RANDOM; break;
+    case WILLNEED:   flag = MADV_WILLNEED; break;
+    default:         break;
+  }
+
+  ::madvise( (void*) (_data + start), size_t(length), flag );
+#endif
+}
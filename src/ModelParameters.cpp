@@ -0,0 +1,72 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// ModelParameters
+//
+
+#include "indri/ModelParameters.hpp"
+#include "lemur/Exception.hpp"
+
+indri::query::ModelParameters::ModelParameters() :
+  pertubeType(0),
+  pertubeK(0),
+  pertubeB(0),
+  model(0),
+  mu(2500),
+  lambda(0.4),
+  k1(1.2),
+  b(0.75),
+  k3(7),
+  c(7),
+  s(0.5),
+  k(0.35),
+  evaluation(DOCUMENT_AT_A_TIME),
+  postingBudget(0)
+{
+}
+
+indri::query::ModelParameters::ModelParameters( const std::map<std::string, double>& paras ) {
+  pertubeType = int( get( paras, "__PERTUBE_TYPE__", 0 ) );
+  pertubeK = get( paras, "__PERTUBE_k__", 0 );
+  pertubeB = get( paras, "__PERTUBE_b__", 0 );
+
+  model = int( get( paras, "__MODEL__", 0 ) );
+  mu = get( paras, "mu", 2500 );
+  lambda = get( paras, "lambda", 0.4 );
+  k1 = get( paras, "k1", 1.2 );
+  b = get( paras, "b", 0.75 );
+  k3 = get( paras, "k3", 7 );
+  c = get( paras, "c", 7 );
+  s = get( paras, "s", 0.5 );
+  k = get( paras, "k", 0.35 );
+
+  evaluation = int( get( paras, "__EVALUATION__", DOCUMENT_AT_A_TIME ) );
+  postingBudget = UINT64( get( paras, "postings", 0 ) );
+}
+
+double indri::query::ModelParameters::get( const std::map<std::string, double>& paras, const std::string& name, double defaultValue ) {
+  std::map<std::string, double>::const_iterator iter = paras.find( name );
+
+  if( iter == paras.end() )
+    return defaultValue;
+
+  return iter->second;
+}
+
+int indri::query::ModelParameters::evaluationType( const std::string& name ) {
+  if( name == "daat" )
+    return DOCUMENT_AT_A_TIME;
+  if( name == "taat" )
+    return TERM_AT_A_TIME;
+
+  LEMUR_THROW( LEMUR_BAD_PARAMETER_ERROR, "Unknown evaluation strategy: " + name );
+}
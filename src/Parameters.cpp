@@ -19,6 +19,7 @@
 #include "indri/Parameters.hpp"
 #include "indri/XMLReader.hpp"
 #include "indri/XMLNode.hpp"
+#include "indri/XMLWriter.hpp"
 #include <set>
 #include <iostream>
 #include <fstream>
@@ -487,6 +488,26 @@ void indri::api::Parameters::loadFile( const std::string& filename ) {
   input.close();
 }
 
+void indri::api::Parameters::write( std::string& text ) {
+  std::auto_ptr<indri::xml::XMLNode> node( toXML() );
+  indri::xml::XMLWriter writer( node.get() );
+  writer.write( text );
+}
+
+void indri::api::Parameters::writeFile( const std::string& filename ) {
+  std::string text;
+  write( text );
+
+  std::ofstream output;
+  output.open( filename.c_str(), std::ofstream::out | std::ofstream::trunc );
+
+  if( output.rdstate() & std::ios::failbit )
+    LEMUR_THROW( LEMUR_IO_ERROR, "Couldn't open parameter file '" + filename + "' for writing." );
+
+  output << text;
+  output.close();
+}
+
 void indri::api::Parameters::loadCommandLine( int argc, char** argv ) {
   Parameters current = *this;
 
@@ -0,0 +1,443 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// PostingCodec
+//
+
+#include "indri/PostingCodec.hpp"
+#include "indri/RVLBlockDecoder.hpp"
+#include "lemur/RVLCompress.hpp"
+#include "lemur/lemur-compat.hpp"
+#include "lemur/Exception.hpp"
+#include <string.h>
+#include <sstream>
+
+//
+// reserve
+//
+
+void indri::index::PostingBlock::reserve( size_t entries, size_t positionCount ) {
+  if( documents.size() < entries ) {
+    documents.resize( entries );
+    counts.resize( entries );
+    #ifdef DOC_UNIQUE_TERM_COUNTS
+    uniqueTermCounts.resize( entries );
+    #endif
+    positionStarts.resize( entries );
+  }
+
+  if( positions.size() < positionCount )
+    positions.resize( positionCount );
+}
+
+//
+// _writeInt
+//
+
+static inline void _writeInt( indri::utility::Buffer& output, int value ) {
+  char* spot = output.write( 5 );
+  char* end = lemur::utility::RVLCompress::compress_int( spot, value );
+  output.unwrite( 5 - (end - spot) );
+}
+
+namespace indri
+{
+  namespace index
+  {
+    //
+    // RVLPostingCodec
+    //
+
+    class RVLPostingCodec : public PostingCodec {
+    public:
+      const char* name() const { return "rvl"; }
+      int version() const { return 1; }
+      void decode( const char* list, const char* listEnd, bool countsOnly, PostingBlock& block ) const;
+      void encode( const PostingBlock& block, indri::utility::Buffer& output ) const;
+    };
+
+    //
+    // FORPostingCodec
+    //
+
+    class FORPostingCodec : public PostingCodec {
+    public:
+      enum { FRAME_SIZE = 128 };
+
+      const char* name() const { return "for"; }
+      int version() const { return 1; }
+      void decode( const char* list, const char* listEnd, bool countsOnly, PostingBlock& block ) const;
+      void encode( const PostingBlock& block, indri::utility::Buffer& output ) const;
+    };
+  }
+}
+
+//
+// _terminatorBytes
+//
+// Counts the bytes that end a compressed integer in the first bytes of a
+// block; a block of mostly one-byte integers has little else.
+//
+
+static int _terminatorBytes( const char* list, const char* listEnd, int sample ) {
+  const char* end = list + sample < listEnd ? list + sample : listEnd;
+  int terminators = 0;
+
+  for( ; list < end; list++ )
+    terminators += ( *list & 0x80 ) ? 1 : 0;
+
+  return terminators;
+}
+
+//
+// RVLPostingCodec::decode
+//
+// When nearly every integer in the block is one byte long, RVLBlockDecoder
+// decodes them all at once and the positions are left in place among the
+// other integers.  Otherwise the entries are decoded one at a time, which
+// lets the position bytes be stepped over when positions aren't needed.
+//
+
+void indri::index::RVLPostingCodec::decode( const char* list, const char* listEnd, bool countsOnly, PostingBlock& block ) const {
+  // every integer takes at least a byte
+  size_t capacity = listEnd - list;
+  lemur::api::DOCID_T document = 0;
+  int size = 0;
+  const int sample = 64;
+  int sampled = int( lemur_compat::min<size_t>( capacity, sample ) );
+
+  bool dense = _terminatorBytes( list, listEnd, sample ) * 8 >= sampled * 7;
+  block.reserve( capacity, (dense || !countsOnly) ? capacity : 0 );
+
+  if( !dense ) {
+    int* positions = countsOnly ? 0 : &block.positions[0];
+
+    while( list < listEnd ) {
+      int deltaDocument;
+      list = lemur::utility::RVLCompress::decompress_int( list, deltaDocument );
+      document += deltaDocument;
+      block.documents[size] = document;
+
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      list = lemur::utility::RVLCompress::decompress_int( list, block.uniqueTermCounts[size] );
+      #endif
+
+      int count;
+      list = lemur::utility::RVLCompress::decompress_int( list, count );
+      block.counts[size] = count;
+
+      if( positions ) {
+        block.positionStarts[size] = int( positions - &block.positions[0] );
+        for( int i=0; i<count; i++ )
+          list = lemur::utility::RVLCompress::decompress_int( list, *positions++ );
+      } else {
+        list = indri::utility::RVLBlockDecoder::skip( list, listEnd, count );
+      }
+
+      size++;
+    }
+
+    block.hasPositions = !countsOnly;
+  } else {
+    const int* decoded = &block.positions[0];
+    size_t decodedCount = indri::utility::RVLBlockDecoder::decode( list, listEnd, &block.positions[0] );
+
+    for( size_t i = 0; i < decodedCount; size++ ) {
+      document += decoded[i++];
+      block.documents[size] = document;
+
+      #ifdef DOC_UNIQUE_TERM_COUNTS
+      block.uniqueTermCounts[size] = decoded[i++];
+      #endif
+
+      block.counts[size] = decoded[i++];
+      block.positionStarts[size] = int(i);
+      i += block.counts[size];
+    }
+
+    block.hasPositions = true;
+  }
+
+  block.size = size;
+}
+
+//
+// RVLPostingCodec::encode
+//
+
+void indri::index::RVLPostingCodec::encode( const PostingBlock& block, indri::utility::Buffer& output ) const {
+  lemur::api::DOCID_T last = 0;
+
+  for( int i=0; i<block.size; i++ ) {
+    _writeInt( output, block.documents[i] - last );
+    last = block.documents[i];
+
+    #ifdef DOC_UNIQUE_TERM_COUNTS
+    _writeInt( output, block.uniqueTermCounts[i] );
+    #endif
+
+    _writeInt( output, block.counts[i] );
+
+    const int* positions = &block.positions[0] + block.positionStarts[i];
+    for( int j=0; j<block.counts[i]; j++ )
+      _writeInt( output, positions[j] );
+  }
+}
+
+//
+// ---------------------
+// FOR block format:
+// ---------------------
+//    RVLCompressed  entry count
+//    RVLCompressed  position count
+//    RVLCompressed  first document
+//    packed         the other entries' document gaps
+//    packed         unique term counts (with DOC_UNIQUE_TERM_COUNTS)
+//    packed         counts
+//    RVLCompressed  length in bytes of the position frames
+//    for each frame of up to FRAME_SIZE position deltas:
+//      packed       position deltas
+//
+// A packed run of n integers is stored as:
+//    RVLCompressed  minimum
+//    byte           bits
+//    (n*bits+31)/32 little-endian 32-bit words holding value - minimum
+//                   in bits bits each, low bits first
+// and takes no space at all when n is zero.
+//
+
+//
+// _pack
+//
+
+static void _pack( const int* values, int count, indri::utility::Buffer& output ) {
+  if( count == 0 )
+    return;
+
+  int minimum = values[0];
+  for( int i=1; i<count; i++ )
+    minimum = lemur_compat::min( minimum, values[i] );
+
+  UINT32 range = 0;
+  for( int i=0; i<count; i++ )
+    range |= UINT32( values[i] - minimum );
+
+  int bits = 0;
+  while( bits < 32 && (range >> bits) )
+    bits++;
+
+  _writeInt( output, minimum );
+  *output.write( 1 ) = (char) bits;
+
+  size_t words = ( size_t(count) * bits + 31 ) / 32;
+  char* spot = output.write( words * sizeof(UINT32) );
+  UINT64 pending = 0;
+  int available = 0;
+
+  for( int i=0; i<count; i++ ) {
+    pending |= UINT64( UINT32( values[i] - minimum ) ) << available;
+    available += bits;
+
+    if( available >= 32 ) {
+      UINT32 word = UINT32( pending );
+      memcpy( spot, &word, sizeof(UINT32) );
+      spot += sizeof(UINT32);
+      pending >>= 32;
+      available -= 32;
+    }
+  }
+
+  if( available ) {
+    UINT32 word = UINT32( pending );
+    memcpy( spot, &word, sizeof(UINT32) );
+  }
+}
+
+//
+// _readInt
+//
+// Reads a compressed integer, throwing if it does not end before listEnd.
+//
+
+static const char* _readInt( const char* list, const char* listEnd, int& value ) {
+  const char* end = listEnd - list > 5 ? list + 5 : listEnd;
+  const char* last = list;
+
+  while( last < end && !( *last & 0x80 ) )
+    last++;
+
+  if( last == end )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Corrupt block in a for coded inverted list." );
+
+  return lemur::utility::RVLCompress::decompress_int( list, value );
+}
+
+//
+// _unpack
+//
+// Words are read one at a time into a 64-bit window, so every value is a
+// shift and a mask of the window.  The frame header and the packed words
+// are checked against listEnd before any of them are read.
+//
+
+static const char* _unpack( const char* list, const char* listEnd, int* values, int count ) {
+  if( count == 0 )
+    return list;
+
+  int minimum;
+  list = _readInt( list, listEnd, minimum );
+
+  if( list >= listEnd )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Corrupt block in a for coded inverted list." );
+
+  int bits = (UINT8) *list++;
+  size_t words = ( size_t(count) * bits + 31 ) / 32;
+
+  if( bits > 32 || size_t(listEnd - list) < words * sizeof(UINT32) )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Corrupt block in a for coded inverted list." );
+
+  if( bits == 0 ) {
+    for( int i=0; i<count; i++ )
+      values[i] = minimum;
+    return list;
+  }
+
+  const UINT64 mask = ( UINT64(1) << bits ) - 1;
+  UINT64 window = 0;
+  int available = 0;
+
+  for( int i=0; i<count; i++ ) {
+    if( available < bits ) {
+      UINT32 word;
+      memcpy( &word, list, sizeof(UINT32) );
+      list += sizeof(UINT32);
+      window |= UINT64( word ) << available;
+      available += 32;
+    }
+
+    values[i] = int( window & mask ) + minimum;
+    window >>= bits;
+    available -= bits;
+  }
+
+  return list;
+}
+
+//
+// FORPostingCodec::decode
+//
+
+void indri::index::FORPostingCodec::decode( const char* list, const char* listEnd, bool countsOnly, PostingBlock& block ) const {
+  int size, positionCount, positionBytes;
+
+  list = _readInt( list, listEnd, size );
+  list = _readInt( list, listEnd, positionCount );
+
+  if( size <= 0 || positionCount < 0 )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Corrupt block in a for coded inverted list." );
+
+  block.reserve( size, countsOnly ? 0 : positionCount );
+
+  lemur::api::DOCID_T* documents = &block.documents[0];
+  list = _readInt( list, listEnd, documents[0] );
+  list = _unpack( list, listEnd, documents + 1, size - 1 );
+
+  for( int i=1; i<size; i++ )
+    documents[i] += documents[i-1];
+
+  #ifdef DOC_UNIQUE_TERM_COUNTS
+  list = _unpack( list, listEnd, &block.uniqueTermCounts[0], size );
+  #endif
+  list = _unpack( list, listEnd, &block.counts[0], size );
+  list = _readInt( list, listEnd, positionBytes );
+
+  block.size = size;
+  block.hasPositions = !countsOnly;
+
+  if( countsOnly )
+    return;
+
+  int* positions = positionCount ? &block.positions[0] : 0;
+  for( int start = 0; start < positionCount; start += FRAME_SIZE )
+    list = _unpack( list, listEnd, positions + start, lemur_compat::min<int>( FRAME_SIZE, positionCount - start ) );
+
+  int start = 0;
+  for( int i=0; i<size; i++ ) {
+    block.positionStarts[i] = start;
+    start += block.counts[i];
+  }
+
+  if( start != positionCount )
+    LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Corrupt block in a for coded inverted list." );
+}
+
+//
+// FORPostingCodec::encode
+//
+
+void indri::index::FORPostingCodec::encode( const PostingBlock& block, indri::utility::Buffer& output ) const {
+  int size = block.size;
+  std::vector<int> values( size );
+  std::vector<int> positions;
+
+  for( int i=0; i<size; i++ ) {
+    const int* entryPositions = &block.positions[0] + block.positionStarts[i];
+    positions.insert( positions.end(), entryPositions, entryPositions + block.counts[i] );
+  }
+
+  _writeInt( output, size );
+  _writeInt( output, (int) positions.size() );
+
+  if( size == 0 )
+    return;
+
+  _writeInt( output, block.documents[0] );
+  for( int i=1; i<size; i++ )
+    values[i-1] = block.documents[i] - block.documents[i-1];
+  _pack( &values[0], size - 1, output );
+
+  #ifdef DOC_UNIQUE_TERM_COUNTS
+  _pack( &block.uniqueTermCounts[0], size, output );
+  #endif
+  _pack( &block.counts[0], size, output );
+
+  indri::utility::Buffer frames;
+  int positionCount = (int) positions.size();
+
+  for( int start = 0; start < positionCount; start += FRAME_SIZE )
+    _pack( &positions[start], lemur_compat::min<int>( FRAME_SIZE, positionCount - start ), frames );
+
+  _writeInt( output, (int) frames.position() );
+  if( frames.position() )
+    memcpy( output.write( frames.position() ), frames.front(), frames.position() );
+}
+
+//
+// get
+//
+
+const indri::index::PostingCodec* indri::index::PostingCodec::get( const std::string& name, int version ) {
+  static RVLPostingCodec rvl;
+  static FORPostingCodec frameOfReference;
+
+  const PostingCodec* codecs[] = { &rvl, &frameOfReference };
+
+  for( size_t i=0; i<sizeof(codecs)/sizeof(codecs[0]); i++ ) {
+    if( name == codecs[i]->name() && version == codecs[i]->version() )
+      return codecs[i];
+  }
+
+  std::stringstream message;
+  message << "No posting codec named '" << name << "' with version " << version << ".";
+  LEMUR_THROW( LEMUR_RUNTIME_ERROR, message.str() );
+  return 0;
+}
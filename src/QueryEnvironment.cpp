@@ -26,22 +26,13 @@
 #include "indri/IndriTimer.hpp"
 #include "indri/Index.hpp"
 #include "indri/SimpleQueryParser.hpp"
+#include "indri/merge_scored_results.hpp"
 #include <vector>
 #include <map>
 #include <algorithm>
 
 using namespace lemur::api;
 
-// #define TIME_QUERIES
-// debug code: should be gone soon
-#ifdef TIME_QUERIES
-#define INIT_TIMER      indri::utility::IndriTimer t; t.start();
-#define PRINT_TIMER(s)  { t.printElapsedMicroseconds( std::cout ); std::cout << ": " << s << std::endl; }
-#else
-#define INIT_TIMER
-#define PRINT_TIMER(s)
-#endif
-
 //
 // Helper document methods
 //
@@ -80,11 +71,92 @@ void qenv_gather_document_results( const std::vector< std::vector<DOCID_T> >& do
   }
 }
 
+//
+// Server requests, run on the worker pool.  A task owns its response
+// until the caller takes it.
+//
+
+namespace indri
+{
+  namespace api
+  {
+    class ServerTermStatisticsTask : public indri::thread::WorkerPool::Task {
+    public:
+      indri::server::QueryServer* server;
+      // the terms the server's cache didn't have, and where they are
+      // in the query's term list
+      std::vector<std::string> terms;
+      std::vector<size_t> positions;
+      std::vector<indri::collection::TermStatisticsCache::statistics> counts;
+
+      ServerTermStatisticsTask( indri::server::QueryServer* s ) :
+        server(s) {}
+
+      void run() {
+        counts.resize( terms.size() );
+
+        for( size_t i=0; i<terms.size(); i++ ) {
+          counts[i].termCount = server->termCount( terms[i] );
+          counts[i].documentCount = server->documentCount( terms[i] );
+        }
+      }
+    };
+
+    class ServerQueryTask : public indri::thread::WorkerPool::Task {
+    public:
+      indri::server::QueryServer* server;
+      std::map<std::string, std::map<std::string, double> >& queryTerms;
+      std::map<std::string, double>& modelParas;
+      int resultsRequested;
+      indri::server::QueryServerResponse* response;
+
+      ServerQueryTask( indri::server::QueryServer* s, std::map<std::string, std::map<std::string, double> >& terms,
+                       std::map<std::string, double>& paras, int requested ) :
+        server(s), queryTerms(terms), modelParas(paras), resultsRequested(requested), response(0) {}
+
+      ~ServerQueryTask() {
+        delete response;
+      }
+
+      void run() {
+        // don't optimize these queries, otherwise we won't be able to distinguish some annotations from others
+        response = server->runQuery( queryTerms, modelParas, resultsRequested, true );
+      }
+    };
+
+    class ServerQueryBatchTask : public indri::thread::WorkerPool::Task {
+    public:
+      indri::server::QueryServer* server;
+      std::vector< std::map<std::string, std::map<std::string, double> > >& queryTerms;
+      std::vector< std::map<std::string, double> >& modelParas;
+      int resultsRequested;
+      indri::server::QueryServerResponse* response;
+
+      ServerQueryBatchTask( indri::server::QueryServer* s, std::vector< std::map<std::string, std::map<std::string, double> > >& terms,
+                            std::vector< std::map<std::string, double> >& paras, int requested ) :
+        server(s), queryTerms(terms), modelParas(paras), resultsRequested(requested), response(0) {}
+
+      ~ServerQueryBatchTask() {
+        delete response;
+      }
+
+      void run() {
+        response = server->runQueryBatch( queryTerms, modelParas, resultsRequested );
+      }
+    };
+  }
+}
+
 //
 // QueryEnvironment definition
 //
 
-indri::api::QueryEnvironment::QueryEnvironment(){}
+indri::api::QueryEnvironment::QueryEnvironment() :
+  _pool(0),
+  _collectionTermCount(0),
+  _collectionDocumentCount(0)
+{
+}
 
 indri::api::QueryEnvironment::~QueryEnvironment() {
   close();
@@ -123,6 +195,7 @@ void indri::api::QueryEnvironment::_setQTF(std::map<std::string, double>& parsed
 }
 
 void indri::api::QueryEnvironment::_transformQuery() {
+  _reverseMapping.clear();
   for (std::map<std::string, QueryDict>::iterator it = _queryDict.begin(); it != _queryDict.end(); it++) {
     std::string processed = _servers[0]->processTerm(it->first);
     it->second.processed = processed;
@@ -132,14 +205,6 @@ void indri::api::QueryEnvironment::_transformQuery() {
   }
 }
 
-std::vector<std::string> indri::api::QueryEnvironment::_getProcessedQTerms() {
-  vector<std::string> res;
-  for(std::map<std::string, std::string>::iterator it = _reverseMapping.begin(); it != _reverseMapping.end(); ++it) {
-    res.push_back(it->first);
-  }
-  return res;
-} 
-
 std::map<std::string, std::map<std::string, double> > indri::api::QueryEnvironment::_getProcessedQTermswithStats() {
   std::map<std::string, std::map<std::string, double> > res;
   for(std::map<std::string, std::string>::iterator it = _reverseMapping.begin(); it != _reverseMapping.end(); ++it) {
@@ -154,137 +219,195 @@ std::map<std::string, std::map<std::string, double> > indri::api::QueryEnvironme
   return res;
 }
 
-void indri::api::QueryEnvironment::_setCollectionStatistics( indri::infnet::InferenceNetwork::MAllResults& statisticsResults ) {
-  for(std::map<std::string, std::string>::iterator it = _reverseMapping.begin(); it != _reverseMapping.end(); ++it) {
-    std::string processed = it->first;
-    std::string orig = it->second;
-    std::vector<ScoredExtentResult>& occurrencesList = statisticsResults[ processed ][ "collectionFrequency" ];
-    std::vector<ScoredExtentResult>& contextSizeList = statisticsResults[ processed ][ "collTermCnt" ];
-    std::vector<ScoredExtentResult>& documentOccurrencesList = statisticsResults[ processed ][ "docFrequency" ];
-    std::vector<ScoredExtentResult>& documentCountList = statisticsResults[ processed ][ "docCnt" ];
-
-    double collectionFrequency = occurrencesList[0].score;
-    double collTermCnt = contextSizeList[0].score;
-    int docFrequency = int(documentOccurrencesList[0].score);
-    int docCnt = int(documentCountList[0].score);
-
-    _queryDict[orig].collectionFrequency = collectionFrequency;
-    _queryDict[orig].collTermCnt = collTermCnt;
-    _queryDict[orig].docFrequency = docFrequency;
-    _queryDict[orig].docCnt = docCnt;
+//
+// _fetchTermStatistics
+//
+// Adds up the counts of terms over the servers.  Each server's counts
+// come from the term statistics cache of its repository when they can;
+// the rest are asked of the servers, all at once, and cached.
+//
+
+void indri::api::QueryEnvironment::_fetchTermStatistics( const std::vector<std::string>& terms, std::vector<indri::collection::TermStatisticsCache::statistics>& totals ) {
+  std::vector<indri::thread::WorkerPool::Task*> tasks;
+  std::vector<ServerTermStatisticsTask*> statisticsTasks;
+
+  for( size_t i=0; i<_servers.size(); i++ ) {
+    indri::collection::TermStatisticsCache* cache = _serverStatistics[i];
+    ServerTermStatisticsTask* task = new ServerTermStatisticsTask( _servers[i] );
+    statisticsTasks.push_back( task );
+
+    for( size_t j=0; j<terms.size(); j++ ) {
+      indri::collection::TermStatisticsCache::statistics counts;
+
+      if( cache && cache->find( terms[j], counts ) ) {
+        totals[j].termCount += counts.termCount;
+        totals[j].documentCount += counts.documentCount;
+        _profile.counters.cacheHits++;
+      } else {
+        task->terms.push_back( terms[j] );
+        task->positions.push_back( j );
+      }
+    }
+
+    if( task->terms.size() )
+      tasks.push_back( task );
   }
+
+  try {
+    _runServerTasks( tasks );
+  } catch( lemur::api::Exception& e ) {
+    indri::utility::delete_vector_contents<ServerTermStatisticsTask*>( statisticsTasks );
+    LEMUR_RETHROW( e, "Couldn't fetch term statistics from a server." );
+  }
+
+  for( size_t i=0; i<statisticsTasks.size(); i++ ) {
+    ServerTermStatisticsTask* task = statisticsTasks[i];
+    indri::collection::TermStatisticsCache* cache = _serverStatistics[i];
+
+    for( size_t j=0; j<task->terms.size(); j++ ) {
+      totals[task->positions[j]].termCount += task->counts[j].termCount;
+      totals[task->positions[j]].documentCount += task->counts[j].documentCount;
+
+      if( cache )
+        cache->insert( task->terms[j], task->counts[j] );
+    }
+  }
+
+  indri::utility::delete_vector_contents<ServerTermStatisticsTask*>( statisticsTasks );
 }
 
-// run a query (Indri query language)
-std::vector<indri::api::ScoredExtentResult> indri::api::QueryEnvironment::_runQuery( 
-  indri::infnet::InferenceNetwork::MAllResults& results,
-  const std::string& q,
-  int resultsRequested,
-  const int pertube_type,
-  const std::map<std::string, double>& pertube_paras ) {
+//
+// _setCollectionStatistics
+//
+// Fills in the collection statistics of the query terms.  The totals
+// were summed when the servers were added, and the term counts are
+// mostly cached, so only terms that no earlier query of any environment
+// on the same repositories used go to the servers.
+//
+
+void indri::api::QueryEnvironment::_setCollectionStatistics() {
+  std::vector<std::string> terms;
+
+  for(std::map<std::string, std::string>::iterator it = _reverseMapping.begin(); it != _reverseMapping.end(); ++it)
+    terms.push_back( it->first );
 
-  INIT_TIMER
-  PRINT_TIMER( "Initialization complete" );
+  indri::collection::TermStatisticsCache::statistics zero = { 0, 0 };
+  std::vector<indri::collection::TermStatisticsCache::statistics> totals( terms.size(), zero );
+  _fetchTermStatistics( terms, totals );
+
+  size_t i = 0;
+  for(std::map<std::string, std::string>::iterator it = _reverseMapping.begin(); it != _reverseMapping.end(); ++it, ++i) {
+    std::string orig = it->second;
 
+    _queryDict[orig].collectionFrequency = double(totals[i].termCount);
+    _queryDict[orig].collTermCnt = double(_collectionTermCount);
+    _queryDict[orig].docFrequency = int(totals[i].documentCount);
+    _queryDict[orig].docCnt = int(_collectionDocumentCount);
+  }
+
+  _profile.lap( indri::utility::QueryProfile::STATISTICS );
+}
+
+//
+// _parseQuery
+//
+// Parses a query into the query dictionary and loads the model
+// parameters it runs with: those of rule, or the environment's scoring
+// rule if rule is empty.
+//
+
+void indri::api::QueryEnvironment::_parseQuery( const std::string& q, const std::string& rule, const int pertube_type, const std::map<std::string, double>& pertube_paras ) {
   indri::query::SimpleQueryParser* sqp = new indri::query::SimpleQueryParser();
   std::map<std::string, double> parsedQuery = sqp->parseQuery( q );
   _modelParas.clear();
-  sqp->loadModelParameters( _parameters, _modelParas );
+
+  if( rule.length() ) {
+    Parameters ruleParameters;
+    ruleParameters.set( "rule", rule );
+    sqp->loadModelParameters( ruleParameters, _modelParas );
+  } else {
+    sqp->loadModelParameters( _parameters, _modelParas );
+  }
+
   sqp->loadPertubeParameters( pertube_type, pertube_paras, _modelParas );
   delete(sqp);
   
   _setQTF(parsedQuery);
+  _profile.lap( indri::utility::QueryProfile::PARSE );
+
   _transformQuery();
+  _profile.lap( indri::utility::QueryProfile::TERMS );
+}
 
-  PRINT_TIMER( "Parsing complete" );
-  
-  indri::infnet::InferenceNetwork::MAllResults statisticsResults;
-  _sumServerQuery( statisticsResults, resultsRequested ); //1000
-  _setCollectionStatistics( statisticsResults );
+// run a query (Indri query language)
+std::vector<indri::api::ScoredExtentResult> indri::api::QueryEnvironment::_runQuery( 
+  indri::infnet::InferenceNetwork::MAllResults& results,
+  const std::string& q,
+  int resultsRequested,
+  const int pertube_type,
+  const std::map<std::string, double>& pertube_paras ) {
 
-  PRINT_TIMER( "Statistics complete" );
+  _profile.clear();
+  _profile.start();
+
+  _parseQuery( q, "", pertube_type, pertube_paras );
+  _setCollectionStatistics();
 
   // run a scored query
   _scoredQuery( results, resultsRequested );
+  // the merge leaves the results sorted and trimmed to resultsRequested
   std::vector<indri::api::ScoredExtentResult> queryResults = results["ranking"]["scores"];
-  std::stable_sort( queryResults.begin(), queryResults.end(), indri::api::ScoredExtentResult::score_greater() );
-  if( (int)queryResults.size() > resultsRequested )
-    queryResults.resize( resultsRequested );
-
-  PRINT_TIMER( "Query complete" );
 
   return queryResults;
 }
 
 //
-// Runs a query in parallel across all servers, and returns a vector of responses.
-// This method will block until all responses have been received.
+// _runServerTasks
+//
+// Runs one request per server.  With several servers the requests run
+// concurrently on the pool, which has serverThreads threads (by default
+// one per server beyond the first; the calling thread works too).
 //
 
-std::vector<indri::server::QueryServerResponse*> indri::api::QueryEnvironment::_runServerQuery( int resultsRequested ) {
-  std::vector<indri::server::QueryServerResponse*> responses;
-  
-  std::vector<std::string> processedQueryTerms = _getProcessedQTerms();
-  // this ships out the requests to each server (doesn't necessarily block until they're done)
-  for( size_t i=0; i<_servers.size(); i++ ) {
-    indri::server::QueryServerResponse* response = _servers[i]->getGlobalStatistics( processedQueryTerms );
-    responses.push_back( response );
+void indri::api::QueryEnvironment::_runServerTasks( const std::vector<indri::thread::WorkerPool::Task*>& tasks ) {
+  if( tasks.size() < 2 ) {
+    for( size_t i=0; i<tasks.size(); i++ )
+      tasks[i]->run();
+    return;
   }
 
-  // this just goes through all the results, blocking on each one,
-  // making sure they've all arrived
-  for( size_t i=0; i<_servers.size(); i++ ) {
-    responses[i]->getResults();
+  int threads = (int) Parameters::instance().get( "serverThreads", int(tasks.size()) - 1 );
+  threads = lemur_compat::max( 0, threads );
+
+  if( !_pool || _pool->threads() != threads ) {
+    delete _pool;
+    _pool = new indri::thread::WorkerPool( threads );
   }
 
-  return responses;
+  _pool->run( tasks );
 }
 
-// 
-// This method is used for combining raw scores from ContextCounterNodes.
 //
-
-void indri::api::QueryEnvironment::_sumServerQuery( indri::infnet::InferenceNetwork::MAllResults& results, int resultsRequested ) {
-  std::vector<indri::server::QueryServerResponse*> serverResults = _runServerQuery( resultsRequested );
-  results.clear();
-
-  indri::infnet::InferenceNetwork::MAllResults::iterator nodeIter;
-  indri::infnet::EvaluatorNode::MResults::iterator listIter;
-
-  for( size_t i=0; i<serverResults.size(); i++ ) {
-    indri::server::QueryServerResponse* response = serverResults[i];
-    indri::infnet::InferenceNetwork::MAllResults& machineResults = response->getResults();
-    indri::infnet::InferenceNetwork::MAllResults::iterator iter;
-
-    for( nodeIter = machineResults.begin(); nodeIter != machineResults.end(); nodeIter++ ) {
-      for( listIter = nodeIter->second.begin(); listIter != nodeIter->second.end(); listIter++ ) {
-        std::vector<indri::api::ScoredExtentResult>& currentResultList = results[ nodeIter->first ][ listIter->first ];
-        std::vector<indri::api::ScoredExtentResult>& machineResultList = listIter->second;
-
-        if( currentResultList.size() == 0 ) {
-          currentResultList.assign( machineResultList.begin(), machineResultList.end() );
-        } else {
-          assert( machineResultList.size() == currentResultList.size() );
-
-          for( size_t i=0; i<machineResultList.size(); i++ ) {
-            currentResultList[i].score += machineResultList[i].score;
-          }
-        }
-      }
-    }
-  }
-
-  indri::utility::delete_vector_contents<indri::server::QueryServerResponse*>( serverResults );
-}
+// This method is used to merge document results from multiple servers.  It does this
+// by reassigning document IDs with the following function:
+//      serverCount = _servers.size();
+//      cookedDocID = rawDocID * serverCount + docServer;
+// So, for document 6 from server 3 (out of 7 servers), the cooked docID would be:
+//      (6 * 7) + 3 = 45.
+// This function has the nice property that if there is only one server running,
+// cookedDocID == rawDocID.
+//
 
 void indri::api::QueryEnvironment::_mergeQueryResults( indri::infnet::InferenceNetwork::MAllResults& results, 
-	std::vector<indri::server::QueryServerResponse*>& responses ) {
+	std::vector<indri::server::QueryServerResponse*>& responses, int resultsRequested ) {
   results.clear();
 
+  std::map< std::string, std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > > > lists;
   indri::infnet::InferenceNetwork::MAllResults::iterator nodeIter;
   indri::infnet::EvaluatorNode::MResults::iterator listIter;
 
-  // merge all the results from these machines into one master list
+  // cook the document IDs of each machine's lists in place; the lists
+  // are merged from the responses, so they must outlive the merge
   for( size_t i=0; i<responses.size(); i++ ) {
     indri::server::QueryServerResponse* response = responses[i];
     indri::infnet::InferenceNetwork::MAllResults& machineResults = response->getResults();
@@ -293,54 +416,52 @@ void indri::api::QueryEnvironment::_mergeQueryResults( indri::infnet::InferenceN
       indri::infnet::EvaluatorNode::MResults& node = nodeIter->second;
 
       for( listIter = node.begin(); listIter != node.end(); listIter++ ) {
-        const std::vector<indri::api::ScoredExtentResult>& partialResultList = listIter->second;
-        std::vector<indri::api::ScoredExtentResult>& totalResultList = results[ nodeIter->first ][ listIter->first ];
+        std::vector<indri::api::ScoredExtentResult>& partialResultList = listIter->second;
 
-        for( size_t j=0; j<partialResultList.size(); j++ ) {
-          indri::api::ScoredExtentResult singleResult = partialResultList[j];
-          singleResult.document = (singleResult.document*int(_servers.size())) + int(i);
-          totalResultList.push_back( singleResult );
-        }
+        for( size_t j=0; j<partialResultList.size(); j++ )
+          partialResultList[j].document = (partialResultList[j].document*int(_servers.size())) + int(i);
+
+        lists[ nodeIter->first ][ listIter->first ].push_back( &partialResultList );
       }
     }
   }
+
+  // each machine's list is a top-k list, so the best resultsRequested
+  // of their union is a bounded merge of them
+  std::map< std::string, std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > > >::iterator nodeLists;
+  for( nodeLists = lists.begin(); nodeLists != lists.end(); nodeLists++ ) {
+    std::map< std::string, std::vector< std::vector<indri::api::ScoredExtentResult>* > >::iterator machineLists;
+
+    for( machineLists = nodeLists->second.begin(); machineLists != nodeLists->second.end(); machineLists++ ) {
+      indri::utility::merge_scored_results( machineLists->second, resultsRequested, results[ nodeLists->first ][ machineLists->first ] );
+    }
+  }
 }
 
 //
-// This method is used to merge document results from multiple servers.  It does this
-// by reassigning document IDs with the following function:
-//      serverCount = _servers.size();
-//      cookedDocID = rawDocID * serverCount + docServer;
-// So, for document 6 from server 3 (out of 7 servers), the cooked docID would be:
-//      (6 * 7) + 3 = 45.
-// This function has the nice property that if there is only one server running,
-// cookedDocID == rawDocID.
+// _addServerProfiles
+//
+// Called once the server responses are merged.  The servers run at the
+// same time, so the network build time is that of the slowest one; the
+// rest of the time since the last phase, merging included, is
+// evaluation.  The counters of all servers are added up.
 //
 
-void indri::api::QueryEnvironment::_mergeServerQuery( 
-	indri::infnet::InferenceNetwork::MAllResults& results, 
-	int resultsRequested ) {
-  std::vector<indri::server::QueryServerResponse*> serverResults = _runServerQuery( resultsRequested );
-  results.clear();
-
-  indri::infnet::InferenceNetwork::MAllResults::iterator nodeIter;
-  indri::infnet::EvaluatorNode::MResults::iterator listIter;
-
-  _mergeQueryResults( results, serverResults );
-
-  // now, for each node, sort the result list, and trim off any results past the
-  // requested amount
-  for( nodeIter = results.begin(); nodeIter != results.end(); nodeIter++ ) {
-    for( listIter = nodeIter->second.begin(); listIter != nodeIter->second.end(); listIter++ ) {
-      std::vector<indri::api::ScoredExtentResult>& listResults = listIter->second;
-      std::stable_sort( listResults.begin(), listResults.end(), indri::api::ScoredExtentResult::score_greater() );
+void indri::api::QueryEnvironment::_addServerProfiles( std::vector<indri::server::QueryServerResponse*>& responses ) {
+  UINT64 build = 0;
 
-      if( int(listResults.size()) > resultsRequested )
-        listResults.resize( resultsRequested );
-    }
+  for( size_t i=0; i<responses.size(); i++ ) {
+    const indri::utility::QueryProfile& profile = responses[i]->getProfile();
+    build = lemur_compat::max( build, profile.microseconds[indri::utility::QueryProfile::BUILD] );
+    _profile.counters += profile.counters;
   }
 
-  indri::utility::delete_vector_contents<indri::server::QueryServerResponse*>( serverResults );
+  _profile.lap( indri::utility::QueryProfile::EVALUATION );
+
+  UINT64& evaluation = _profile.microseconds[indri::utility::QueryProfile::EVALUATION];
+  build = lemur_compat::min( build, evaluation );
+  evaluation -= build;
+  _profile.microseconds[indri::utility::QueryProfile::BUILD] += build;
 }
 
 //
@@ -356,16 +477,45 @@ void indri::api::QueryEnvironment::addIndex( const std::string& pathname ) {
     _repositories.push_back( repository );
     
     indri::server::LocalQueryServer *server = new indri::server::LocalQueryServer( *repository ) ;
-    _servers.push_back( server );
+    _addServer( server, &repository->termStatistics() );
     _repositoryNameMap[pathname] = std::make_pair(server, repository);
   } // else, could throw an Exception, as it is a logical error.
 }
 
+//
+// addIndex
+//
+
+void indri::api::QueryEnvironment::addIndex( indri::collection::Repository& repository ) {
+  indri::server::LocalQueryServer *server = new indri::server::LocalQueryServer( repository );
+  _addServer( server, &repository.termStatistics() );
+}
+
+//
+// _addServer
+//
+// The collection totals only change when a server is added.  Term
+// counts are cached per server, in the server's repository, so they
+// stay good as other servers come and go.
+//
+
+void indri::api::QueryEnvironment::_addServer( indri::server::QueryServer* server, indri::collection::TermStatisticsCache* statistics ) {
+  _servers.push_back( server );
+  _serverStatistics.push_back( statistics );
+  _collectionTermCount += server->termCount();
+  _collectionDocumentCount += server->documentCount();
+}
+
 void indri::api::QueryEnvironment::close() {
+  delete _pool;
+  _pool = 0;
   indri::utility::delete_vector_contents<indri::server::QueryServer*>( _servers );
   _servers.clear();
   indri::utility::delete_vector_contents<indri::collection::Repository*>( _repositories );
   _repositories.clear();
+  _collectionTermCount = 0;
+  _collectionDocumentCount = 0;
+  _serverStatistics.clear();
 }
 
 std::vector<std::string> indri::api::QueryEnvironment::documentMetadata( 
@@ -417,16 +567,30 @@ std::vector<std::string> indri::api::QueryEnvironment::documentMetadata(
 
 void indri::api::QueryEnvironment::_scoredQuery( indri::infnet::InferenceNetwork::MAllResults& results, int resultsRequested ) {
   std::vector<indri::server::QueryServerResponse*> queryResponses;
+  std::vector<indri::thread::WorkerPool::Task*> tasks;
+  std::vector<ServerQueryTask*> queryTasks;
 
   std::map<std::string, std::map<std::string, double> > processedQueryTerms = _getProcessedQTermswithStats();
   for( size_t i=0; i<_servers.size(); i++ ) {
-    // don't optimize these queries, otherwise we won't be able to distinguish some annotations from others
-    indri::server::QueryServerResponse* response = _servers[i]->runQuery( processedQueryTerms, _modelParas, resultsRequested, true );
-    queryResponses.push_back(response);
+    ServerQueryTask* task = new ServerQueryTask( _servers[i], processedQueryTerms, _modelParas, resultsRequested );
+    queryTasks.push_back( task );
+    tasks.push_back( task );
+  }
+
+  try {
+    _runServerTasks( tasks );
+  } catch( lemur::api::Exception& e ) {
+    indri::utility::delete_vector_contents<ServerQueryTask*>( queryTasks );
+    LEMUR_RETHROW( e, "Couldn't run the query on a server." );
   }
 
+  for( size_t i=0; i<queryTasks.size(); i++ )
+    queryResponses.push_back( queryTasks[i]->response );
+
   // now, gather up all the responses, merge them into some kind of output structure, and return them
-  _mergeQueryResults( results, queryResponses );
+  _mergeQueryResults( results, queryResponses, resultsRequested );
+  _addServerProfiles( queryResponses );
+  indri::utility::delete_vector_contents<ServerQueryTask*>( queryTasks );
 }
 
 std::vector<indri::api::ScoredExtentResult> indri::api::QueryEnvironment::runQuery( 
@@ -435,3 +599,62 @@ std::vector<indri::api::ScoredExtentResult> indri::api::QueryEnvironment::runQue
   std::vector<indri::api::ScoredExtentResult> queryResult = _runQuery( results, query, resultsRequested, pertube_type, pertube_paras );
   return queryResult;
 }
+
+//
+// runQueryBatch
+//
+// The queries are parsed and get their statistics one at a time, then
+// each server evaluates all of them in a single pass over their lists.
+//
+
+std::vector< std::vector<indri::api::ScoredExtentResult> > indri::api::QueryEnvironment::runQueryBatch(
+	const std::vector<std::string>& queries, int resultsRequested, const std::vector<std::string>& rules,
+	const std::vector<int>& pertube_types, const std::vector< std::map<std::string, double> >& pertube_paras ) {
+  if( queries.size() != rules.size() || queries.size() != pertube_types.size() || queries.size() != pertube_paras.size() )
+    LEMUR_THROW( LEMUR_BAD_PARAMETER_ERROR, "Every query of a batch needs its scoring rule and perturbation settings." );
+
+  std::vector< std::map<std::string, std::map<std::string, double> > > batchTerms;
+  std::vector< std::map<std::string, double> > batchParas;
+
+  _profile.clear();
+  _profile.start();
+
+  for( size_t i=0; i<queries.size(); i++ ) {
+    _parseQuery( queries[i], rules[i], pertube_types[i], pertube_paras[i] );
+    _setCollectionStatistics();
+
+    batchTerms.push_back( _getProcessedQTermswithStats() );
+    batchParas.push_back( _modelParas );
+  }
+
+  std::vector<indri::server::QueryServerResponse*> queryResponses;
+  std::vector<indri::thread::WorkerPool::Task*> tasks;
+  std::vector<ServerQueryBatchTask*> batchTasks;
+
+  for( size_t i=0; i<_servers.size(); i++ ) {
+    ServerQueryBatchTask* task = new ServerQueryBatchTask( _servers[i], batchTerms, batchParas, resultsRequested );
+    batchTasks.push_back( task );
+    tasks.push_back( task );
+  }
+
+  try {
+    _runServerTasks( tasks );
+  } catch( lemur::api::Exception& e ) {
+    indri::utility::delete_vector_contents<ServerQueryBatchTask*>( batchTasks );
+    LEMUR_RETHROW( e, "Couldn't run the query batch on a server." );
+  }
+
+  for( size_t i=0; i<batchTasks.size(); i++ )
+    queryResponses.push_back( batchTasks[i]->response );
+
+  indri::infnet::InferenceNetwork::MAllResults results;
+  _mergeQueryResults( results, queryResponses, resultsRequested );
+  _addServerProfiles( queryResponses );
+  indri::utility::delete_vector_contents<ServerQueryBatchTask*>( batchTasks );
+
+  std::vector< std::vector<indri::api::ScoredExtentResult> > batchResults( queries.size() );
+  for( size_t i=0; i<queries.size(); i++ )
+    batchResults[i] = results[ indri::server::QueryServer::batchResultName(i) ]["scores"];
+
+  return batchResults;
+}
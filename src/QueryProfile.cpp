@@ -0,0 +1,91 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// QueryProfile
+//
+
+#include "indri/QueryProfile.hpp"
+#include <stdio.h>
+
+static const char* phase_names[] = {
+  "parse",
+  "terms",
+  "statistics",
+  "build",
+  "evaluation",
+  "metadata",
+  "output"
+};
+
+static void write_json_string( std::ostream& out, const std::string& text ) {
+  out << '"';
+
+  for( size_t i=0; i<text.size(); i++ ) {
+    unsigned char c = text[i];
+
+    if( c == '"' || c == '\\' ) {
+      out << '\\' << c;
+    } else if( c < 0x20 ) {
+      char escaped[8];
+      sprintf( escaped, "\\u%04x", c );
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+
+  out << '"';
+}
+
+//
+// totalMicroseconds
+//
+
+UINT64 indri::utility::QueryProfile::totalMicroseconds() const {
+  UINT64 total = 0;
+
+  for( int i=0; i<PHASES; i++ )
+    total += microseconds[i];
+
+  return total;
+}
+
+//
+// phaseName
+//
+
+const char* indri::utility::QueryProfile::phaseName( int phase ) {
+  return phase_names[phase];
+}
+
+//
+// writeJSON
+//
+
+void indri::utility::QueryProfile::writeJSON( std::ostream& out, const std::string& query ) const {
+  out << "{\"query\":";
+  write_json_string( out, query );
+
+  out << ",\"microseconds\":{";
+  for( int i=0; i<PHASES; i++ )
+    out << "\"" << phaseName(i) << "\":" << microseconds[i] << ",";
+  out << "\"total\":" << totalMicroseconds() << "}";
+
+  out << ",\"counters\":{"
+      << "\"postingsDecoded\":" << counters.postingsDecoded
+      << ",\"blocksSkipped\":" << counters.blocksSkipped
+      << ",\"documentsScored\":" << counters.documentsScored
+      << ",\"bytesRead\":" << counters.bytesRead
+      << ",\"heapInsertions\":" << counters.heapInsertions
+      << ",\"cacheHits\":" << counters.cacheHits
+      << "}}" << std::endl;
+}
@@ -0,0 +1,389 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// RVLBlockDecoder
+//
+
+#include "indri/RVLBlockDecoder.hpp"
+#include "lemur/RVLCompress.hpp"
+#include "lemur/lemur-platform.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RVL_X86
+#define RVL_TARGET(t) __attribute__((target(t)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define RVL_X86
+#define RVL_TARGET(t)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+//
+// _decodeScalar
+//
+
+static size_t _decodeScalar( const char* source, const char* end, int* result ) {
+  int* out = result;
+
+  while( source < end )
+    source = lemur::utility::RVLCompress::decompress_int( source, *out++ );
+
+  return out - result;
+}
+
+#ifdef RVL_X86
+
+//
+// _highestBit
+//
+
+static inline int _highestBit( unsigned int mask ) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse( &index, mask );
+  return (int) index;
+#else
+  return 31 - __builtin_clz( mask );
+#endif
+}
+
+//
+// _lowestBit
+//
+
+static inline int _lowestBit( unsigned int mask ) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward( &index, mask );
+  return (int) index;
+#else
+  return __builtin_ctz( mask );
+#endif
+}
+
+//
+// _decodeMasked
+//
+// Decodes the integers that end inside a chunk, given the terminator mask
+// of the chunk.  Bytes after the last terminator start an integer that
+// continues past the chunk, so they're left for the next chunk.  Mixed
+// lengths decode fastest with the unrolled scalar decoder; the mask only
+// says where to stop.  A mask with no terminators at all is valid input:
+// after a run of one-byte integers is widened and shifted out, the rest
+// of the chunk can be the start of a single longer integer.
+//
+
+static inline const char* _decodeMasked( const char* source, unsigned int mask, int*& out ) {
+  const char* start = source;
+
+  if( mask ) {
+    const char* last = start + _highestBit( mask );
+
+    while( source <= last )
+      source = lemur::utility::RVLCompress::decompress_int( source, *out++ );
+  }
+
+  // no terminator in the chunk: the integer at source crosses the end of
+  // the chunk, so the scalar decoder finishes it to make progress
+  if( source == start )
+    source = lemur::utility::RVLCompress::decompress_int( source, *out++ );
+
+  return source;
+}
+
+//
+// _decodeSSE2
+//
+
+RVL_TARGET("sse2")
+static size_t _decodeSSE2( const char* source, const char* end, int* result ) {
+  int* out = result;
+  const __m128i low = _mm_set1_epi8( 0x7f );
+  const __m128i zero = _mm_setzero_si128();
+
+  while( end - source >= 16 ) {
+    __m128i bytes = _mm_loadu_si128( (const __m128i*) source );
+    unsigned int mask = (unsigned int) _mm_movemask_epi8( bytes );
+
+    if( mask == 0xffff ) {
+      // sixteen one-byte integers
+      bytes = _mm_and_si128( bytes, low );
+      __m128i lowHalf = _mm_unpacklo_epi8( bytes, zero );
+      __m128i highHalf = _mm_unpackhi_epi8( bytes, zero );
+
+      _mm_storeu_si128( (__m128i*) (out + 0), _mm_unpacklo_epi16( lowHalf, zero ) );
+      _mm_storeu_si128( (__m128i*) (out + 4), _mm_unpackhi_epi16( lowHalf, zero ) );
+      _mm_storeu_si128( (__m128i*) (out + 8), _mm_unpacklo_epi16( highHalf, zero ) );
+      _mm_storeu_si128( (__m128i*) (out + 12), _mm_unpackhi_epi16( highHalf, zero ) );
+
+      out += 16;
+      source += 16;
+    } else {
+      source = _decodeMasked( source, mask, out );
+    }
+  }
+
+  return (out - result) + _decodeScalar( source, end, out );
+}
+
+//
+// _widenSSE4
+//
+// Stores the sixteen bytes to out, one integer per byte.
+//
+
+RVL_TARGET("sse4.1")
+static inline void _widenSSE4( __m128i bytes, int* out ) {
+  _mm_storeu_si128( (__m128i*) (out + 0), _mm_cvtepu8_epi32( bytes ) );
+  _mm_storeu_si128( (__m128i*) (out + 4), _mm_cvtepu8_epi32( _mm_srli_si128( bytes, 4 ) ) );
+  _mm_storeu_si128( (__m128i*) (out + 8), _mm_cvtepu8_epi32( _mm_srli_si128( bytes, 8 ) ) );
+  _mm_storeu_si128( (__m128i*) (out + 12), _mm_cvtepu8_epi32( _mm_srli_si128( bytes, 12 ) ) );
+}
+
+//
+// _decodeSSE4
+//
+// Like _decodeSSE2, but a chunk that starts with a run of one-byte
+// integers and then has a longer one still widens the run: all sixteen
+// bytes are widened and stored, the output moves on by the length of
+// the run, and the scalar decoder finishes the chunk.  Every integer
+// takes at least a byte, so the stores stay inside the room decode()
+// asks for.
+//
+
+RVL_TARGET("sse4.1")
+static size_t _decodeSSE4( const char* source, const char* end, int* result ) {
+  int* out = result;
+  const __m128i low = _mm_set1_epi8( 0x7f );
+
+  while( end - source >= 16 ) {
+    __m128i bytes = _mm_loadu_si128( (const __m128i*) source );
+    unsigned int mask = (unsigned int) _mm_movemask_epi8( bytes );
+
+    if( mask == 0xffff ) {
+      _widenSSE4( _mm_and_si128( bytes, low ), out );
+      out += 16;
+      source += 16;
+      continue;
+    }
+
+    int run = _lowestBit( ~mask );
+
+    if( run >= 4 ) {
+      _widenSSE4( _mm_and_si128( bytes, low ), out );
+      out += run;
+      source += run;
+      mask >>= run;
+    }
+
+    source = _decodeMasked( source, mask, out );
+  }
+
+  return (out - result) + _decodeScalar( source, end, out );
+}
+
+//
+// _decodeAVX2
+//
+// The same as _decodeSSE4, over 32 byte chunks.
+//
+
+RVL_TARGET("avx2")
+static size_t _decodeAVX2( const char* source, const char* end, int* result ) {
+  int* out = result;
+  const __m256i low = _mm256_set1_epi32( 0x7f );
+
+  while( end - source >= 32 ) {
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8( _mm256_loadu_si256( (const __m256i*) source ) );
+    int run = 32;
+
+    if( mask != 0xffffffff )
+      run = _lowestBit( ~mask );
+
+    if( run >= 8 ) {
+      // widen the whole chunk from memory; the output only moves on by
+      // the run, so the next chunk starts with the integer that ended it
+      _mm256_storeu_si256( (__m256i*) (out + 0), _mm256_and_si256( low, _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*) (source + 0) ) ) ) );
+      _mm256_storeu_si256( (__m256i*) (out + 8), _mm256_and_si256( low, _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*) (source + 8) ) ) ) );
+      _mm256_storeu_si256( (__m256i*) (out + 16), _mm256_and_si256( low, _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*) (source + 16) ) ) ) );
+      _mm256_storeu_si256( (__m256i*) (out + 24), _mm256_and_si256( low, _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*) (source + 24) ) ) ) );
+
+      out += run;
+      source += run;
+      if( run == 32 )
+        continue;
+      mask >>= run;
+    }
+
+    // stop within the first half so a run of short integers right
+    // after a long one still takes the fast path
+    source = _decodeMasked( source, mask & 0xffff, out );
+  }
+
+  // the SSE4 kernel is not VEX encoded; clear the upper halves first
+  _mm256_zeroupper();
+  return (out - result) + _decodeSSE4( source, end, out );
+}
+
+//
+// _cpuSupports
+//
+
+static bool _cpuSupports( indri::utility::RVLBlockDecoder::kernel_type kernel ) {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid( info, 0 );
+  int maximum = info[0];
+
+  __cpuid( info, 1 );
+  bool sse2 = (info[3] & (1<<26)) != 0;
+  bool sse41 = (info[2] & (1<<19)) != 0;
+  bool osxsave = (info[2] & (1<<27)) != 0;
+  bool avx = (info[2] & (1<<28)) != 0;
+
+  if( kernel == indri::utility::RVLBlockDecoder::SSE2 )
+    return sse2;
+  if( kernel == indri::utility::RVLBlockDecoder::SSE4 )
+    return sse41;
+
+  // the OS has to save the ymm registers too
+  if( !osxsave || !avx || maximum < 7 || (_xgetbv(0) & 0x6) != 0x6 )
+    return false;
+
+  __cpuidex( info, 7, 0 );
+  return (info[1] & (1<<5)) != 0;
+#else
+  __builtin_cpu_init();
+
+  if( kernel == indri::utility::RVLBlockDecoder::SSE2 )
+    return __builtin_cpu_supports( "sse2" ) != 0;
+  if( kernel == indri::utility::RVLBlockDecoder::SSE4 )
+    return __builtin_cpu_supports( "sse4.1" ) != 0;
+
+  return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+}
+
+#endif // RVL_X86
+
+//
+// _selectKernel
+//
+// The widest kernel the CPU has is the fastest on dense lists.
+//
+
+static indri::utility::RVLBlockDecoder::kernel_type _selectKernel() {
+  const indri::utility::RVLBlockDecoder::kernel_type kernels[] = {
+    indri::utility::RVLBlockDecoder::AVX2,
+    indri::utility::RVLBlockDecoder::SSE4,
+    indri::utility::RVLBlockDecoder::SSE2
+  };
+
+  for( size_t i=0; i<sizeof(kernels)/sizeof(kernels[0]); i++ ) {
+    if( indri::utility::RVLBlockDecoder::supported( kernels[i] ) )
+      return kernels[i];
+  }
+
+  return indri::utility::RVLBlockDecoder::SCALAR;
+}
+
+static indri::utility::RVLBlockDecoder::kernel_type _kernel = _selectKernel();
+
+//
+// supported
+//
+
+bool indri::utility::RVLBlockDecoder::supported( kernel_type kernel ) {
+  if( kernel == SCALAR )
+    return true;
+
+#ifdef RVL_X86
+  return _cpuSupports( kernel );
+#else
+  return false;
+#endif
+}
+
+//
+// kernel
+//
+
+indri::utility::RVLBlockDecoder::kernel_type indri::utility::RVLBlockDecoder::kernel() {
+  return _kernel;
+}
+
+//
+// name
+//
+
+const char* indri::utility::RVLBlockDecoder::name( kernel_type kernel ) {
+  switch( kernel ) {
+    case SSE2: return "sse2";
+    case SSE4: return "sse4.1";
+    case AVX2: return "avx2";
+    default: return "scalar";
+  }
+}
+
+//
+// decode
+//
+
+size_t indri::utility::RVLBlockDecoder::decode( const char* source, const char* end, int* result ) {
+  return decode( source, end, result, _kernel );
+}
+
+//
+// decode
+//
+
+size_t indri::utility::RVLBlockDecoder::decode( const char* source, const char* end, int* result, kernel_type kernel ) {
+#ifdef RVL_X86
+  if( kernel == AVX2 )
+    return _decodeAVX2( source, end, result );
+  if( kernel == SSE4 )
+    return _decodeSSE4( source, end, result );
+  if( kernel == SSE2 )
+    return _decodeSSE2( source, end, result );
+#endif
+
+  return _decodeScalar( source, end, result );
+}
+
+//
+// skip
+//
+// Every compressed integer ends with the one byte that has its high bit
+// set, so skipping count integers means finding count such bytes.  Whole
+// words are skipped while they hold no more terminators than remain.
+//
+
+const char* indri::utility::RVLBlockDecoder::skip( const char* source, const char* end, int count ) {
+  const UINT64 highBits = 0x8080808080808080ULL;
+  const UINT64 ones = 0x0101010101010101ULL;
+
+  while( count >= 8 && source + sizeof(UINT64) <= end ) {
+    UINT64 word;
+    memcpy( &word, source, sizeof(UINT64) );
+    int terminators = int( (((word & highBits) >> 7) * ones) >> 56 );
+
+    if( terminators > count )
+      break;
+
+    source += sizeof(UINT64);
+    count -= terminators;
+  }
+
+  return lemur::utility::RVLCompress::skip_ints( source, count );
+}
@@ -0,0 +1,230 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// ReadBufferPool
+//
+
+#include "indri/ReadBufferPool.hpp"
+#include "indri/Mutex.hpp"
+#include "indri/ScopedLock.hpp"
+#include "lemur/Exception.hpp"
+#include <algorithm>
+#include <string.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+//
+// The pool of each thread is found through a thread-local slot.  The
+// pools are also listed here, so that their counts can be summed;
+// a pool is destroyed when its thread exits, and its counts are kept
+// in retired_counts.  (Windows has no exit callback for thread-local
+// slots, so there the pools of exited threads stay listed.)
+//
+
+namespace indri
+{
+  namespace file
+  {
+    struct read_buffer_pool_registry {
+#ifdef WIN32
+      DWORD key;
+#else
+      pthread_key_t key;
+#endif
+      indri::thread::Mutex lock;
+      std::vector<ReadBufferPool*> pools;
+      ReadBufferPool::statistics retired;
+
+      read_buffer_pool_registry() {
+#ifdef WIN32
+        key = ::TlsAlloc();
+#else
+        pthread_key_create( &key, ReadBufferPool::_destroy );
+#endif
+        memset( &retired, 0, sizeof retired );
+      }
+
+      void* get() {
+#ifdef WIN32
+        return ::TlsGetValue( key );
+#else
+        return pthread_getspecific( key );
+#endif
+      }
+
+      void set( void* pool ) {
+#ifdef WIN32
+        ::TlsSetValue( key, pool );
+#else
+        pthread_setspecific( key, pool );
+#endif
+      }
+    };
+
+    static void add_counts( ReadBufferPool::statistics& total, const ReadBufferPool::statistics& counts ) {
+      total.acquired += counts.acquired;
+      total.allocated += counts.allocated;
+      total.allocatedBytes += counts.allocatedBytes;
+      total.released += counts.released;
+      total.freed += counts.freed;
+    }
+
+    // the class of the smallest buffer that holds length bytes
+    static int size_class( size_t length ) {
+      int sizeClass = 0;
+      size_t size = ReadBufferPool::MINIMUM_CLASS_SIZE;
+
+      while( size < length && size < ReadBufferPool::MAXIMUM_CLASS_SIZE ) {
+        size *= 2;
+        sizeClass++;
+      }
+
+      return sizeClass;
+    }
+  }
+}
+
+static indri::file::read_buffer_pool_registry& registry() {
+  static indri::file::read_buffer_pool_registry r;
+  return r;
+}
+
+indri::file::ReadBufferPool::ReadBufferPool() :
+  _pooledBytes(0)
+{
+  memset( &_statistics, 0, sizeof _statistics );
+}
+
+indri::file::ReadBufferPool::~ReadBufferPool() {
+  for( int i=0; i<CLASSES; i++ ) {
+    for( size_t j=0; j<_free[i].size(); j++ )
+      free( _free[i][j] );
+  }
+}
+
+//
+// _local
+//
+
+indri::file::ReadBufferPool& indri::file::ReadBufferPool::_local() {
+  read_buffer_pool_registry& r = registry();
+  ReadBufferPool* pool = (ReadBufferPool*) r.get();
+
+  if( !pool ) {
+    pool = new ReadBufferPool;
+    r.set( pool );
+
+    indri::thread::ScopedLock lock( r.lock );
+    r.pools.push_back( pool );
+  }
+
+  return *pool;
+}
+
+//
+// _destroy
+//
+
+void indri::file::ReadBufferPool::_destroy( void* p ) {
+  ReadBufferPool* pool = (ReadBufferPool*) p;
+  read_buffer_pool_registry& r = registry();
+
+  {
+    indri::thread::ScopedLock lock( r.lock );
+    add_counts( r.retired, pool->_statistics );
+    r.pools.erase( std::find( r.pools.begin(), r.pools.end(), pool ) );
+  }
+
+  delete pool;
+}
+
+//
+// acquire
+//
+
+void indri::file::ReadBufferPool::acquire( indri::utility::Buffer& buffer, size_t length ) {
+  ReadBufferPool& pool = _local();
+  int sizeClass = size_class( length );
+  size_t size = size_t(MINIMUM_CLASS_SIZE) << sizeClass;
+  char* storage;
+
+  if( pool._free[sizeClass].size() ) {
+    storage = pool._free[sizeClass].back();
+    pool._free[sizeClass].pop_back();
+    pool._pooledBytes -= size;
+  } else {
+    storage = (char*) malloc( size );
+    if( !storage )
+      LEMUR_THROW( LEMUR_RUNTIME_ERROR, "Couldn't allocate a read buffer." );
+
+    indri::thread::ScopedLock lock( pool._statisticsLock );
+    pool._statistics.allocated++;
+    pool._statistics.allocatedBytes += size;
+  }
+
+  {
+    indri::thread::ScopedLock lock( pool._statisticsLock );
+    pool._statistics.acquired++;
+  }
+
+  buffer.attach( storage, size );
+}
+
+//
+// release
+//
+
+void indri::file::ReadBufferPool::release( indri::utility::Buffer& buffer ) {
+  ReadBufferPool& pool = _local();
+  size_t size = buffer.size();
+  char* storage = buffer.front();
+  buffer.detach();
+
+  if( !storage )
+    return;
+
+  // a buffer that grew past the largest class isn't kept
+  int sizeClass = size_class( size );
+  bool kept = (size_t(MINIMUM_CLASS_SIZE) << sizeClass) == size &&
+              pool._pooledBytes + size <= MAXIMUM_POOLED_BYTES;
+
+  if( kept ) {
+    pool._free[sizeClass].push_back( storage );
+    pool._pooledBytes += size;
+  } else {
+    free( storage );
+  }
+
+  indri::thread::ScopedLock lock( pool._statisticsLock );
+  pool._statistics.released++;
+  if( !kept )
+    pool._statistics.freed++;
+}
+
+//
+// counts
+//
+
+indri::file::ReadBufferPool::statistics indri::file::ReadBufferPool::counts() {
+  read_buffer_pool_registry& r = registry();
+  indri::thread::ScopedLock lock( r.lock );
+  statistics total = r.retired;
+
+  for( size_t i=0; i<r.pools.size(); i++ ) {
+    indri::thread::ScopedLock poolLock( r.pools[i]->_statisticsLock );
+    add_counts( total, r.pools[i]->_statistics );
+  }
+
+  return total;
+}
@@ -36,6 +36,9 @@
 #include <algorithm>
 
 const static int defaultMemory = 100*1024*1024;
+const static int defaultTermCacheSize = 64*1024;
+const static int defaultBlockCacheSize = 1024; // 8MB of dictionary blocks
+const static int defaultTermStatisticsCacheSize = 64*1024;
 
 //
 // _buildChain
@@ -115,7 +118,7 @@ void indri::collection::Repository::_openIndexes( indri::api::Parameters& params
         indri::index::DiskIndex* diskIndex = new indri::index::DiskIndex();
         std::string indexName = (std::string) indexSpec;
 
-        diskIndex->open( parentPath, indexName );
+        diskIndex->open( parentPath, indexName, _indexOptions );
         _active->push_back( diskIndex );
       }
     }
@@ -213,6 +216,27 @@ void indri::collection::Repository::openRead( const std::string& path, indri::ap
     if( options )
       _memory = options->get( "memory", _memory );
 
+    size_t blockCacheSize = defaultBlockCacheSize;
+    if( options )
+      blockCacheSize = (size_t) options->get( "blockCacheSize", (INT64) blockCacheSize );
+    _blockCache = new indri::file::BulkBlockCache( blockCacheSize );
+
+    size_t termStatisticsCacheSize = defaultTermStatisticsCacheSize;
+    if( options )
+      termStatisticsCacheSize = (size_t) options->get( "termStatisticsCacheSize", (INT64) termStatisticsCacheSize );
+    _termStatistics.open( termStatisticsCacheSize );
+
+    _indexOptions = indri::index::DiskIndex::options();
+    _indexOptions.termCacheSize = defaultTermCacheSize;
+    _indexOptions.blockCache = _blockCache;
+
+    if( options ) {
+      _indexOptions.mapped = options->get( "mmap", false );
+      _indexOptions.termCacheSize = (size_t) options->get( "termCacheSize", (INT64) _indexOptions.termCacheSize );
+      _indexOptions.memoryDictionary = options->get( "memoryDictionary", false );
+      _indexOptions.blockDecoding = options->get( "blockDecode", true );
+    }
+
     float queryProportion = 1;
     if( options )
       queryProportion = static_cast<float>(options->get( "queryProportion", queryProportion ));
@@ -412,6 +436,40 @@ indri::collection::CompressedCollection* indri::collection::Repository::collecti
   return _collection;
 }
 
+//
+// blockCache
+//
+
+indri::file::BulkBlockCache* indri::collection::Repository::blockCache() {
+  return _blockCache;
+}
+
+//
+// termStatistics
+//
+
+indri::collection::TermStatisticsCache& indri::collection::Repository::termStatistics() {
+  return _termStatistics;
+}
+
+//
+// warmTermCache
+//
+
+void indri::collection::Repository::warmTermCache( const std::vector<std::string>& terms ) {
+  index_state state = indexes();
+
+  for( size_t i=0; i<terms.size(); i++ ) {
+    std::string processed = processTerm( terms[i] );
+
+    if( processed.empty() )
+      continue;
+
+    for( size_t j=0; j<state->size(); j++ )
+      (*state)[j]->documentCount( processed );
+  }
+}
+
 //
 // deletedList
 //
@@ -437,6 +495,11 @@ void indri::collection::Repository::close() {
 
     _closeIndexes();
 
+    delete _blockCache;
+    _blockCache = 0;
+
+    _termStatistics.close();
+
     delete _collection;
     _collection = 0;
 
@@ -9,6 +9,7 @@
 #include <vector>
 #include <cstdlib>
 #include "indri/SimpleQueryParser.hpp"
+#include "indri/TermScoreFunctionFactory.hpp"
 
 void split(const std::string &s, char delim, std::vector<std::string> &elems) {
   std::stringstream ss(s);
@@ -57,13 +58,18 @@ void indri::query::SimpleQueryParser::loadModelParameters(
   std::vector<std::string> para_vectors = split(rules[x], ',');
   for (size_t i = 0; i < para_vectors.size(); i++) {
     std::string cur = para_vectors[i];
-    try {
-      std::vector<std::string> this_para = split(cur, ':');
-      res[this_para.at(0)] = atof(this_para.at(1).c_str());
-    }
-    catch (...) {
+    std::vector<std::string> this_para = split(cur, ':');
+    if (this_para.size() != 2) {
       LEMUR_THROW( EMPTY_QUERY, "Parse Model Parameters Error!" );
     }
+    if (this_para[0] == "method") {
+      // the model name is stored as its registry id, like the pertube type
+      res["__MODEL__"] = indri::query::TermScoreFunctionFactory::modelType(this_para[1]);
+    } else if (this_para[0] == "evaluation") {
+      res["__EVALUATION__"] = indri::query::ModelParameters::evaluationType(this_para[1]);
+    } else {
+      res[this_para[0]] = atof(this_para[1].c_str());
+    }
   }
 }
 
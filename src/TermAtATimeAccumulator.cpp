@@ -0,0 +1,418 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// TermAtATimeAccumulator
+//
+
+#include "indri/TermAtATimeAccumulator.hpp"
+#include "indri/InferenceNetwork.hpp"
+#include "indri/PertubePolicy.hpp"
+#include "indri/delete_range.hpp"
+#include "indri/ex_changes.hpp"
+#include "lemur/lemur-compat.hpp"
+#include <algorithm>
+
+namespace indri
+{
+  namespace infnet
+  {
+    //
+    // Scores a list with a fixed model kernel and perturbation policy,
+    // in the same way PertubedTermFrequencyBeliefNode does.
+    //
+
+    template<class _Model, class _Pertube>
+    class model_term_scorer : public TermAtATimeAccumulator::term_scorer {
+    private:
+      TermAtATimeAccumulator& _accumulator;
+      const _Model& _model;
+      const indri::query::TermScoreFunction& _function;
+      double _qtf;
+
+    public:
+      model_term_scorer( TermAtATimeAccumulator& accumulator, indri::query::ModelTermScoreFunction<_Model>& function, double qtf ) :
+        _accumulator(accumulator),
+        _model(function.model()),
+        _function(function),
+        _qtf(qtf)
+      {
+      }
+
+      void accumulate( indri::index::DocListIterator* list, indri::index::Index& index,
+                       lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+        double queryLength = _function.getQueryLength();
+        const indri::query::ModelParameters& parameters = _function.getModelParameters();
+
+        if( !list->finished() && list->currentEntry()->document < begin )
+          list->nextEntry( begin );
+
+        while( !list->finished() ) {
+          const indri::index::DocListIterator::DocumentBlock* block = list->currentBlock();
+
+          if( !block ) {
+            const indri::index::DocListIterator::DocumentData* entry = list->currentEntry();
+            if( entry->document >= end )
+              break;
+
+            int uniqueTerms = 0;
+            #ifdef DOC_UNIQUE_TERM_COUNTS
+            uniqueTerms = entry->uniqueTermCounts;
+            #endif
+
+            _score( entry->document, entry->count, uniqueTerms, index, queryLength, parameters );
+            list->nextEntry();
+            continue;
+          }
+
+          // score straight from the decoded arrays, up to the end of the
+          // range, then move past them
+          int size = int( std::lower_bound( block->documents, block->documents + block->size, end ) - block->documents );
+
+          for( int i=0; i<size; i++ ) {
+            int uniqueTerms = 0;
+            #ifdef DOC_UNIQUE_TERM_COUNTS
+            uniqueTerms = block->uniqueTermCounts[i];
+            #endif
+
+            _score( block->documents[i], block->counts[i], uniqueTerms, index, queryLength, parameters );
+          }
+
+          if( size < block->size )
+            break;
+
+          list->nextEntry( block->documents[size-1] + 1 );
+        }
+      }
+
+      void accumulate( const indri::index::ImpactListIterator::Segment& segment, indri::index::Index& index,
+                       lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+        double queryLength = _function.getQueryLength();
+        const indri::query::ModelParameters& parameters = _function.getModelParameters();
+
+        const lemur::api::DOCID_T* documents = segment.documents;
+        int first = int( std::lower_bound( documents, documents + segment.decoded, begin ) - documents );
+        int last = int( std::lower_bound( documents + first, documents + segment.decoded, end ) - documents );
+
+        for( int i=first; i<last; i++ ) {
+          int uniqueTerms = 0;
+          #ifdef DOC_UNIQUE_TERM_COUNTS
+          uniqueTerms = segment.uniqueTermCounts[i];
+          #endif
+
+          _score( documents[i], segment.counts[i], uniqueTerms, index, queryLength, parameters );
+        }
+      }
+
+      void _score( lemur::api::DOCID_T document, int count, int uniqueTerms, indri::index::Index& index,
+                   double queryLength, const indri::query::ModelParameters& parameters ) {
+        int documentLength = index.documentLength( document );
+        int length = documentLength;
+        _Pertube::document( count, length, queryLength, parameters );
+
+        _accumulator.add( document, _model.score( count, length, _qtf, uniqueTerms ) - background( documentLength ) );
+      }
+
+      double difference( int count, int documentLength ) {
+        int length = documentLength;
+        _Pertube::document( count, length, _function.getQueryLength(), _function.getModelParameters() );
+        return _model.score( count, length, _qtf, 0 ) - background( documentLength );
+      }
+
+      double background( int documentLength ) {
+        int count = 0;
+        _Pertube::document( count, documentLength, _function.getQueryLength(), _function.getModelParameters() );
+        return _model.score( count, documentLength, _qtf, 0 );
+      }
+    };
+
+    //
+    // A term without an inverted list only ever contributes its
+    // background score, as a NullScorerNode would.
+    //
+
+    class null_term_scorer : public TermAtATimeAccumulator::term_scorer {
+    private:
+      indri::query::TermScoreFunction& _function;
+      double _qtf;
+
+    public:
+      null_term_scorer( indri::query::TermScoreFunction& function, double qtf ) :
+        _function(function),
+        _qtf(qtf)
+      {
+      }
+
+      void accumulate( indri::index::DocListIterator* list, indri::index::Index& index,
+                       lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+      }
+
+      void accumulate( const indri::index::ImpactListIterator::Segment& segment, indri::index::Index& index,
+                       lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+      }
+
+      double difference( int count, int documentLength ) {
+        return 0;
+      }
+
+      double background( int documentLength ) {
+        return _function.scoreOccurrence( 0, documentLength, _qtf, 0 );
+      }
+    };
+
+    template<class _Model>
+    struct term_scorer_pertube_factory {
+      typedef TermAtATimeAccumulator::term_scorer* result_type;
+
+      TermAtATimeAccumulator& accumulator;
+      indri::query::ModelTermScoreFunction<_Model>& function;
+      double qtf;
+
+      term_scorer_pertube_factory( TermAtATimeAccumulator& a, indri::query::ModelTermScoreFunction<_Model>& f, double q ) :
+        accumulator(a), function(f), qtf(q) {}
+
+      template<class _Pertube>
+      TermAtATimeAccumulator::term_scorer* apply() {
+        return new model_term_scorer<_Model, _Pertube>( accumulator, function, qtf );
+      }
+    };
+
+    struct term_scorer_factory {
+      typedef TermAtATimeAccumulator::term_scorer* result_type;
+
+      TermAtATimeAccumulator& accumulator;
+      indri::query::TermScoreFunction& function;
+      double qtf;
+
+      term_scorer_factory( TermAtATimeAccumulator& a, indri::query::TermScoreFunction& f, double q ) :
+        accumulator(a), function(f), qtf(q) {}
+
+      // function was built by TermScoreFunctionFactory for this model type
+      template<class _Model>
+      TermAtATimeAccumulator::term_scorer* apply() {
+        indri::query::ModelTermScoreFunction<_Model>& modelFunction = static_cast<indri::query::ModelTermScoreFunction<_Model>&>( function );
+        term_scorer_pertube_factory<_Model> factory( accumulator, modelFunction, qtf );
+        return indri::query::pertube::dispatch( function.getModelParameters().pertubeType, factory );
+      }
+    };
+
+    //
+    // An impact list being read score-at-a-time, keyed by what the best
+    // posting of its next segment would add to a document's score.
+    //
+
+    struct impact_cursor {
+      size_t term;
+      indri::index::ImpactListIterator* list;
+      double estimate;
+
+      bool operator< ( const impact_cursor& other ) const {
+        return estimate < other.estimate;
+      }
+    };
+  }
+}
+
+indri::infnet::TermAtATimeAccumulator::TermAtATimeAccumulator( const std::string& name, indri::infnet::InferenceNetwork& network, int resultsRequested, UINT64 postingBudget ) :
+  _network(network),
+  _name(name),
+  _resultsRequested(resultsRequested),
+  _postingBudget(postingBudget),
+  _documentBase(0),
+  _top(resultsRequested),
+  _documentsScored(0)
+{
+}
+
+indri::infnet::TermAtATimeAccumulator::~TermAtATimeAccumulator() {
+  for( size_t i=0; i<_terms.size(); i++ )
+    delete _terms[i].scorer;
+}
+
+void indri::infnet::TermAtATimeAccumulator::addTerm( const std::string& termString, int listID, indri::query::TermScoreFunction& function, double qtf ) {
+  term_type term;
+
+  term.term = termString;
+  term.listID = listID;
+  term.function = &function;
+  term.qtf = qtf;
+
+  if( listID < 0 ) {
+    term.scorer = new null_term_scorer( function, qtf );
+  } else {
+    term_scorer_factory factory( *this, function, qtf );
+    term.scorer = indri::query::model::dispatch( function.getModelParameters().model, factory );
+  }
+
+  _terms.push_back( term );
+  std::stable_sort( _terms.begin(), _terms.end(), term_type::rarest_first() );
+}
+
+void indri::infnet::TermAtATimeAccumulator::evaluateIndex( indri::index::Index& index, indri::index::DeletedDocumentList::read_transaction* deleted,
+                                                           lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  // the documents of the index in range
+  lemur::api::DOCID_T first = lemur_compat::max( begin, index.documentBase() );
+  lemur::api::DOCID_T last = lemur_compat::min( end - 1, index.documentMaximum() );
+
+  _touched.clear();
+
+  if( last < first )
+    return;
+
+  _documentBase = first;
+  size_t documentCount = last - first + 1;
+
+  _scores.assign( documentCount, 0 );
+  _seen.assign( documentCount, 0 );
+
+  if( !_postingBudget || !_accumulateImpacts( index, first, last + 1 ) )
+    _accumulateLists( index, first, last + 1 );
+
+  // add the background scores of the touched documents and keep the best
+  std::sort( _touched.begin(), _touched.end() );
+
+  for( size_t i=0; i<_touched.size(); i++ ) {
+    lemur::api::DOCID_T document = _touched[i];
+
+    if( deleted->isDeleted( document ) )
+      continue;
+
+    int documentLength = index.documentLength( document );
+    double score = _scores[ document - _documentBase ];
+
+    for( size_t j=0; j<_terms.size(); j++ )
+      score += _terms[j].scorer->background( documentLength );
+
+    _top.push( score, document, documentLength );
+    _documentsScored++;
+  }
+}
+
+//
+// _accumulateLists
+//
+
+void indri::infnet::TermAtATimeAccumulator::_accumulateLists( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  for( size_t i=0; i<_terms.size(); i++ ) {
+    if( _terms[i].listID < 0 )
+      continue;
+
+    indri::index::DocListIterator* list = _network.getDocIterator( _terms[i].listID );
+
+    if( list )
+      _terms[i].scorer->accumulate( list, index, begin, end );
+  }
+}
+
+//
+// _accumulateImpacts
+//
+// Reads the impact lists of the index score-at-a-time until the posting
+// budget is spent; returns false, having read nothing, if the index has
+// no impact lists.  The budget is charged for postings out of range too,
+// so every docid range reads the same postings.
+//
+
+bool indri::infnet::TermAtATimeAccumulator::_accumulateImpacts( indri::index::Index& index, lemur::api::DOCID_T begin, lemur::api::DOCID_T end ) {
+  std::vector<indri::index::ImpactListIterator*> lists;
+  std::vector<impact_cursor> cursors;
+  bool impacts = true;
+
+  for( size_t i=0; i<_terms.size(); i++ ) {
+    if( _terms[i].listID < 0 || !_network.getDocIterator( _terms[i].listID ) )
+      continue;
+
+    indri::index::ImpactListIterator* list = index.impactListIterator( _terms[i].term, _network.allocator() );
+
+    // the term has a list here, but no impact list
+    if( !list ) {
+      impacts = false;
+      break;
+    }
+
+    lists.push_back( list );
+    list->startIteration();
+
+    if( list->finished() )
+      continue;
+
+    const indri::index::ImpactListIterator::Segment& segment = list->currentSegment();
+    impact_cursor cursor;
+    cursor.term = i;
+    cursor.list = list;
+    cursor.estimate = _terms[i].scorer->difference( segment.count, segment.length );
+    cursors.push_back( cursor );
+  }
+
+  if( impacts ) {
+    UINT64 budget = _postingBudget;
+    std::make_heap( cursors.begin(), cursors.end() );
+
+    while( cursors.size() && budget ) {
+      std::pop_heap( cursors.begin(), cursors.end() );
+      impact_cursor& cursor = cursors.back();
+
+      int postings = (int) lemur_compat::min<UINT64>( cursor.list->currentSegment().size, budget );
+      const indri::index::ImpactListIterator::Segment& segment = cursor.list->decode( postings );
+      budget -= postings;
+      _terms[cursor.term].scorer->accumulate( segment, index, begin, end );
+
+      if( cursor.list->nextSegment() ) {
+        const indri::index::ImpactListIterator::Segment& next = cursor.list->currentSegment();
+        cursor.estimate = _terms[cursor.term].scorer->difference( next.count, next.length );
+        std::push_heap( cursors.begin(), cursors.end() );
+      } else {
+        cursors.pop_back();
+      }
+    }
+  }
+
+  for( size_t i=0; i<lists.size(); i++ ) {
+    lists[i]->addCounters( _listCounters );
+    delete lists[i];
+  }
+
+  return impacts;
+}
+
+void indri::infnet::TermAtATimeAccumulator::evaluate( lemur::api::DOCID_T documentID, int documentLength ) {
+  // scoring happens in evaluateIndex
+}
+
+lemur::api::DOCID_T indri::infnet::TermAtATimeAccumulator::nextCandidateDocument() {
+  return MAX_INT32;
+}
+
+void indri::infnet::TermAtATimeAccumulator::indexChanged( indri::index::Index& index ) {
+  // do nothing
+}
+
+const indri::infnet::EvaluatorNode::MResults& indri::infnet::TermAtATimeAccumulator::getResults() {
+  _results.clear();
+
+  if( !_top.size() )
+    return _results;
+
+  // puts scores into the vector in descending order
+  _top.results( _results["scores"] );
+  return _results;
+}
+
+const std::string& indri::infnet::TermAtATimeAccumulator::getName() const {
+  return _name;
+}
+
+void indri::infnet::TermAtATimeAccumulator::addCounters( indri::utility::QueryCounters& counters ) {
+  counters += _listCounters;
+  counters.documentsScored += _documentsScored;
+  counters.heapInsertions += _top.insertions();
+}
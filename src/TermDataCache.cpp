@@ -0,0 +1,134 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermDataCache
+//
+
+#include "indri/TermDataCache.hpp"
+#include <string.h>
+#include <stdlib.h>
+
+indri::index::TermDataCache::TermDataCache() :
+  _fieldCount(0)
+{
+}
+
+//
+// _stringShard
+//
+
+size_t indri::index::TermDataCache::_stringShard( const char* term ) {
+  indri::utility::GenericHash<const char*> hash;
+  return hash( term ) % SHARDS;
+}
+
+//
+// _idShard
+//
+
+size_t indri::index::TermDataCache::_idShard( lemur::api::TERMID_T termID ) {
+  return size_t(termID) % SHARDS;
+}
+
+//
+// open
+//
+
+void indri::index::TermDataCache::open( size_t capacity, int fieldCount ) {
+  _fieldCount = fieldCount;
+
+  // each key space holds every cached term once
+  size_t shardCapacity = capacity ? (capacity + SHARDS - 1) / SHARDS : 0;
+
+  for( size_t i=0; i<SHARDS; i++ ) {
+    _strings[i].setCapacity( shardCapacity );
+    _ids[i].setCapacity( shardCapacity );
+  }
+}
+
+//
+// close
+//
+
+void indri::index::TermDataCache::close() {
+  for( size_t i=0; i<SHARDS; i++ ) {
+    _strings[i].clear();
+    _ids[i].clear();
+  }
+}
+
+//
+// find
+//
+
+indri::index::DiskTermData* indri::index::TermDataCache::find( const char* term ) {
+  return _strings[_stringShard(term)].find( term, _fieldCount );
+}
+
+//
+// find
+//
+
+indri::index::DiskTermData* indri::index::TermDataCache::find( lemur::api::TERMID_T termID ) {
+  return _ids[_idShard(termID)].find( termID, _fieldCount );
+}
+
+//
+// insert
+//
+
+void indri::index::TermDataCache::insert( const DiskTermData* data ) {
+  DiskTermData* stringEntry = copy( data, _fieldCount );
+  const char* term = stringEntry->termData->term;
+
+  _strings[_stringShard(term)].insert( term, stringEntry );
+  _ids[_idShard(data->termID)].insert( data->termID, copy( data, _fieldCount ) );
+}
+
+//
+// size
+//
+
+size_t indri::index::TermDataCache::size() {
+  size_t total = 0;
+
+  for( size_t i=0; i<SHARDS; i++ )
+    total += _strings[i].size();
+
+  return total;
+}
+
+//
+// copy
+//
+// Same layout as disktermdata_decompress (DiskTermData, then TermData
+// with its fields, then the term string), but the string only takes
+// the space it needs.
+//
+
+indri::index::DiskTermData* indri::index::TermDataCache::copy( const DiskTermData* data, int fieldCount ) {
+  int termDataSize = ::termdata_size( fieldCount );
+  size_t termLength = strlen( data->termData->term ) + 1;
+  char* block = (char*) malloc( sizeof(DiskTermData) + termDataSize + termLength );
+
+  DiskTermData* result = (DiskTermData*) block;
+  TermData* termData = (TermData*) (block + sizeof(DiskTermData));
+  char* term = block + sizeof(DiskTermData) + termDataSize;
+
+  memcpy( result, data, sizeof(DiskTermData) );
+  memcpy( (void*) termData, data->termData, termDataSize );
+  memcpy( term, data->termData->term, termLength );
+
+  result->termData = termData;
+  termData->term = term;
+  return result;
+}
@@ -0,0 +1,211 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermDictionary
+//
+
+#include "indri/TermDictionary.hpp"
+#include "indri/DiskTermData.hpp"
+#include "indri/RVLDecompressStream.hpp"
+#include <string.h>
+#include <stdlib.h>
+
+indri::index::TermDictionary::TermDictionary() :
+  _fieldCount(0)
+{
+}
+
+//
+// _hash
+//
+// 64-bit FNV-1a
+//
+
+UINT64 indri::index::TermDictionary::_hash( const char* term ) {
+  UINT64 hash = 14695981039346656037ULL;
+
+  for( ; *term; term++ ) {
+    hash ^= (unsigned char) *term;
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+//
+// _add
+//
+
+void indri::index::TermDictionary::_add( indri::file::BulkTreeReader& tree, int termBase ) {
+  int dataSize = ::disktermdata_size( _fieldCount );
+  std::vector<char> value( dataSize );
+  std::vector<char> decoded( dataSize );
+  char key[lemur::file::Keyfile::MAX_KEY_LENGTH+1];
+
+  indri::file::BulkTreeIterator* iterator = tree.iterator();
+
+  for( iterator->startIteration(); !iterator->finished(); iterator->nextEntry() ) {
+    int keyActual = 0;
+    int valueActual = 0;
+
+    if( !iterator->get( key, sizeof(key)-1, keyActual, &value.front(), dataSize, valueActual ) )
+      continue;
+
+    key[keyActual] = 0;
+
+    indri::utility::RVLDecompressStream stream( &value.front(), valueActual );
+    indri::index::DiskTermData* diskTermData = ::disktermdata_decompress( stream, &decoded.front(), _fieldCount,
+                                                                          DiskTermData::WithTermID | DiskTermData::WithOffsets );
+
+    entry e;
+    e.termID = diskTermData->termID + termBase;
+    e.termOffset = UINT32(_strings.size());
+    e.startOffset = diskTermData->startOffset;
+    e.length = diskTermData->length;
+    e.totalCount = diskTermData->termData->corpus.totalCount;
+    e.documentCount = diskTermData->termData->corpus.documentCount;
+    _entries.push_back( e );
+
+    _strings.insert( _strings.end(), key, key + keyActual + 1 );
+
+    for( int i=0; i<_fieldCount; i++ ) {
+      field_entry f;
+      f.totalCount = diskTermData->termData->fields[i].totalCount;
+      f.documentCount = diskTermData->termData->fields[i].documentCount;
+      _fields.push_back( f );
+    }
+  }
+
+  delete iterator;
+}
+
+//
+// _buildIndexes
+//
+
+void indri::index::TermDictionary::_buildIndexes() {
+  // keep the table at most half full so probe chains stay short
+  size_t slotCount = 2;
+  while( slotCount < 2 * _entries.size() )
+    slotCount *= 2;
+
+  _slots.assign( slotCount, 0 );
+  lemur::api::TERMID_T maximumID = 0;
+
+  for( size_t i=0; i<_entries.size(); i++ ) {
+    size_t slot = size_t( _hash( term( _entries[i] ) ) & (slotCount-1) );
+
+    while( _slots[slot] )
+      slot = (slot + 1) & (slotCount-1);
+
+    _slots[slot] = UINT32(i+1);
+
+    if( _entries[i].termID > maximumID )
+      maximumID = _entries[i].termID;
+  }
+
+  _ids.assign( size_t(maximumID) + 1, 0 );
+
+  for( size_t i=0; i<_entries.size(); i++ ) {
+    if( _entries[i].termID > 0 )
+      _ids[ _entries[i].termID ] = UINT32(i+1);
+  }
+}
+
+//
+// load
+//
+
+void indri::index::TermDictionary::load( indri::file::BulkTreeReader& frequent, indri::file::BulkTreeReader& infrequent,
+                                         int infrequentBase, int fieldCount ) {
+  clear();
+  _fieldCount = fieldCount;
+
+  _add( frequent, 0 );
+  _add( infrequent, infrequentBase );
+  _buildIndexes();
+}
+
+//
+// clear
+//
+
+void indri::index::TermDictionary::clear() {
+  std::vector<entry>().swap( _entries );
+  std::vector<field_entry>().swap( _fields );
+  std::vector<char>().swap( _strings );
+  std::vector<UINT32>().swap( _slots );
+  std::vector<UINT32>().swap( _ids );
+}
+
+//
+// find
+//
+
+const indri::index::TermDictionary::entry* indri::index::TermDictionary::find( const char* t ) const {
+  if( _slots.empty() )
+    return 0;
+
+  size_t mask = _slots.size() - 1;
+  size_t slot = size_t( _hash( t ) & mask );
+
+  while( _slots[slot] ) {
+    const entry& e = _entries[ _slots[slot] - 1 ];
+
+    if( !strcmp( term( e ), t ) )
+      return &e;
+
+    slot = (slot + 1) & mask;
+  }
+
+  return 0;
+}
+
+//
+// find
+//
+
+const indri::index::TermDictionary::entry* indri::index::TermDictionary::find( lemur::api::TERMID_T termID ) const {
+  if( termID <= 0 || size_t(termID) >= _ids.size() || !_ids[termID] )
+    return 0;
+
+  return &_entries[ _ids[termID] - 1 ];
+}
+
+//
+// fieldTotalCount
+//
+
+UINT64 indri::index::TermDictionary::fieldTotalCount( const entry& e, int field ) const {
+  size_t index = &e - &_entries.front();
+  return _fields[ index * _fieldCount + field - 1 ].totalCount;
+}
+
+//
+// fieldDocumentCount
+//
+
+UINT64 indri::index::TermDictionary::fieldDocumentCount( const entry& e, int field ) const {
+  size_t index = &e - &_entries.front();
+  return _fields[ index * _fieldCount + field - 1 ].documentCount;
+}
+
+//
+// memorySize
+//
+
+UINT64 indri::index::TermDictionary::memorySize() const {
+  return UINT64(_entries.capacity()) * sizeof(entry) +
+         UINT64(_fields.capacity()) * sizeof(field_entry) +
+         UINT64(_strings.capacity()) +
+         UINT64(_slots.capacity() + _ids.capacity()) * sizeof(UINT32);
+}
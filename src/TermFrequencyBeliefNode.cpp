@@ -12,7 +12,117 @@
 #include "indri/TermFrequencyBeliefNode.hpp"
 #include "indri/InferenceNetwork.hpp"
 #include <cmath>
+#include <algorithm>
 #include "indri/ex_changes.hpp"
+#include "indri/PertubePolicy.hpp"
+
+namespace indri
+{
+  namespace infnet
+  {
+    //
+    // Adapts the virtual TermScoreFunction interface to the kernel
+    // interface of TermScoreModels.hpp, for nodes built without create().
+    //
+
+    struct virtual_score_kernel {
+      indri::query::TermScoreFunction& function;
+
+      virtual_score_kernel( indri::query::TermScoreFunction& f ) : function(f) {}
+
+      double score( double occurrences, int documentLength, double qtf, double docUniqueTerms ) const {
+        return function.scoreOccurrence( occurrences, documentLength, qtf, docUniqueTerms );
+      }
+    };
+
+    //
+    // A TermFrequencyBeliefNode with a fixed retrieval model and
+    // perturbation policy.  The model kernel is called directly, so
+    // the per-posting path has no virtual call.
+    //
+
+    template<class _Model, class _Pertube>
+    class PertubedTermFrequencyBeliefNode : public TermFrequencyBeliefNode {
+    private:
+      const _Model& _model;
+
+    public:
+      PertubedTermFrequencyBeliefNode( const std::string& name,
+                                       class InferenceNetwork& network,
+                                       int listID,
+                                       indri::query::ModelTermScoreFunction<_Model>& scoreFunction,
+                                       double qtf ) :
+        TermFrequencyBeliefNode( name, network, listID, scoreFunction, qtf ),
+        _model( scoreFunction.model() )
+      {
+      }
+
+      const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& score( lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength ) {
+        return this->template _score<_Model, _Pertube>( _model, documentID, extent, documentLength );
+      }
+
+      void indexChanged( indri::index::Index& index ) {
+        TermFrequencyBeliefNode::indexChanged( index );
+
+        // the model bounds are computed on unperturbed counts and lengths
+        if( !_Pertube::bounded ) {
+          _maximumBackgroundScore = INDRI_HUGE_SCORE;
+          _maximumScore = INDRI_HUGE_SCORE;
+        }
+      }
+    };
+
+    template<class _Model>
+    struct term_frequency_node_factory {
+      typedef TermFrequencyBeliefNode* result_type;
+
+      const std::string& name;
+      InferenceNetwork& network;
+      int listID;
+      indri::query::ModelTermScoreFunction<_Model>& function;
+      double qtf;
+
+      term_frequency_node_factory( const std::string& n, InferenceNetwork& net, int l, indri::query::ModelTermScoreFunction<_Model>& f, double q ) :
+        name(n), network(net), listID(l), function(f), qtf(q) {}
+
+      template<class _Pertube>
+      TermFrequencyBeliefNode* apply() {
+        return new (network.allocator()) PertubedTermFrequencyBeliefNode<_Model, _Pertube>( name, network, listID, function, qtf );
+      }
+    };
+
+    struct term_frequency_model_factory {
+      typedef TermFrequencyBeliefNode* result_type;
+
+      const std::string& name;
+      InferenceNetwork& network;
+      int listID;
+      indri::query::TermScoreFunction& function;
+      double qtf;
+
+      term_frequency_model_factory( const std::string& n, InferenceNetwork& net, int l, indri::query::TermScoreFunction& f, double q ) :
+        name(n), network(net), listID(l), function(f), qtf(q) {}
+
+      // TermScoreFunctionFactory built function from the same model type,
+      // so the downcast is safe
+      template<class _Model>
+      TermFrequencyBeliefNode* apply() {
+        indri::query::ModelTermScoreFunction<_Model>& modelFunction = static_cast<indri::query::ModelTermScoreFunction<_Model>&>( function );
+        term_frequency_node_factory<_Model> factory( name, network, listID, modelFunction, qtf );
+        return indri::query::pertube::dispatch( function.getModelParameters().pertubeType, factory );
+      }
+    };
+  }
+}
+
+indri::infnet::TermFrequencyBeliefNode* indri::infnet::TermFrequencyBeliefNode::create( const std::string& name,
+                                                                                         class InferenceNetwork& network,
+                                                                                         int listID,
+                                                                                         indri::query::TermScoreFunction& scoreFunction,
+                                                                                         double qtf ) {
+  indri::infnet::term_frequency_model_factory factory( name, network, listID, scoreFunction, qtf );
+  return indri::query::model::dispatch( scoreFunction.getModelParameters().model, factory );
+}
 
 indri::infnet::TermFrequencyBeliefNode::TermFrequencyBeliefNode( const std::string& name,
                                                                  class InferenceNetwork& network,
@@ -24,8 +134,14 @@ indri::infnet::TermFrequencyBeliefNode::TermFrequencyBeliefNode( const std::stri
   _network(network),
   _listID(listID),
   _function(scoreFunction),
-  _qtf(qtf)
+  _qtf(qtf),
+  _sharedList(false),
+  _floor(0),
+  _blockReading(false),
+  _blockIndex(0)
 {
+  _block.documents = 0;
+  _block.size = 0;
   _maximumBackgroundScore = INDRI_HUGE_SCORE;
   _maximumScore = INDRI_HUGE_SCORE;
 }
@@ -41,17 +157,94 @@ const indri::utility::greedy_vector<indri::index::DocListIterator::TopDocument>&
 }
 
 lemur::api::DOCID_T indri::infnet::TermFrequencyBeliefNode::nextCandidateDocument() {
+  if( _blockReading )
+    return _block.documents ? _block.documents[_blockIndex] : MAX_INT32;
+
   if( _list ) {
     const indri::index::DocListIterator::DocumentData* entry = _list->currentEntry();
     
     if( entry ) {
-      return entry->document;
+      return lemur_compat::max( entry->document, _floor );
     }
   }
 
   return MAX_INT32;
 }
 
+bool indri::infnet::TermFrequencyBeliefNode::_behindFloor() {
+  const indri::index::DocListIterator::DocumentData* entry = _list ? _list->currentEntry() : 0;
+  return entry && entry->document < _floor;
+}
+
+//
+// _readBlock
+//
+// Takes the current entry of the list and the decoded entries after it.
+//
+
+void indri::infnet::TermFrequencyBeliefNode::_readBlock() {
+  const indri::index::DocListIterator::DocumentBlock* block = _list->finished() ? 0 : _list->currentBlock();
+
+  if( block ) {
+    _block = *block;
+  } else {
+    _block.documents = 0;
+    _block.size = 0;
+  }
+
+  _blockIndex = 0;
+}
+
+//
+// _advanceBlock
+//
+// The slow part of advance(): the document is past the current entry.
+// The list itself is still on the entry the block was read at, so it is
+// only called when the document is past the end of the block.
+//
+
+void indri::infnet::TermFrequencyBeliefNode::_advanceBlock( lemur::api::DOCID_T documentID ) {
+  if( !_block.documents )
+    return;
+
+  const lemur::api::DOCID_T* begin = _block.documents + _blockIndex;
+  const lemur::api::DOCID_T* end = _block.documents + _block.size;
+
+  if( end[-1] >= documentID ) {
+    // usually the next entry or one soon after it
+    if( begin + 1 < end && begin[1] >= documentID )
+      _blockIndex++;
+    else
+      _blockIndex = int( std::lower_bound( begin, end, documentID ) - _block.documents );
+    return;
+  }
+
+  _list->nextEntry( documentID );
+  _readBlock();
+}
+
+double indri::infnet::TermFrequencyBeliefNode::blockMaximumScore() {
+  // an unbounded node (see PertubedTermFrequencyBeliefNode) stays unbounded
+  if( !_list || _maximumScore == INDRI_HUGE_SCORE || _behindFloor() )
+    return _maximumScore;
+
+  const indri::index::DocListIterator::BlockSummary* summary = _list->blockSummary();
+
+  if( !summary )
+    return _maximumScore;
+
+  return _function.blockMaximumScore( summary->maxCount, summary->minLength, summary->maxFraction(), _qtf );
+}
+
+lemur::api::DOCID_T indri::infnet::TermFrequencyBeliefNode::blockLastDocument() {
+  const indri::index::DocListIterator::BlockSummary* summary = ( _list && !_behindFloor() ) ? _list->blockSummary() : 0;
+
+  if( !summary )
+    return MAX_INT32;
+
+  return summary->lastDocument;
+}
+
 double indri::infnet::TermFrequencyBeliefNode::maximumBackgroundScore() {
   return _maximumBackgroundScore;
 }
@@ -61,64 +254,46 @@ double indri::infnet::TermFrequencyBeliefNode::maximumScore() {
 }
 
 const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& indri::infnet::TermFrequencyBeliefNode::score( lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength ) {
+  indri::infnet::virtual_score_kernel kernel( _function );
+  return _score<indri::infnet::virtual_score_kernel, indri::query::pertube::NoPertube>( kernel, documentID, extent, documentLength );
+}
+
+template<class _Model, class _Pertube>
+const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& indri::infnet::TermFrequencyBeliefNode::_score( const _Model& model, lemur::api::DOCID_T documentID, indri::index::Extent &extent, int documentLength ) {
   assert( extent.begin == 0 && extent.end == documentLength ); // FrequencyListCopier ensures this condition
   _extents.clear();
 
   double score = 0;
   
   if( _list ) {
-    const indri::index::DocListIterator::DocumentData* entry = _list->currentEntry();
-    int count = ( entry && entry->document == documentID ) ? (int)entry->positions.size() : 0;
-    
-    int docUniqueTermCounts = 0;
-    #ifdef DOC_UNIQUE_TERM_COUNTS
-    if (entry){
-        docUniqueTermCounts = entry->uniqueTermCounts;
-        //cout << "TermFreBeliefNode.cpp --- count:" << count << " UniqueTermCounts:" << docUniqueTermCounts << " DLN:" << documentLength << endl;
+    int count = 0;
+    // the entry only knows the unique term count of its own document
+    int docUniqueTerms = 0;
+
+    if( _blockReading ) {
+      if( _block.documents && _block.documents[_blockIndex] == documentID ) {
+        count = _block.counts[_blockIndex];
+        #ifdef DOC_UNIQUE_TERM_COUNTS
+        docUniqueTerms = _block.uniqueTermCounts[_blockIndex];
+        #endif
+      }
+    } else {
+      const indri::index::DocListIterator::DocumentData* entry = _list->currentEntry();
+
+      if( entry && entry->document == documentID ) {
+        count = entry->count;
+        #ifdef DOC_UNIQUE_TERM_COUNTS
+        docUniqueTerms = entry->uniqueTermCounts;
+        #endif
+      }
     }
-    #endif
-    std::map<std::string, double> modelParas = _function.getModelParas();
-    switch(int(modelParas["__PERTUBE_TYPE__"])) {
-      case 1 : // LV1 
-        count *= (1-modelParas["__PERTUBE_b__"])*documentLength+modelParas["__PERTUBE_b__"]*1000000;
-        documentLength *= (1-modelParas["__PERTUBE_b__"])*documentLength+modelParas["__PERTUBE_b__"]*1000000;
-        break;
-      case 2 : // LV2
-        break;
-      case 3 : // LV3
-        count *= modelParas["__PERTUBE_k__"]+1;
-        documentLength *= modelParas["__PERTUBE_k__"]+1;
-        break;
-      case 4 : // TN1 (constant)
-        documentLength += modelParas["__PERTUBE_k__"];
-        break;
-      case 5 : // TN2 (linear)
-        documentLength *= 1+modelParas["__PERTUBE_b__"];
-        break;
-      case 6 : // TG1 (constant)
-        count += modelParas["__PERTUBE_k__"];
-        documentLength += modelParas["__PERTUBE_k__"];
-        break;
-      case 7 : // TG1 (linear)
-        break;
-      case 8 : // TG2 (constant)
-        break;
-      case 9 : // TG2 (linear)
-        break;
-      case 10 : // TG3 (constant)
-        count += _function.getQueryLength()*modelParas["__PERTUBE_k__"];
-        documentLength += _function.getQueryLength()*modelParas["__PERTUBE_k__"];
-        break;
-      case 11 : // TG3 (linear)
-        break;
-      default:
-        break;
-    } 
-    score = _function.scoreOccurrence( count, documentLength, _qtf, docUniqueTermCounts );
+
+    _Pertube::document( count, documentLength, _function.getQueryLength(), _function.getModelParameters() );
+    score = model.score( count, documentLength, _qtf, docUniqueTerms );
     assert( score <= _maximumScore || _list->topDocuments().size() > 0 );
     assert( score <= _maximumBackgroundScore || count != 0 );
   } else {
-    score = _function.scoreOccurrence( 0, documentLength, _qtf, 0 );
+    score = model.score( 0, documentLength, _qtf, 0 );
   }
   
   indri::api::ScoredExtentResult result(extent);
@@ -130,6 +305,9 @@ const indri::utility::greedy_vector<indri::api::ScoredExtentResult>& indri::infn
 }
 
 bool indri::infnet::TermFrequencyBeliefNode::hasMatch( lemur::api::DOCID_T documentID ) {
+  if( _blockReading )
+    return _block.documents && _block.documents[_blockIndex] == documentID;
+
   if( _list ) {
     const indri::index::DocListIterator::DocumentData* entry = _list->currentEntry();
     return ( entry && entry->document == documentID );
@@ -152,6 +330,15 @@ const std::string& indri::infnet::TermFrequencyBeliefNode::getName() const {
 void indri::infnet::TermFrequencyBeliefNode::indexChanged( indri::index::Index& index ) {
   // fetch the next inverted list
   _list = _network.getDocIterator( _listID );
+  _sharedList = _network.sharedDocIterator( _listID );
+  _floor = 0;
+  _blockReading = false;
+
+  if( _list && !_sharedList && !_list->finished() && _list->currentBlock() ) {
+    _blockReading = true;
+    _readBlock();
+    _network.driveDocIterator( _listID, this );
+  }
 
   if( !_list ) {
     _maximumBackgroundScore = INDRI_HUGE_SCORE;
@@ -173,10 +360,8 @@ void indri::infnet::TermFrequencyBeliefNode::indexChanged( indri::index::Index&
 
     indri::index::TermData* termData = _list->termData();
 
-    double maxOccurrences = ceil( double(termData->maxDocumentLength) * maximumFraction );
-
-    _maximumScore = _function.scoreOccurrence( maxOccurrences, termData->maxDocumentLength, _qtf, 0 );
-    _maximumBackgroundScore = _function.scoreOccurrence( 0, 1, _qtf, 0 );
+    _maximumScore = _function.maximumScore( maximumFraction, termData->maxDocumentLength, _qtf );
+    _maximumBackgroundScore = _function.maximumBackgroundScore( _qtf );
   }
 }
 
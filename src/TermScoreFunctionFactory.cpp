@@ -0,0 +1,92 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// TermScoreFunctionFactory
+//
+
+#include "indri/TermScoreFunctionFactory.hpp"
+#include "lemur/Exception.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace indri
+{
+  namespace query
+  {
+    struct model_name_entry {
+      const char* name;
+      int type;
+    };
+
+    static const model_name_entry model_names[] = {
+      { "dirichlet", model::DIRICHLET },
+      { "dir", model::DIRICHLET },
+      { "d", model::DIRICHLET },
+      { "okapi", model::OKAPI },
+      { "bm25", model::OKAPI },
+      { "jm", model::JELINEK_MERCER },
+      { "jelinek-mercer", model::JELINEK_MERCER },
+      { "linear", model::JELINEK_MERCER },
+      { "pl2", model::PL2 },
+      { "f2exp", model::F2EXP },
+      { 0, 0 }
+    };
+
+    struct model_name_visitor {
+      typedef const char* result_type;
+
+      template<class _Model>
+      const char* apply() {
+        return _Model::name();
+      }
+    };
+
+    struct term_score_function_factory {
+      typedef TermScoreFunction* result_type;
+
+      const TermStatistics& statistics;
+      const ModelParameters& parameters;
+      indri::utility::RegionAllocator* allocator;
+
+      term_score_function_factory( const TermStatistics& s, const ModelParameters& p, indri::utility::RegionAllocator* a ) :
+        statistics(s), parameters(p), allocator(a) {}
+
+      template<class _Model>
+      TermScoreFunction* apply() {
+        return new (allocator) ModelTermScoreFunction<_Model>( statistics, parameters );
+      }
+    };
+  }
+}
+
+int indri::query::TermScoreFunctionFactory::modelType( const std::string& name ) {
+  std::string lower = name;
+  std::transform( lower.begin(), lower.end(), lower.begin(), ::tolower );
+
+  for( int i=0; model_names[i].name; i++ ) {
+    if( lower == model_names[i].name )
+      return model_names[i].type;
+  }
+
+  LEMUR_THROW( LEMUR_BAD_PARAMETER_ERROR, "Unknown retrieval method: " + name );
+}
+
+const char* indri::query::TermScoreFunctionFactory::modelName( int type ) {
+  model_name_visitor visitor;
+  return model::dispatch( type, visitor );
+}
+
+indri::query::TermScoreFunction* indri::query::TermScoreFunctionFactory::get( const TermStatistics& statistics, const ModelParameters& parameters, indri::utility::RegionAllocator* allocator ) {
+  term_score_function_factory factory( statistics, parameters, allocator );
+  return model::dispatch( parameters.model, factory );
+}
@@ -0,0 +1,157 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+*/
+
+//
+// TermStatisticsCache
+//
+
+#include "indri/TermStatisticsCache.hpp"
+#include "indri/ScopedLock.hpp"
+
+//
+// shard::setCapacity
+//
+
+void indri::collection::TermStatisticsCache::shard::setCapacity( size_t capacity ) {
+  indri::thread::ScopedLock lock( _lock );
+  _capacity = capacity;
+  _slots.reserve( capacity );
+}
+
+//
+// shard::find
+//
+
+bool indri::collection::TermStatisticsCache::shard::find( const std::string& term, statistics& counts ) {
+  indri::thread::ScopedLock lock( _lock );
+  size_t* position = _index.find( term );
+
+  if( !position )
+    return false;
+
+  slot& s = _slots[*position];
+  s.referenced = true;
+  counts = s.counts;
+  return true;
+}
+
+//
+// shard::insert
+//
+
+void indri::collection::TermStatisticsCache::shard::insert( const std::string& term, const statistics& counts ) {
+  indri::thread::ScopedLock lock( _lock );
+
+  if( _capacity == 0 || _index.find( term ) )
+    return;
+
+  size_t position;
+
+  if( _slots.size() < _capacity ) {
+    position = _slots.size();
+    _slots.push_back( slot() );
+  } else {
+    // sweep the clock hand past recently used entries
+    while( _slots[_hand].referenced ) {
+      _slots[_hand].referenced = false;
+      _hand = (_hand + 1) % _slots.size();
+    }
+
+    position = _hand;
+    _hand = (_hand + 1) % _slots.size();
+
+    _index.remove( _slots[position].term );
+  }
+
+  slot& s = _slots[position];
+  s.term = term;
+  s.counts = counts;
+  s.referenced = false;
+  _index.insert( term, position );
+}
+
+//
+// shard::clear
+//
+
+void indri::collection::TermStatisticsCache::shard::clear() {
+  indri::thread::ScopedLock lock( _lock );
+  _slots.clear();
+  _index.clear();
+  _hand = 0;
+}
+
+//
+// shard::size
+//
+
+size_t indri::collection::TermStatisticsCache::shard::size() {
+  indri::thread::ScopedLock lock( _lock );
+  return _slots.size();
+}
+
+//
+// _shard
+//
+
+size_t indri::collection::TermStatisticsCache::_shard( const std::string& term ) {
+  indri::utility::GenericHash<std::string> hash;
+  return hash( term ) % SHARDS;
+}
+
+//
+// open
+//
+
+void indri::collection::TermStatisticsCache::open( size_t capacity ) {
+  size_t shardCapacity = capacity ? (capacity + SHARDS - 1) / SHARDS : 0;
+
+  for( size_t i=0; i<SHARDS; i++ )
+    _shards[i].setCapacity( shardCapacity );
+}
+
+//
+// close
+//
+
+void indri::collection::TermStatisticsCache::close() {
+  for( size_t i=0; i<SHARDS; i++ )
+    _shards[i].clear();
+}
+
+//
+// find
+//
+
+bool indri::collection::TermStatisticsCache::find( const std::string& term, statistics& counts ) {
+  return _shards[_shard(term)].find( term, counts );
+}
+
+//
+// insert
+//
+
+void indri::collection::TermStatisticsCache::insert( const std::string& term, const statistics& counts ) {
+  _shards[_shard(term)].insert( term, counts );
+}
+
+//
+// size
+//
+
+size_t indri::collection::TermStatisticsCache::size() {
+  size_t total = 0;
+
+  for( size_t i=0; i<SHARDS; i++ )
+    total += _shards[i].size();
+
+  return total;
+}
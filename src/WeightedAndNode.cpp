@@ -27,23 +27,24 @@
 #include "indri/Parameters.hpp"
 #include <cmath>
 
-double indri::infnet::WeightedAndNode::_computeMaxScore( unsigned int start ) {
-  // first, find the maximum score of the first few columns
-  double maxScoreSum = 0;
-
-  for( unsigned int i=0; i<start+1; i++ ) {
-    maxScoreSum += _children[i].maximumWeightedScore;
-  }
-
-  // then add in the background score of the last columns
-  double minScoreSum = 0;
-
-  for( unsigned int i=start+1; i<_children.size(); i++ ) {
-    minScoreSum += _children[i].backgroundWeightedScore;
-  }
-
-  return maxScoreSum + minScoreSum;
-}
+//
+// Candidate selection is WAND: the children are ordered by their next
+// document, and the first document whose summed upper bound can reach
+// the threshold (the pivot) is the next candidate.  Lists that sit
+// before the pivot are moved up to it with nextEntry(), so documents
+// in between are never decoded or scored.  When every list up to the
+// pivot is on the pivot, the per-block bounds of those lists are
+// checked as well (Block-Max WAND), and the lists are moved past the
+// shortest block if the block bounds cannot reach the threshold.
+//
+// A document's score is at most the sum of the background scores of
+// all children plus, for every list that contains it, the difference
+// between that list's maximum score and its background score.
+//
+// The per-term maximum scores do not cover the topdocs of that term
+// (see TermFrequencyBeliefNode::indexChanged), so topdocs are always
+// candidates, and no list is ever moved past the next one.
+//
 
 void indri::infnet::WeightedAndNode::setSiblingsFlag(int f){
   // set flag for child nodes
@@ -52,29 +53,127 @@ void indri::infnet::WeightedAndNode::setSiblingsFlag(int f){
   }
 }
 
-void indri::infnet::WeightedAndNode::_computeQuorum() {
-  double maximumScore = -DBL_MAX;
-  unsigned int i;
+double indri::infnet::WeightedAndNode::_scoreRange( const child_type& child, double maximumWeightedScore ) const {
+  double range = maximumWeightedScore - child.backgroundWeightedScore;
+  return range > 0 ? range : 0;
+}
+
+void indri::infnet::WeightedAndNode::_computeBounds() {
+  _backgroundScoreSum = 0;
 
-  // keep going until we find a necessary term
-  for( i=0; i<_children.size() && maximumScore < _threshold; i++ ) {
-    maximumScore = _computeMaxScore(i);
+  for( size_t i=0; i<_children.size(); i++ ) {
+    _backgroundScoreSum += _children[i].backgroundWeightedScore;
   }
+}
+
+lemur::api::DOCID_T indri::infnet::WeightedAndNode::_nextPivot( lemur::api::DOCID_T limit ) {
+  // without a threshold nothing can be skipped, so the pivot is just
+  // the first document of any list
+  if( _threshold == -DBL_MAX ) {
+    lemur::api::DOCID_T pivot = limit;
+
+    for( size_t i=0; i<_children.size(); i++ )
+      pivot = lemur_compat::min( pivot, _children[i].node->nextCandidateDocument() );
+
+    return pivot;
+  }
+
+  while( true ) {
+    // order the children by their next document
+    _pivots.clear();
+
+    for( size_t i=0; i<_children.size(); i++ ) {
+      pivot_entry entry;
+      entry.document = _children[i].node->nextCandidateDocument();
+      entry.child = &_children[i];
+      _pivots.push_back( entry );
+    }
+
+    std::sort( _pivots.begin(), _pivots.end(), pivot_entry::document_less() );
+
+    // find the first list whose document could reach the threshold
+    double bound = _backgroundScoreSum;
+    size_t pivotIndex;
+
+    for( pivotIndex=0; pivotIndex<_pivots.size(); pivotIndex++ ) {
+      if( _pivots[pivotIndex].document == MAX_INT32 )
+        return limit;
+
+      child_type& child = *_pivots[pivotIndex].child;
+      bound += _scoreRange( child, child.maximumWeightedScore );
+
+      if( bound >= _threshold )
+        break;
+    }
+
+    if( pivotIndex == _pivots.size() )
+      return limit;
+
+    lemur::api::DOCID_T pivot = _pivots[pivotIndex].document;
+
+    if( pivot >= limit )
+      return limit;
 
-  _quorumIndex = i-1;
-  if( _quorumIndex < 0 )
-    _quorumIndex = 0;
+    if( _pivots[0].document != pivot ) {
+      // some lists are behind the pivot; nothing before the pivot can
+      // reach the threshold, so move them up to it
+      for( size_t i=0; i<pivotIndex && _pivots[i].document < pivot; i++ ) {
+        if( !_pivots[i].child->term )
+          return _pivots[0].document;
 
-  if( _quorumIndex > (int)_children.size()-1 )
-    _recomputeThreshold = DBL_MAX;
-  else
-    _recomputeThreshold = maximumScore;
+        _pivots[i].child->term->advance( pivot );
+      }
+      continue;
+    }
+
+    // every list up to the pivot is on the pivot; include the ones after
+    // it that are on it too, then check the block bounds of all of them
+    size_t lastIndex = pivotIndex;
+
+    while( lastIndex+1 < _pivots.size() && _pivots[lastIndex+1].document == pivot )
+      lastIndex++;
+
+    double blockBound = _backgroundScoreSum;
+    lemur::api::DOCID_T blockEnd = MAX_INT32;
+
+    for( size_t i=0; i<=lastIndex; i++ ) {
+      child_type& child = *_pivots[i].child;
+
+      if( child.term ) {
+        blockBound += _scoreRange( child, child.term->blockMaximumScore() * child.weight );
+        blockEnd = lemur_compat::min( blockEnd, child.term->blockLastDocument() );
+      } else {
+        blockBound += _scoreRange( child, child.maximumWeightedScore );
+      }
+    }
+
+    if( blockBound >= _threshold || blockEnd == MAX_INT32 )
+      return pivot;
+
+    // no document before the end of the shortest block can reach the threshold
+    lemur::api::DOCID_T next = blockEnd + 1;
+
+    if( lastIndex+1 < _pivots.size() )
+      next = lemur_compat::min( next, _pivots[lastIndex+1].document );
+    if( next <= pivot )
+      next = pivot + 1;
+    if( next > limit )
+      next = limit;
+
+    for( size_t i=0; i<=lastIndex; i++ ) {
+      if( !_pivots[i].child->term )
+        return pivot;
+
+      _pivots[i].child->term->advance( next );
+    }
+  }
 }
 
 void indri::infnet::WeightedAndNode::addChild( double weight, BeliefNode* node ) {
   child_type child;
 
   child.node = node;
+  child.term = dynamic_cast<indri::infnet::TermFrequencyBeliefNode*>(node);
   child.weight = weight;
   child.backgroundWeightedScore = node->maximumBackgroundScore() * weight;
   child.maximumWeightedScore = node->maximumScore() * weight;
@@ -93,8 +192,7 @@ void indri::infnet::WeightedAndNode::addChild( double weight, BeliefNode* node )
   }
 
   _children.push_back( child );
-  std::sort( _children.begin(), _children.end(), child_type::maxscore_less() );
-  _computeQuorum();
+  _computeBounds();
 
   // if this is the second child, ensure we have set the sibling flag
   // for the first and second ones (it will skip without this!)
@@ -124,7 +222,7 @@ void indri::infnet::WeightedAndNode::indexChanged( indri::index::Index& index )
 
   // get all the relevant topdocs lists
   for( size_t i=0; i<_children.size(); i++ ) {
-    indri::infnet::TermFrequencyBeliefNode* node = dynamic_cast<indri::infnet::TermFrequencyBeliefNode*>(_children[i].node);
+    indri::infnet::TermFrequencyBeliefNode* node = _children[i].term;
 
     if( node && indri::api::Parameters::instance().get( "topdocs", true ) ) {
       indri::utility::greedy_vector<indri::index::DocListIterator::TopDocument>* copy = new indri::utility::greedy_vector<indri::index::DocListIterator::TopDocument>( node->topdocs() );
@@ -136,8 +234,6 @@ void indri::infnet::WeightedAndNode::indexChanged( indri::index::Index& index )
     }
   }
 
-  std::sort( _children.begin(), _children.end(), child_type::maxscore_less() );
-
   // TODO: could compute an initial threshold here, but that may not be necessary
   indri::utility::greedy_vector<int> indexes;
 
@@ -181,37 +277,21 @@ void indri::infnet::WeightedAndNode::indexChanged( indri::index::Index& index )
   for( size_t i=0; i<lists.size(); i++ )
     delete lists[i];
 
-  // compute quorum
-  _computeQuorum();
+  _computeBounds();
 }
 
 void indri::infnet::WeightedAndNode::setThreshold( double threshold ) {
   _threshold = threshold;
-
-  if( _threshold >= _recomputeThreshold ) {
-   // std::cout << "threshold hit recompute " << _recomputeThreshold << std::endl;
-    _computeQuorum();
-  }
 }
   
 lemur::api::DOCID_T indri::infnet::WeightedAndNode::nextCandidateDocument() {
-  std::vector<child_type>::iterator iter;
   lemur::api::DOCID_T minDocument = MAX_INT32;
-  lemur::api::DOCID_T currentCandidate;
 
   if( _candidatesIndex < _candidates.size() ) {
     minDocument = _candidates[_candidatesIndex];
   }
 
-  for( iter = _children.begin() + _quorumIndex; iter != _children.end(); iter++ ) {
-    currentCandidate = (*iter).node->nextCandidateDocument();
-
-    if( currentCandidate < minDocument ) {
-      minDocument = currentCandidate;
-    }
-  }
-
-  return minDocument;
+  return _nextPivot( minDocument );
 }
 
 double indri::infnet::WeightedAndNode::maximumBackgroundScore() {
@@ -289,6 +369,18 @@ indri::utility::greedy_vector<indri::api::ScoredExtentResult>& indri::infnet::We
   return _scores;
 }
 
+//
+// skipTo
+//
+
+void indri::infnet::WeightedAndNode::skipTo( lemur::api::DOCID_T documentID ) {
+  while( _candidatesIndex < _candidates.size() && _candidates[_candidatesIndex] < documentID )
+    _candidatesIndex++;
+
+  for( size_t i=0; i<_children.size(); i++ )
+    _children[i].node->skipTo( documentID );
+}
+
 //
 // hasMatch
 //
@@ -0,0 +1,167 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+//
+// WorkerPool
+//
+
+#include "indri/WorkerPool.hpp"
+#include "indri/ScopedLock.hpp"
+#include "indri/delete_range.hpp"
+#include "lemur/Exception.hpp"
+
+// idle workers wake up this often to check for shutdown, since a
+// notification can be missed on platforms where notifyAll wakes one thread
+static const UINT64 IDLE_WAIT = 100*1000;
+
+struct indri::thread::WorkerPool::batch_type {
+  batch_type() : remaining(0), failed(false) {}
+
+  Mutex lock;
+  ConditionVariable done;
+  int remaining;
+  bool failed;
+  lemur::api::Exception error;
+};
+
+//
+// WorkerPool
+//
+
+indri::thread::WorkerPool::WorkerPool( int threads ) :
+  _quit(false)
+{
+  for( int i=0; i<threads; i++ )
+    _threads.push_back( new Thread( _threadMain, this ) );
+}
+
+//
+// ~WorkerPool
+//
+
+indri::thread::WorkerPool::~WorkerPool() {
+  {
+    ScopedLock l( _lock );
+    _quit = true;
+    _work.notifyAll();
+  }
+
+  for( size_t i=0; i<_threads.size(); i++ )
+    _threads[i]->join();
+
+  indri::utility::delete_vector_contents<Thread*>( _threads );
+}
+
+//
+// threads
+//
+
+int indri::thread::WorkerPool::threads() const {
+  return int(_threads.size());
+}
+
+//
+// _runOne
+//
+// Runs the next queued task, if there is one.  When wait is set, waits a
+// while for a task to show up first.
+//
+
+bool indri::thread::WorkerPool::_runOne( bool wait ) {
+  job_type job;
+
+  {
+    ScopedLock l( _lock );
+
+    if( _jobs.empty() && wait && !_quit )
+      _work.wait( _lock, IDLE_WAIT );
+
+    if( _jobs.empty() )
+      return false;
+
+    job = _jobs.front();
+    _jobs.pop();
+  }
+
+  batch_type& batch = *job.batch;
+  bool failed = false;
+  lemur::api::Exception error;
+
+  try {
+    job.task->run();
+  } catch( lemur::api::Exception& e ) {
+    failed = true;
+    error = e;
+  } catch( ... ) {
+    failed = true;
+    error = lemur::api::Exception( "WorkerPool", "a task threw an unknown exception" );
+  }
+
+  ScopedLock l( batch.lock );
+
+  if( failed && !batch.failed ) {
+    batch.failed = true;
+    batch.error = error;
+  }
+
+  if( --batch.remaining == 0 )
+    batch.done.notifyOne();
+
+  return true;
+}
+
+//
+// _threadMain
+//
+
+void indri::thread::WorkerPool::_threadMain( void* data ) {
+  WorkerPool* pool = (WorkerPool*) data;
+
+  while( !pool->_quit )
+    pool->_runOne( true );
+}
+
+//
+// run
+//
+
+void indri::thread::WorkerPool::run( const std::vector<Task*>& tasks ) {
+  batch_type batch;
+  batch.remaining = int(tasks.size());
+
+  if( tasks.empty() )
+    return;
+
+  {
+    ScopedLock l( _lock );
+
+    for( size_t i=0; i<tasks.size(); i++ ) {
+      job_type job;
+      job.task = tasks[i];
+      job.batch = &batch;
+      _jobs.push( job );
+      _work.notifyOne();
+    }
+  }
+
+  // help until the queue is empty; tasks from other batches may be run
+  // here too, which is harmless
+  while( _runOne( false ) )
+    ;
+
+  ScopedLock l( batch.lock );
+
+  while( batch.remaining > 0 )
+    batch.done.wait( batch.lock, IDLE_WAIT );
+
+  if( batch.failed )
+    throw batch.error;
+}
@@ -0,0 +1,57 @@
+/*==========================================================================
+ * Copyright (c) 2004 University of Massachusetts.  All Rights Reserved.
+ *
+ * Use of the Lemur Toolkit for Language Modeling and Information Retrieval
+ * is subject to the terms of the software license set forth in the LICENSE
+ * file included with this software, and also available at
+ * http://www.lemurproject.org/license.html
+ *
+ *==========================================================================
+ */
+
+
+//
+// XMLWriter
+//
+
+#include "indri/XMLWriter.hpp"
+
+indri::xml::XMLWriter::XMLWriter( const XMLNode* node ) :
+  _node(node)
+{
+}
+
+void indri::xml::XMLWriter::_writeTabs( int tabs, std::string& output ) const {
+  output.append( tabs, '\t' );
+}
+
+void indri::xml::XMLWriter::_write( const XMLNode* node, int tabs, std::string& output ) const {
+  const std::vector<XMLNode*>& children = node->getChildren();
+  const XMLNode::MAttributes& attributes = node->getAttributes();
+
+  _writeTabs( tabs, output );
+  output += "<" + node->getName();
+
+  XMLNode::MAttributes::const_iterator iter;
+  for( iter = attributes.begin(); iter != attributes.end(); iter++ )
+    output += " " + iter->first + "=\"" + iter->second + "\"";
+
+  output += ">";
+
+  if( children.size() ) {
+    output += "\n";
+
+    for( size_t i=0; i<children.size(); i++ )
+      _write( children[i], tabs+1, output );
+
+    _writeTabs( tabs, output );
+  } else {
+    output += node->getValue();
+  }
+
+  output += "</" + node->getName() + ">\n";
+}
+
+void indri::xml::XMLWriter::write( std::string& output ) const {
+  _write( _node, 0, output );
+}